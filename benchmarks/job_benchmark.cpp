@@ -0,0 +1,170 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+// Micro-benchmarks for rg/JobSystem.h: the cost of scheduling a job, of a dependency hop, and how
+// representative engine work scales from one thread to every core.
+//
+//   benchmarks [model.obj]
+//
+// The model defaults to the church; the mesh conversion rows are skipped when it can't be loaded.
+//
+// The convertMeshes row is the import time against thread count: the part of a model load between
+// Assimp's ReadFile and the GL uploads. ReadFile itself stays single threaded, the Loading window shows
+// both halves per model ("read" and "convert"). A model of many meshes scales per mesh, one made of a
+// few large meshes through their vertex and face chunks (16k each), so small single-mesh models stay flat.
+
+#include <glad/glad.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <learnopengl/model.h>
+#include <rg/JobSystem.h>
+#include <rg/TextureCompression.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// best of a few runs, in milliseconds
+double measure(int repeats, const std::function<void()>& body) {
+    double best = 1e30;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void benchmarkOverhead(unsigned threads) {
+    JobSystem jobs(threads - 1);
+    const size_t count = 200000;
+
+    double empty = measure(5, [&]() {
+        JobCounter counter;
+        for (size_t i = 0; i < count; ++i)
+            jobs.run([]() {}, &counter);
+        jobs.wait(counter);
+    });
+
+    // every job spawns the next one, so nothing overlaps and each hop is a full schedule and wake up
+    const size_t hops = 20000;
+    double chain = measure(5, [&]() {
+        std::vector<JobCounter> counters(hops);
+        jobs.run([]() {}, &counters[0]);
+        for (size_t i = 1; i < hops; ++i)
+            jobs.runAfter(counters[i - 1], []() {}, &counters[i]);
+        jobs.wait(counters.back());
+    });
+
+    JobSystemStats stats = jobs.stats();
+    std::printf("%7u %14.1f %14.1f %10.1f%%\n", threads, empty * 1e6 / count, chain * 1e6 / hops,
+                stats.jobsRun ? 100.0 * stats.steals / stats.jobsRun : 0.0);
+}
+
+struct Task {
+    const char* name;
+    std::function<void(JobSystem&)> body;
+};
+
+void benchmarkScaling(const std::vector<Task>& tasks, unsigned maxThreads) {
+    std::printf("%-22s", "threads");
+    for (unsigned threads = 1; threads <= maxThreads; ++threads)
+        std::printf("%16u", threads);
+    std::printf("\n");
+
+    std::vector<std::vector<double>> times(tasks.size());
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        JobSystem jobs(threads - 1);
+        for (size_t t = 0; t < tasks.size(); ++t)
+            times[t].push_back(measure(5, [&]() { tasks[t].body(jobs); }));
+    }
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        std::printf("%-22s", tasks[t].name);
+        for (double ms : times[t])
+            std::printf("%9.2f (%4.1fx)", ms, times[t][0] / ms);
+        std::printf("\n");
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("Job system benchmarks, %u hardware threads\n\n", cores);
+
+    std::printf("Scheduling overhead\n");
+    std::printf("%7s %14s %14s %11s\n", "threads", "ns/empty job", "ns/dep. hop", "stolen");
+    for (unsigned threads = 1; threads <= cores; threads *= 2)
+        benchmarkOverhead(threads);
+    if ((cores & (cores - 1)) != 0)
+        benchmarkOverhead(cores);
+    std::printf("\n");
+
+    std::vector<Task> tasks;
+
+    // plain arithmetic, the upper bound of what the pool can scale to
+    std::vector<float> values(1 << 22);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = (float)i * 0.001f;
+    std::vector<float> results(values.size());
+    tasks.push_back({"arithmetic 4M", [&](JobSystem& jobs) {
+        jobs.parallelFor(values.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                results[i] = std::sqrt(std::fabs(std::sin(values[i]) * std::cos(values[i] * 0.5f))) + values[i] * 0.25f;
+        });
+    }});
+
+    // the texture import encoder on a noisy 2048x2048 gradient
+    const int size = 2048;
+    std::vector<unsigned char> image((size_t)size * size * 4);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < (size_t)size * size; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        image[i * 4 + 0] = (unsigned char)((i % size) * 255 / size);
+        image[i * 4 + 1] = (unsigned char)((i / size) * 255 / size);
+        image[i * 4 + 2] = (unsigned char)(seed >> 24);
+        image[i * 4 + 3] = 255;
+    }
+    std::vector<unsigned char> encoded((size_t)(size / 4) * (size / 4) * 8);
+    tasks.push_back({"BC1 encode 2048^2", [&](JobSystem& jobs) {
+        jobs.parallelFor(size / 4, [&](size_t begin, size_t end) {
+            unsigned char block[64];
+            for (size_t by = begin; by < end; ++by) {
+                for (int bx = 0; bx < size / 4; ++bx) {
+                    rg::bc::fetchBlock(image.data(), size, size, bx, (int)by, block);
+                    rg::bc::encodeBC1Block(block, &encoded[(by * (size / 4) + bx) * 8]);
+                }
+            }
+        });
+    }});
+
+    // Model::convertMeshes, the CPU half of an import: one job per mesh, and meshes large enough are
+    // split further by vertex and face ranges, so even a single-mesh model spreads over the pool
+    std::string path = argc > 1 ? argv[1] : "resources/objects/church/aberkios_100k_texture.obj";
+    Assimp::Importer importer;
+    importer.SetIOHandler(new rg::MappedIOSystem);
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    std::vector<aiMesh*> sceneMeshes;
+    std::vector<MeshData> meshes;
+    std::string meshTask;
+    if (scene && scene->mRootNode && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+        sceneMeshes.assign(scene->mMeshes, scene->mMeshes + scene->mNumMeshes);
+        meshTask = "convertMeshes x" + std::to_string(scene->mNumMeshes);
+        tasks.push_back({meshTask.c_str(), [&](JobSystem& jobs) { meshes = Model::convertMeshes(sceneMeshes, scene, jobs); }});
+    } else {
+        std::printf("%s could not be loaded, skipping convertMeshes\n\n", path.c_str());
+    }
+
+    std::printf("Scaling, best of 5 in ms (speedup over one thread)\n");
+    benchmarkScaling(tasks, cores);
+    return 0;
+}
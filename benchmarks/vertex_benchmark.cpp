@@ -0,0 +1,150 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+// The Assimp-to-Vertex conversion kernels of rg/VertexConvert.h, on one thread, over the vertex arrays
+// of a model as Model::convertMesh sees them.
+//
+//   vertex_benchmark [model.obj]
+//
+// The model defaults to the church. When it can't be loaded a synthetic 1M vertex mesh is used instead,
+// so the kernels can still be compared. The first row is the per-vertex push_back loop the kernels
+// replaced, every kernel's output is checked against it; the last row is convertVertices, which picks a
+// kernel per mesh by its size.
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <rg/AssetIO.h>
+#include <rg/VertexConvert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SyntheticMesh {
+    std::vector<float> position, normal, texCoord, tangent, bitangent;
+};
+
+std::vector<float> noise(size_t count, unsigned int seed) {
+    std::vector<float> values(count);
+    for (float& value : values) {
+        seed = seed * 1664525u + 1013904223u;
+        value = (float)(seed >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+    }
+    return values;
+}
+
+// what Model::convertMesh did before the kernels: a branch per attribute and a push_back per vertex
+void convertPushBack(const rg::VertexStreams& streams, std::vector<float>& out) {
+    std::vector<float> vertices;
+    for (size_t i = 0; i < streams.count; ++i) {
+        float vertex[rg::VERTEX_FLOATS] = {};
+        std::memcpy(vertex, streams.position + i * 3, 3 * sizeof(float));
+        if (streams.normal)
+            std::memcpy(vertex + 3, streams.normal + i * 3, 3 * sizeof(float));
+        if (streams.texCoord) {
+            std::memcpy(vertex + 6, streams.texCoord + i * 3, 2 * sizeof(float));
+            if (streams.tangent)
+                std::memcpy(vertex + 8, streams.tangent + i * 3, 3 * sizeof(float));
+            if (streams.bitangent)
+                std::memcpy(vertex + 11, streams.bitangent + i * 3, 3 * sizeof(float));
+        }
+        vertices.insert(vertices.end(), vertex, vertex + rg::VERTEX_FLOATS);
+    }
+    out.swap(vertices);
+}
+
+double convertAll(rg::VertexKernel kernel, const std::vector<rg::VertexStreams>& meshes, std::vector<std::vector<float>>& out) {
+    double best = 1e30;
+    for (int run = 0; run < 10; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            if (kernel)
+                kernel(meshes[i], out[i].data(), 0, meshes[i].count);
+            else
+                convertPushBack(meshes[i], out[i]);
+        }
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "resources/objects/church/aberkios_100k_texture.obj";
+    Assimp::Importer importer;
+    importer.SetIOHandler(new rg::MappedIOSystem);
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+
+    std::vector<rg::VertexStreams> meshes;
+    SyntheticMesh synthetic;
+    if (scene && scene->mRootNode && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+        for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+            const aiMesh* mesh = scene->mMeshes[i];
+            rg::VertexStreams streams;
+            streams.position = mesh->mVertices ? &mesh->mVertices[0].x : nullptr;
+            streams.normal = mesh->mNormals ? &mesh->mNormals[0].x : nullptr;
+            if (mesh->mTextureCoords[0]) {
+                streams.texCoord = &mesh->mTextureCoords[0][0].x;
+                streams.tangent = mesh->mTangents ? &mesh->mTangents[0].x : nullptr;
+                streams.bitangent = mesh->mBitangents ? &mesh->mBitangents[0].x : nullptr;
+            }
+            streams.count = mesh->mNumVertices;
+            meshes.push_back(streams);
+        }
+        std::printf("%s: %u meshes\n", path.c_str(), scene->mNumMeshes);
+    } else {
+        const size_t count = 1 << 20;
+        synthetic.position = noise(count * 3, 1);
+        synthetic.normal = noise(count * 3, 2);
+        synthetic.texCoord = noise(count * 3, 3);
+        synthetic.tangent = noise(count * 3, 4);
+        synthetic.bitangent = noise(count * 3, 5);
+        rg::VertexStreams streams;
+        streams.position = synthetic.position.data();
+        streams.normal = synthetic.normal.data();
+        streams.texCoord = synthetic.texCoord.data();
+        streams.tangent = synthetic.tangent.data();
+        streams.bitangent = synthetic.bitangent.data();
+        streams.count = count;
+        meshes.push_back(streams);
+        // the same mesh without normals and tangents, through the zero stride path
+        streams.normal = streams.tangent = streams.bitangent = nullptr;
+        meshes.push_back(streams);
+        std::printf("%s could not be loaded, using a synthetic %zu vertex mesh\n", path.c_str(), count);
+    }
+
+    size_t vertexCount = 0;
+    std::vector<std::vector<float>> reference(meshes.size()), out(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        vertexCount += meshes[i].count;
+        reference[i].assign(meshes[i].count * rg::VERTEX_FLOATS, 0.0f);
+        out[i].assign(meshes[i].count * rg::VERTEX_FLOATS, 0.0f);
+    }
+    std::printf("%zu vertices, %.1f MB of Vertex, best of 10 on one thread\n\n", vertexCount,
+                vertexCount * rg::VERTEX_FLOATS * sizeof(float) / (1024.0 * 1024.0));
+
+    // the previous loop first, every row is checked against its output
+    std::vector<rg::VertexKernelInfo> kernels = {{"push_back", nullptr}};
+    kernels.insert(kernels.end(), rg::vertexKernels().begin(), rg::vertexKernels().end());
+    kernels.push_back({"dispatch", rg::convertVertices});
+    double baseline = convertAll(nullptr, meshes, reference);
+    std::printf("%-10s %10s %12s %10s %9s\n", "kernel", "ms", "Mvertex/s", "GB/s out", "speedup");
+    for (const rg::VertexKernelInfo& info : kernels) {
+        double ms = info.kernel ? convertAll(info.kernel, meshes, out) : baseline;
+        bool same = true;
+        for (size_t i = 0; i < meshes.size() && info.kernel; ++i)
+            same = same && std::memcmp(out[i].data(), reference[i].data(), out[i].size() * sizeof(float)) == 0;
+        std::printf("%-10s %10.2f %12.1f %10.2f %8.2fx%s\n", info.name, ms, vertexCount / ms / 1000.0,
+                    vertexCount * rg::VERTEX_FLOATS * sizeof(float) / ms / 1e6, baseline / ms, same ? "" : "  MISMATCH");
+    }
+    return 0;
+}
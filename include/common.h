@@ -5,19 +5,19 @@
 #ifndef PROJECT_BASE_COMMON_H
 #define PROJECT_BASE_COMMON_H
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <rg/MappedFile.h>
 
+// one copy, from the mapping into the string; callers that can take a pointer and a length should map instead
 std::string readFileContents(std::string path) {
-    std::ifstream in(path);
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    return buffer.str();
+    std::shared_ptr<rg::MappedFile> file = rg::mapAsset(path);
+    if (file->size() == 0)
+        return std::string();
+    rg::recordAssetIO(path, 0, file->size(), 0.0);
+    return std::string((const char*)file->data(), file->size());
 }
 
 void appendShaderFolderIfNotPresent(std::string& path) {
-    std::ifstream file(path);
-    if (!file) {
+    if (!rg::fileExists(path)) {
         path = "resources/shaders/" + path;
     }
 }
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cstdlib>
+#include <memory>
+#include <rg/AssetPack.h>
 #include "root_directory.h" // This is a configuration file generated by CMake.
 
 class FileSystem
@@ -17,7 +19,31 @@ public:
     return (*pathBuilder)(path);
   }
 
+  // Serves the files packed into archive (see the pack_assets target) in place of the loose ones under
+  // the root; anything the archive doesn't hold, or whose loose file is newer, is still read from disk.
+  // Returns false and leaves the loose files in use when there is no valid archive.
+  static bool mountArchive(const std::string& archive)
+  {
+    std::unique_ptr<AssetPack> pack(new AssetPack(archive, getPath(".")));
+    if (!pack->valid())
+      return false;
+    rg::mountAssetSource(pack.get());
+    mountedArchive() = std::move(pack);
+    return true;
+  }
+
+  static const AssetPack* getArchive()
+  {
+    return mountedArchive().get();
+  }
+
 private:
+  static std::unique_ptr<AssetPack>& mountedArchive()
+  {
+    static std::unique_ptr<AssetPack> archive;
+    return archive;
+  }
+
   static std::string const & getRoot()
   {
     static char const * envRoot = getenv("LOGL_ROOT_PATH");
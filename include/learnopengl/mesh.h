@@ -7,7 +7,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/GeometryPool.h>
+#include <rg/Material.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 using namespace std;
@@ -27,9 +31,21 @@ struct Vertex {
 
 
 
+// layout of Vertex as seen by setupMesh, used by pools that share one VAO between meshes
+inline VertexFormat MeshVertexFormat()
+{
+    return VertexFormat{sizeof(Vertex), {
+            {0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position)},
+            {1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal)},
+            {2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords)},
+            {3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent)},
+            {4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent)}
+    }};
+}
+
 struct Texture {
     unsigned int id;
-    string type;
+    TextureSlot slot = BaseColorTexture;
     string path;
 };
 
@@ -39,67 +55,189 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // index into rg::materials(), meshes with equal materials and textures share it
+    unsigned int materialId = 0;
 
     unsigned int VAO;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // set when the mesh lives in a shared pool instead of its own buffers
+    GeometryPool* pool = nullptr;
+    GeometryRange range;
+    // object space bounding box, used for culling
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // texture coordinate units per object space unit, averaged over the surface
+    float uvDensity;
+    // constructor, with deferUpload only the GPU storage is created and the data follows through UploadChunk
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, GeometryPool* pool = nullptr,
+         bool deferUpload = false)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->pool = pool;
 
+        calculateBounds();
+        calculateUVDensity();
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(!deferUpload);
+        // a pooled mesh without vertices or faces has no range and nothing to upload
+        if(!deferUpload || (pool && !range.valid()))
+        {
+            uploadedVertices = this->vertices.size();
+            uploadedIndices = this->indices.size();
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // uploads the next part of a deferred mesh, at most budgetBytes (but always some progress); returns bytes written
+    size_t UploadChunk(size_t budgetBytes)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        size_t written = 0;
+        if(uploadedVertices < vertices.size())
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            size_t count = std::min(vertices.size() - uploadedVertices, std::max<size_t>(budgetBytes / sizeof(Vertex), 1));
+            if(pool)
+                pool->uploadVertices(range, uploadedVertices, &vertices[uploadedVertices], count);
+            else
+                bufferSubData(VBO, uploadedVertices * sizeof(Vertex), count * sizeof(Vertex), &vertices[uploadedVertices]);
+            uploadedVertices += count;
+            written += count * sizeof(Vertex);
         }
+        if(uploadedIndices < indices.size() && written < budgetBytes)
+        {
+            size_t count = std::min(indices.size() - uploadedIndices,
+                                    std::max<size_t>((budgetBytes - written) / sizeof(unsigned int), 1));
+            if(pool)
+                pool->uploadIndices(range, uploadedIndices, &indices[uploadedIndices], count);
+            else
+                bufferSubData(EBO, uploadedIndices * sizeof(unsigned int), count * sizeof(unsigned int), &indices[uploadedIndices]);
+            uploadedIndices += count;
+            written += count * sizeof(unsigned int);
+        }
+        return written;
+    }
 
+    bool Uploaded() const
+    {
+        return uploadedVertices == vertices.size() && uploadedIndices == indices.size();
+    }
 
+    size_t SizeInBytes() const
+    {
+        return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // registers the material, with the mask of the slots this mesh has textures in, and keeps its id
+    void SetMaterial(Material material)
+    {
+        GLuint ids[TextureSlotCount] = {};
+        material.textureMask = 0;
+        for(const Texture& texture : textures)
+        {
+            ids[texture.slot] = texture.id;
+            material.textureMask |= 1u << texture.slot;
+        }
+        materialId = rg::materials().add(material, ids);
+    }
+
+    // render the mesh, pooled meshes drawn in a batch can skip binding the shared VAO
+    void Draw(Shader &shader, bool bindVertexArray = true)
+    {
+        BindTextures(shader);
+        DrawGeometry(bindVertexArray);
+    }
+
+    // draws without binding textures, for meshes following one of the same material
+    void DrawGeometry(bool bindVertexArray = true)
+    {
+        if(pool)
+        {
+            if(bindVertexArray)
+                pool->bind();
+            pool->draw(range);
+        }
+        else
+        {
+            glBindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+        }
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // binds every texture to the unit of its slot and selects the material in the shader's MaterialBlock
+    void BindTextures(Shader &shader)
+    {
+        for(const Texture& texture : textures)
+        {
+            glActiveTexture(GL_TEXTURE0 + texture.slot);
+            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + TEXTURE_SLOT_NAMES[texture.slot]).c_str()), texture.slot);
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+        }
+        glUniform1i(glGetUniformLocation(shader.ID, "materialIndex"), (GLint)materialId);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
 private:
     // render data
     unsigned int VBO, EBO;
+    size_t uploadedVertices = 0;
+    size_t uploadedIndices = 0;
+
+    static void bufferSubData(unsigned int buffer, size_t offset, size_t bytes, const void* data)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    void calculateBounds()
     {
+        boundsMin = glm::vec3(0.0f);
+        boundsMax = glm::vec3(0.0f);
+        if(vertices.empty())
+            return;
+        boundsMin = boundsMax = vertices[0].Position;
+        for(const Vertex& vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+    }
+
+    // sqrt of the ratio of total UV area to total surface area, i.e. how much of the texture one unit of surface covers
+    void calculateUVDensity()
+    {
+        double surfaceArea = 0.0, uvArea = 0.0;
+        for(size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const Vertex& a = vertices[indices[i]];
+            const Vertex& b = vertices[indices[i + 1]];
+            const Vertex& c = vertices[indices[i + 2]];
+            surfaceArea += 0.5 * glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+            glm::vec2 du = b.TexCoords - a.TexCoords, dv = c.TexCoords - a.TexCoords;
+            uvArea += 0.5 * std::abs(du.x * dv.y - du.y * dv.x);
+        }
+        uvDensity = surfaceArea > 0.0 ? (float)std::sqrt(uvArea / surfaceArea) : 0.0f;
+    }
+
+    // initializes all the buffer objects/arrays, without data when the upload is deferred
+    void setupMesh(bool withData = true)
+    {
+        if(pool)
+        {
+            // an empty mesh keeps the default range, which draws and releases nothing
+            if(!vertices.empty() && !indices.empty())
+                range = withData ? pool->allocate(vertices.data(), vertices.size(), indices.data(), indices.size())
+                                 : pool->reserve(vertices.size(), indices.size());
+            VAO = pool->getVAO();
+            VBO = pool->getVertexBuffer();
+            EBO = pool->getIndexBuffer();
+            return;
+        }
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -111,10 +249,10 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), withData ? vertices.data() : nullptr, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), withData ? indices.data() : nullptr, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
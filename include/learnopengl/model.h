@@ -12,18 +12,56 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
-
+#include <rg/AssetIO.h>
+#include <rg/GeometryPool.h>
+#include <rg/JobSystem.h>
+#include <rg/Material.h>
+#include <rg/TextureCompression.h>
+#include <rg/TextureStreamer.h>
+#include <rg/VertexConvert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// a texture referenced by a material, before it is loaded
+struct TextureRef {
+    TextureSlot slot;
+    string path;
+};
+
+// CPU side result of converting one aiMesh; producing it makes no GL calls, so it can run on any thread
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<TextureRef> textures;
+    Material material;
+};
+
+// texture prepared on a worker thread, uploaded later by the thread that owns the GL context; either
+// block compressed with its mips, or pixels decoded by stb_image when compression isn't available
+struct TextureData {
+    string path;
+    rg::CompressedImage compressed;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char *pixels = nullptr;
+};
 
+class AsyncModel;
 
 class Model
 {
@@ -33,31 +71,109 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // when set, meshes are suballocated from the shared pool instead of owning their buffers
+    GeometryPool* pool;
+    std::string glslIdentifierPrefix;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, GeometryPool* pool = nullptr) : gammaCorrection(gamma), pool(pool)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
+    // starts importing on a worker thread and returns immediately, the render thread finishes the
+    // load through AsyncModel::Update; without loadTextures the material textures are left to the caller
+    static std::shared_ptr<AsyncModel> LoadAsync(string const &path, bool gamma = false, GeometryPool* pool = nullptr,
+                                                 bool loadTextures = true);
+
+    // draws the model, and thus all its meshes, grouped by material so each group binds its textures once
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        if(drawOrder.size() != meshes.size())
+        {
+            drawOrder.resize(meshes.size());
+            for(unsigned int i = 0; i < drawOrder.size(); i++)
+                drawOrder[i] = i;
+            std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b)
+            {
+                return meshes[a].materialId < meshes[b].materialId;
+            });
+        }
+        // every mesh shares the pool's VAO, so it is bound once for the whole model
+        if(pool)
+            pool->bind();
+        for(unsigned int i = 0; i < drawOrder.size(); i++)
+        {
+            Mesh &mesh = meshes[drawOrder[i]];
+            // id 0 is shared by every mesh past the table's capacity, those bind their own textures
+            if(i == 0 || mesh.materialId == 0 || mesh.materialId != meshes[drawOrder[i - 1]].materialId)
+                mesh.BindTextures(shader);
+            mesh.DrawGeometry(!pool);
+        }
+        if(pool)
+            glBindVertexArray(0);
+    }
+
+    // tells the streamer how large this model's textures appear when drawn with the given transform
+    void NoteTextureUsage(TextureStreamer &streamer, const glm::mat4 &transform) const
+    {
+        vector<GLuint> ids;
+        for(const Mesh& mesh : meshes)
+        {
+            ids.clear();
+            for(const Texture& texture : mesh.textures)
+                ids.push_back(texture.id);
+            streamer.noteMeshUsage(mesh.boundsMin, mesh.boundsMax, mesh.uvDensity, transform, ids.data(), ids.size());
+        }
+    }
+
+    // returns the pooled vertex/index ranges to the pool's free lists
+    void ReleaseGeometry()
+    {
+        if(!pool)
+            return;
+        for (Mesh& mesh: meshes)
+            pool->release(mesh.range);
+    }
+
+    // model space box around the meshes uploaded so far, false while there are none
+    bool GetBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const
+    {
+        if(meshes.empty())
+            return false;
+        boundsMin = meshes[0].boundsMin;
+        boundsMax = meshes[0].boundsMax;
+        for(const Mesh &mesh : meshes)
+        {
+            boundsMin = glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = glm::max(boundsMax, mesh.boundsMax);
+        }
+        return true;
     }
 
     void SetShaderTextureNamePrefix(std::string prefix) {
+        glslIdentifierPrefix = prefix;
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
     }
 private:
+    friend class AsyncModel;
+
+    // mesh indices sorted by material id, rebuilt when meshes are added
+    vector<unsigned int> drawOrder;
+
+    // an empty model that AsyncModel fills mesh by mesh
+    Model(bool gamma, GeometryPool* pool) : gammaCorrection(gamma), pool(pool)
+    {
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
-        // read file via ASSIMP
+        // read file via ASSIMP, the importer reads the model and its material files through mappings
         Assimp::Importer importer;
+        importer.SetIOHandler(new rg::MappedIOSystem);
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
@@ -72,150 +188,555 @@ private:
         processNode(scene->mRootNode, scene);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+    // converts every mesh in the scene on the job pool, then creates the GL objects on this thread in the
+    // original node order
     void processNode(aiNode *node, const aiScene *scene)
     {
-        // process each mesh located at the current node
+        vector<aiMesh*> sceneMeshes;
+        collectMeshes(node, scene, sceneMeshes);
+        vector<MeshData> converted = convertMeshes(sceneMeshes, scene);
+        meshes.reserve(meshes.size() + converted.size());
+        for(MeshData &data : converted)
+            meshes.push_back(processMesh(std::move(data)));
+    }
+
+    // flattens the node hierarchy into the list of meshes to convert, depth first like the old recursive walk
+    static void collectMeshes(aiNode *node, const aiScene *scene, vector<aiMesh*> &out)
+    {
+        // the node object only contains indices to index the actual objects in the scene.
+        // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
+            out.push_back(scene->mMeshes[node->mMeshes[i]]);
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+            collectMeshes(node->mChildren[i], scene, out);
+    }
+
+    // the serial GL half: textures and buffers for one converted mesh
+    Mesh processMesh(MeshData data)
+    {
+        vector<Texture> textures = loadTextures(data.textures);
+
+        // return a mesh object created from the extracted mesh data
+        Mesh result(std::move(data.vertices), std::move(data.indices), std::move(textures), pool);
+        result.SetMaterial(data.material);
+        result.glslIdentifierPrefix = glslIdentifierPrefix;
+        return result;
+    }
+
+public:
+    // one job per mesh; each also splits its own vertices and faces, so a model that is a single huge
+    // mesh still spreads over the pool
+    static vector<MeshData> convertMeshes(const vector<aiMesh*> &sceneMeshes, const aiScene *scene, JobSystem &jobs = rg::jobs())
+    {
+        vector<MeshData> converted(sceneMeshes.size());
+        jobs.parallelFor(sceneMeshes.size(), [&](size_t begin, size_t end)
         {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            for(size_t i = begin; i < end; i++)
+                converted[i] = convertMesh(sceneMeshes[i], scene, jobs);
+        }, 1);
+        return converted;
+    }
+
+    // the CPU side of processMesh, touches no GL state so any thread may run it. The vertex and index
+    // arrays are sized from mNumVertices / mNumFaces up front and filled in place
+    static MeshData convertMesh(aiMesh *mesh, const aiScene *scene, JobSystem &jobs = rg::jobs())
+    {
+        // below this many vertices or faces a chunk isn't worth a job
+        const size_t CONVERT_GRAIN = 16384;
+
+        // data to fill
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+
+        // walk through each of the mesh's vertices; what the mesh lacks is left zero. The kernel for this CPU
+        // transposes Assimp's separate arrays into Vertex in bulk
+        static_assert(sizeof(Vertex) == rg::VERTEX_FLOATS * sizeof(float), "Vertex must match the conversion kernels");
+        static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Assimp built with double precision");
+        vertices.resize(mesh->mNumVertices);
+        rg::VertexStreams streams;
+        streams.position = mesh->mVertices ? &mesh->mVertices[0].x : nullptr;
+        streams.normal = mesh->HasNormals() ? &mesh->mNormals[0].x : nullptr;
+        // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+        // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+        if(mesh->mTextureCoords[0])
+        {
+            streams.texCoord = &mesh->mTextureCoords[0][0].x;
+            streams.tangent = mesh->mTangents ? &mesh->mTangents[0].x : nullptr;
+            streams.bitangent = mesh->mBitangents ? &mesh->mBitangents[0].x : nullptr;
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        streams.count = mesh->mNumVertices;
+        float *out = &vertices.data()->Position.x;
+        jobs.parallelFor(mesh->mNumVertices, [&](size_t begin, size_t end)
+        {
+            rg::convertVertices(streams, out, begin, end);
+        }, CONVERT_GRAIN);
+
+        // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // Triangulated meshes put face i at 3 * i and are filled in parallel, anything else in one pass
+        size_t indexCount = 0;
+        bool triangles = true;
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            indexCount += mesh->mFaces[i].mNumIndices;
+            triangles = triangles && mesh->mFaces[i].mNumIndices == 3;
+        }
+        indices.resize(indexCount);
+        if(triangles)
         {
-            processNode(node->mChildren[i], scene);
+            jobs.parallelFor(mesh->mNumFaces, [&](size_t begin, size_t end)
+            {
+                for(size_t i = begin; i < end; i++)
+                {
+                    const aiFace &face = mesh->mFaces[i];
+                    indices[i * 3] = face.mIndices[0];
+                    indices[i * 3 + 1] = face.mIndices[1];
+                    indices[i * 3 + 2] = face.mIndices[2];
+                }
+            }, CONVERT_GRAIN);
+        }
+        else
+        {
+            size_t offset = 0;
+            for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+            {
+                const aiFace &face = mesh->mFaces[i];
+                std::copy(face.mIndices, face.mIndices + face.mNumIndices, indices.begin() + offset);
+                offset += face.mNumIndices;
+            }
         }
 
+        // process materials
+        data.material = convertMaterial(scene->mMaterials[mesh->mMaterialIndex], data.textures);
+
+        return data;
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // The PBR factors of the material and a texture per slot. Formats without PBR properties (Wavefront)
+    // keep the defaults for metalness and get a roughness from their Phong exponent.
+    static Material convertMaterial(aiMaterial *mat, vector<TextureRef> &textures)
+    {
+        Material material;
+        aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+        mat->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+        float opacity = 1.0f;
+        mat->Get(AI_MATKEY_OPACITY, opacity);
+        material.baseColor = glm::vec4(diffuse.r, diffuse.g, diffuse.b, opacity);
+
+        aiColor3D emissive(0.0f, 0.0f, 0.0f);
+        mat->Get(AI_MATKEY_COLOR_EMISSIVE, emissive);
+        float emissiveIntensity = 1.0f;
+        // a Phong exponent n is about a GGX alpha of sqrt(2 / (n + 2)), and roughness is sqrt(alpha)
+        float shininess = 0.0f;
+        mat->Get(AI_MATKEY_SHININESS, shininess);
+        material.roughness = std::sqrt(std::sqrt(2.0f / (std::max(shininess, 0.0f) + 2.0f)));
+        // the PBR keys arrived with Assimp 5.1
+#ifdef AI_MATKEY_BASE_COLOR
+        aiColor4D baseColor;
+        if(mat->Get(AI_MATKEY_BASE_COLOR, baseColor) == aiReturn_SUCCESS)
+            material.baseColor = glm::vec4(baseColor.r, baseColor.g, baseColor.b, baseColor.a);
+#endif
+#ifdef AI_MATKEY_EMISSIVE_INTENSITY
+        mat->Get(AI_MATKEY_EMISSIVE_INTENSITY, emissiveIntensity);
+#endif
+#ifdef AI_MATKEY_ROUGHNESS_FACTOR
+        mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, material.roughness);
+#endif
+#ifdef AI_MATKEY_METALLIC_FACTOR
+        mat->Get(AI_MATKEY_METALLIC_FACTOR, material.metalness);
+#endif
+        material.emissive = glm::vec3(emissive.r, emissive.g, emissive.b) * emissiveIntensity;
+
+        // the PBR texture types win over the older ones that stand in for them
+        if(!collectMaterialTexture(mat, aiTextureType_BASE_COLOR, BaseColorTexture, textures))
+            collectMaterialTexture(mat, aiTextureType_DIFFUSE, BaseColorTexture, textures);
+        collectMaterialTexture(mat, aiTextureType_SPECULAR, SpecularTexture, textures);
+        // Wavefront bump maps are imported as height maps, they have always been read as normal maps
+        if(!collectMaterialTexture(mat, aiTextureType_NORMALS, NormalTexture, textures))
+            collectMaterialTexture(mat, aiTextureType_HEIGHT, NormalTexture, textures);
+        collectMaterialTexture(mat, aiTextureType_AMBIENT, HeightTexture, textures);
+        // only a combined glTF map, which Assimp reports as metalness (and as roughness too); a roughness only
+        // map has no metalness in blue, read as one it would turn the surface metallic
+        collectMaterialTexture(mat, aiTextureType_METALNESS, MetallicRoughnessTexture, textures);
+        if(!collectMaterialTexture(mat, aiTextureType_EMISSION_COLOR, EmissiveTexture, textures))
+            collectMaterialTexture(mat, aiTextureType_EMISSIVE, EmissiveTexture, textures);
+        return material;
+    }
+
+private:
+    // the first texture of the type goes into the slot; false when the material has none of the type
+    static bool collectMaterialTexture(aiMaterial *mat, aiTextureType type, TextureSlot slot, vector<TextureRef> &out)
+    {
+        if(mat->GetTextureCount(type) == 0)
+            return false;
+        aiString str;
+        mat->GetTexture(type, 0, &str);
+        out.push_back({slot, str.C_Str()});
+        return true;
+    }
+
+    // loads the referenced textures that aren't loaded yet; the required info is returned as Texture structs.
+    vector<Texture> loadTextures(const vector<TextureRef> &refs)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
         vector<Texture> textures;
+        for(const TextureRef &ref : refs)
+        {
+            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
+            const Texture *loaded = findLoadedTexture(ref.path);
+            if(loaded)
+            {
+                Texture texture = *loaded;
+                texture.slot = ref.slot;
+                textures.push_back(texture);
+                continue;
+            }
+            // if texture hasn't been loaded already, load it
+            Texture texture;
+            texture.id = TextureFromFile(ref.path.c_str(), this->directory);
+            texture.slot = ref.slot;
+            texture.path = ref.path;
+            textures.push_back(texture);
+            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        }
+        return textures;
+    }
+
+    const Texture *findLoadedTexture(const string &path) const
+    {
+        for(const Texture &texture : textures_loaded)
+            if(texture.path == path)
+                return &texture;
+        return nullptr;
+    }
+};
+
+// Handle to a model that is being loaded in the background. Assimp import, mesh conversion and
+// texture decoding run on a worker thread; the GL uploads are time sliced on the render thread by
+// calling Update with a byte budget every frame. Meshes appear in get().meshes as soon as they are
+// fully uploaded, so the model can be drawn progressively.
+class AsyncModel
+{
+public:
+    enum State { Importing, Uploading, Ready, Failed };
+
+    AsyncModel(string const &path, bool gamma, GeometryPool* pool, bool loadTextures)
+            : path(path), loadTextures(loadTextures), model(gamma, pool)
+    {
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    ~AsyncModel()
+    {
+        for(TextureData &texture : decodedTextures)
+            stbi_image_free(texture.pixels);
+    }
+
+    AsyncModel(const AsyncModel&) = delete;
+    AsyncModel& operator=(const AsyncModel&) = delete;
 
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+    // render thread: performs at most budgetBytes of uploads (always at least one step) and returns
+    // the bytes actually written
+    size_t Update(size_t budgetBytes)
+    {
+        State current = state.load(std::memory_order_acquire);
+        if(current == Failed && !errorReported)
+        {
+            cout << "ERROR::ASSIMP:: " << error << endl;
+            errorReported = true;
+        }
+        if(current != Uploading)
+            return 0;
+
+        size_t written = 0;
+        do
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
+            if(textureCursor < decodedTextures.size())
+                written += uploadTextureRows(decodedTextures[textureCursor], budgetBytes - written);
+            else if(meshCursor < meshData.size())
+                written += uploadMesh(budgetBytes - written);
+            else
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                meshData.clear();
+                decodedTextures.clear();
+                loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+                state.store(Ready, std::memory_order_release);
+                break;
             }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+        } while(written < budgetBytes);
+        uploadedBytes += written;
+        return written;
+    }
+
+    State GetState() const { return state.load(std::memory_order_acquire); }
+    bool IsReady() const { return GetState() == Ready; }
+
+    // fraction of the GPU upload done, 0 while still importing
+    float Progress() const
+    {
+        State current = GetState();
+        if(current == Ready)
+            return 1.0f;
+        if(current != Uploading || totalBytes == 0)
+            return 0.0f;
+        return (float)uploadedBytes / (float)totalBytes;
+    }
+
+    // seconds from LoadAsync until the model became ready
+    double LoadSeconds() const { return loadSeconds; }
+
+    // worker side of the load: Assimp reading the file, and converting its meshes on the job pool
+    double ReadSeconds() const { return readSeconds; }
+    double ConvertSeconds() const { return convertSeconds; }
+
+    // the model as far as it has been uploaded, render thread only
+    Model &get() { return model; }
+
+private:
+    friend class Model;
+
+    string path;
+    bool loadTextures;
+    Model model;
+    std::atomic<State> state{Importing};
+    string error;
+    bool errorReported = false;
+
+    // filled by the worker before it switches the state to Uploading
+    vector<MeshData> meshData;
+    vector<TextureData> decodedTextures;
+    size_t totalBytes = 0;
+
+    // render thread upload progress
+    size_t textureCursor = 0;
+    int textureRowsUploaded = 0;
+    unsigned int textureId = 0;
+    size_t meshCursor = 0;
+    std::unique_ptr<Mesh> pendingMesh;
+    size_t uploadedBytes = 0;
+
+    std::chrono::steady_clock::time_point startTime;
+    double loadSeconds = 0.0;
+    double readSeconds = 0.0;
+    double convertSeconds = 0.0;
+
+    // worker thread: everything that doesn't need the GL context
+    void import()
+    {
+        auto readStart = std::chrono::steady_clock::now();
+        Assimp::Importer importer;
+        importer.SetIOHandler(new rg::MappedIOSystem);
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            error = importer.GetErrorString();
+            state.store(Failed, std::memory_order_release);
+            return;
+        }
+        model.directory = path.substr(0, path.find_last_of('/'));
+        auto convertStart = std::chrono::steady_clock::now();
+        readSeconds = std::chrono::duration<double>(convertStart - readStart).count();
+        vector<aiMesh*> sceneMeshes;
+        Model::collectMeshes(scene->mRootNode, scene, sceneMeshes);
+        meshData = Model::convertMeshes(sceneMeshes, scene);
+        convertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - convertStart).count();
+
+        for(const MeshData &data : meshData)
+        {
+            totalBytes += data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int);
+            if(!loadTextures)
+                continue;
+            for(const TextureRef &ref : data.textures)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                bool listed = false;
+                for(const TextureData &texture : decodedTextures)
+                    listed = listed || texture.path == ref.path;
+                if(!listed)
+                {
+                    decodedTextures.emplace_back();
+                    decodedTextures.back().path = ref.path;
+                }
             }
+        }
+
+        // every texture is decoded (or encoded on a cache miss) as a job of its own
+        rg::jobs().parallelFor(decodedTextures.size(), [this](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+                decodeTexture(decodedTextures[i]);
+        }, 1);
+        for(const TextureData &texture : decodedTextures)
+        {
+            if(texture.compressed.valid())
+                totalBytes += texture.compressed.sizeInBytes();
             else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                totalBytes += (size_t)texture.width * texture.height * texture.components;
+        }
+        state.store(Uploading, std::memory_order_release);
+    }
+
+    void decodeTexture(TextureData &texture)
+    {
+        string filename = model.directory + '/' + texture.path;
+        if(rg::loadCompressedImage(filename, texture.compressed))
+            return;
+        texture.compressed.levels.clear();
+        texture.pixels = rg::loadImage(filename, &texture.width, &texture.height, &texture.components, 0);
+        if(!texture.pixels)
+            std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+    }
 
-            vertices.push_back(vertex);
+    // compressed textures go up a mip level at a time, smallest first, so the texture is complete
+    // (and sampled at reduced detail) from the first step on
+    size_t uploadCompressedLevels(TextureData &texture, size_t budgetBytes)
+    {
+        rg::CompressedImage &image = texture.compressed;
+        if(textureRowsUploaded == 0)
+        {
+            glGenTextures(1, &textureId);
+            glBindTexture(GL_TEXTURE_2D, textureId);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+
+            Texture loaded;
+            loaded.id = textureId;
+            loaded.path = texture.path;
+            model.textures_loaded.push_back(loaded);
+
+            // the streamer uploads the coarse levels now and the rest once the texture is seen
+            if(rg::textureStreamer())
+            {
+                size_t written = rg::textureStreamer()->add(textureId, std::move(image));
+                image.levels.clear();
+                textureCursor++;
+                return written;
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, textureId);
 
+        // textureRowsUploaded counts levels here
+        size_t written = 0;
+        while(textureRowsUploaded < (int)image.levels.size() && (written == 0 || written < budgetBytes))
+        {
+            size_t level = image.levels.size() - 1 - textureRowsUploaded;
+            rg::uploadCompressedLevels(image, GL_TEXTURE_2D, level, 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+            written += image.levels[level].data.size();
+            textureRowsUploaded++;
+        }
 
+        if(textureRowsUploaded == (int)image.levels.size())
+        {
+            image.levels.clear();
+            textureRowsUploaded = 0;
+            textureCursor++;
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        return written;
+    }
+
+    // uploads a band of rows of the current texture, mipmaps are generated once the last row is in
+    size_t uploadTextureRows(TextureData &texture, size_t budgetBytes)
+    {
+        if(texture.compressed.valid())
+            return uploadCompressedLevels(texture, budgetBytes);
+        if(!texture.pixels)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            // keep the same fallback as TextureFromFile: an empty texture object
+            Texture failed;
+            glGenTextures(1, &failed.id);
+            failed.path = texture.path;
+            model.textures_loaded.push_back(failed);
+            textureCursor++;
+            return 0;
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
+        GLenum format = GL_RGB;
+        if (texture.components == 1)
+            format = GL_RED;
+        else if (texture.components == 3)
+            format = GL_RGB;
+        else if (texture.components == 4)
+            format = GL_RGBA;
 
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if(textureRowsUploaded == 0)
+        {
+            glGenTextures(1, &textureId);
+            glBindTexture(GL_TEXTURE_2D, textureId);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, textureId);
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        size_t rowBytes = (size_t)texture.width * texture.components;
+        int rows = (int)std::min<size_t>(texture.height - textureRowsUploaded, std::max<size_t>(budgetBytes / rowBytes, 1));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, textureRowsUploaded, texture.width, rows, format, GL_UNSIGNED_BYTE,
+                        texture.pixels + textureRowsUploaded * rowBytes);
+        textureRowsUploaded += rows;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        if(textureRowsUploaded == texture.height)
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            Texture loaded;
+            loaded.id = textureId;
+            loaded.path = texture.path;
+            model.textures_loaded.push_back(loaded);
+
+            stbi_image_free(texture.pixels);
+            texture.pixels = nullptr;
+            textureRowsUploaded = 0;
+            textureCursor++;
+        }
+        return rows * rowBytes;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // uploads part of the current mesh, a finished mesh is moved into the model
+    size_t uploadMesh(size_t budgetBytes)
     {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        if(!pendingMesh)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            MeshData &data = meshData[meshCursor];
+            vector<Texture> textures;
+            for(const TextureRef &ref : data.textures)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
+                const Texture *loaded = model.findLoadedTexture(ref.path);
+                if(!loaded)
+                    continue;
+                Texture texture = *loaded;
+                texture.slot = ref.slot;
                 textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
             }
+            pendingMesh.reset(new Mesh(std::move(data.vertices), std::move(data.indices), std::move(textures), model.pool, true));
+            pendingMesh->SetMaterial(data.material);
         }
-        return textures;
+
+        size_t written = pendingMesh->UploadChunk(budgetBytes);
+        if(pendingMesh->Uploaded())
+        {
+            pendingMesh->glslIdentifierPrefix = model.glslIdentifierPrefix;
+            model.meshes.push_back(std::move(*pendingMesh));
+            pendingMesh.reset();
+            meshCursor++;
+        }
+        return written;
     }
 };
 
+inline std::shared_ptr<AsyncModel> Model::LoadAsync(string const &path, bool gamma, GeometryPool* pool, bool loadTextures)
+{
+    std::shared_ptr<AsyncModel> handle = std::make_shared<AsyncModel>(path, gamma, pool, loadTextures);
+    // the job holds its own reference, so dropping the handle early is safe
+    rg::jobs().run([handle]() { handle->import(); });
+    return handle;
+}
+
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
 {
@@ -225,8 +746,24 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
+    rg::CompressedImage compressed;
+    if (rg::loadCompressedImage(filename, compressed))
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        if (rg::textureStreamer())
+            rg::textureStreamer()->add(textureID, std::move(compressed));
+        else
+            rg::uploadCompressedImage(compressed);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char *data = rg::loadImage(filename, &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
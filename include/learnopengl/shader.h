@@ -23,70 +23,46 @@ public:
         appendShaderFolderIfNotPresent(fragmentPathString);
         vertexPath = vertexPathString.c_str();
         fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        // 1. map the vertex/fragment source files, the driver reads the code straight from the mappings
+        std::shared_ptr<rg::MappedFile> vertexFile = rg::mapAsset(vertexPathString);
+        std::shared_ptr<rg::MappedFile> fragmentFile = rg::mapAsset(fragmentPathString);
+        std::shared_ptr<rg::MappedFile> geometryFile;
+        // if geometry shader path is present, also load a geometry shader
+        if(geometryPath != nullptr)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                appendShaderFolderIfNotPresent(geometryPathString);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            std::string geometryPathString(geometryPath);
+            appendShaderFolderIfNotPresent(geometryPathString);
+            geometryFile = rg::mapAsset(geometryPathString);
         }
-        catch (std::ifstream::failure& e)
+        if (!vertexFile->valid() || !fragmentFile->valid() || (geometryFile && !geometryFile->valid()))
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
+        const char* vShaderCode = vertexFile->size() ? (const char*)vertexFile->data() : "";
+        const char* fShaderCode = fragmentFile->size() ? (const char*)fragmentFile->data() : "";
+        // the mappings aren't null terminated, so the lengths are passed along
+        GLint vShaderLength = (GLint)vertexFile->size();
+        GLint fShaderLength = (GLint)fragmentFile->size();
         // 2. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glShaderSource(vertex, 1, &vShaderCode, &vShaderLength);
         glCompileShader(vertex);
         checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glShaderSource(fragment, 1, &fShaderCode, &fShaderLength);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // if geometry shader is given, compile geometry shader
         unsigned int geometry;
         if(geometryPath != nullptr)
         {
-            const char * gShaderCode = geometryCode.c_str();
+            const char * gShaderCode = geometryFile->size() ? (const char*)geometryFile->data() : "";
+            GLint gShaderLength = (GLint)geometryFile->size();
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glShaderSource(geometry, 1, &gShaderCode, &gShaderLength);
             glCompileShader(geometry);
             checkCompileErrors(geometry, "GEOMETRY");
         }
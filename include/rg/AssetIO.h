@@ -0,0 +1,131 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_ASSETIO_H
+#define PROJECT_BASE_ASSETIO_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <stb_image.h>
+
+#include <rg/MappedFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace rg {
+
+// stbi_load on a mapped file: the decoder reads the compressed bytes straight from the page cache,
+// the only copy made is the decoded image. Free the result with stbi_image_free.
+inline unsigned char* loadImage(const std::string& path, int* width, int* height, int* components, int requestedComponents) {
+    std::shared_ptr<MappedFile> file = mapAsset(path);
+    if (!file->valid() || file->size() == 0)
+        return nullptr;
+    auto start = std::chrono::steady_clock::now();
+    unsigned char* pixels = stbi_load_from_memory(file->data(), (int)file->size(), width, height, components, requestedComponents);
+    // decoding is where the mapped pages are actually faulted in, so it counts as the asset's I/O time
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    recordAssetIO(path, 0, 0, ms);
+    return pixels;
+}
+
+inline bool imageInfo(const std::string& path, int* width, int* height, int* components) {
+    std::shared_ptr<MappedFile> file = mapAsset(path);
+    if (!file->valid() || file->size() == 0)
+        return false;
+    return stbi_info_from_memory(file->data(), (int)file->size(), width, height, components) != 0;
+}
+
+// Assimp stream over a mapping. Assimp wants the bytes in its own buffers, so each Read is a copy and is
+// reported as such when the stream is closed.
+class MappedIOStream : public Assimp::IOStream {
+public:
+    MappedIOStream(std::string path, std::shared_ptr<MappedFile> file)
+            : path(std::move(path)), file(std::move(file)) {}
+
+    ~MappedIOStream() override {
+        recordAssetIO(path, 0, copied, readMs);
+    }
+
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if (size == 0)
+            return 0;
+        auto start = std::chrono::steady_clock::now();
+        size_t items = std::min(count, (file->size() - position) / size);
+        std::memcpy(buffer, file->data() + position, items * size);
+        position += items * size;
+        copied += items * size;
+        readMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return items;
+    }
+
+    size_t Write(const void*, size_t, size_t) override {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t target;
+        if (origin == aiOrigin_SET)
+            target = offset;
+        else if (origin == aiOrigin_CUR)
+            target = position + offset;
+        else
+            target = file->size() - offset;
+        if (target > file->size())
+            return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override {
+        return position;
+    }
+
+    size_t FileSize() const override {
+        return file->size();
+    }
+
+    void Flush() override {}
+
+private:
+    std::string path;
+    std::shared_ptr<MappedFile> file;
+    size_t position = 0;
+    size_t copied = 0;
+    double readMs = 0.0;
+};
+
+// Read-only file system for Assimp::Importer::SetIOHandler, so the model and everything it references
+// (.mtl files and the like) are read through mappings. ReadFileFromMemory would only cover formats that
+// fit in a single file.
+class MappedIOSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char* path) const override {
+        return fileExists(path);
+    }
+
+    char getOsSeparator() const override {
+        return '/';
+    }
+
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override {
+        if (std::strchr(mode, 'w') || std::strchr(mode, 'a'))
+            return nullptr;
+        std::shared_ptr<MappedFile> file = mapAsset(path);
+        if (!file->valid())
+            return nullptr;
+        return new MappedIOStream(path, std::move(file));
+    }
+
+    void Close(Assimp::IOStream* stream) override {
+        delete stream;
+    }
+};
+
+};
+
+#endif //PROJECT_BASE_ASSETIO_H
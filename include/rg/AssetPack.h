@@ -0,0 +1,279 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_ASSETPACK_H
+#define PROJECT_BASE_ASSETPACK_H
+
+#include <rg/MappedFile.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Layout of the archive written by tools/asset_packer.cpp:
+//   AssetPackHeader
+//   AssetPackEntry[entryCount], sorted by hash
+//   path strings, referenced by the entries
+//   entry data, each entry starting on an ALIGNMENT boundary
+// Entries stored uncompressed are served as ranges of the archive mapping, so GPU-ready blobs (.ktx2,
+// .vtpages) are read without a copy; everything that shrinks enough is LZ4 block compressed.
+namespace pack {
+
+const char MAGIC[4] = {'R', 'G', 'P', 'K'};
+const uint32_t VERSION = 1;
+// the page size, so an uncompressed entry can be mapped on its own and madvise'd exactly
+const uint32_t ALIGNMENT = 4096;
+
+enum Compression : uint32_t { None = 0, LZ4 = 1 };
+
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct AssetPackEntry {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    // of the loose file when packed, caches built from it check against these
+    int64_t mtime;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t compression;
+    uint32_t reserved;
+};
+
+// FNV-1a of the path relative to the project root, '/' separated
+inline uint64_t hashPath(const std::string& path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t alignOffset(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// LZ4 block format (no frame): sequences of a token, literals, a 16 bit offset and a match length.
+// The compressor is the greedy single hash table kind, good enough for an offline packer.
+namespace lz4 {
+
+const size_t MIN_MATCH = 4;
+// the last match starts at least 12 bytes and ends at least 5 bytes before the end of the block
+const size_t MF_LIMIT = 12;
+const size_t LAST_LITERALS = 5;
+const size_t MAX_OFFSET = 65535;
+
+inline void writeLength(std::vector<unsigned char>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back((unsigned char)length);
+}
+
+inline void writeSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount,
+                          size_t offset, size_t matchLength) {
+    size_t token = out.size();
+    out.push_back((unsigned char)(std::min<size_t>(literalCount, 15) << 4));
+    if (literalCount >= 15)
+        writeLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0)
+        return;
+    out.push_back((unsigned char)(offset & 0xFF));
+    out.push_back((unsigned char)(offset >> 8));
+    size_t extra = matchLength - MIN_MATCH;
+    out[token] |= (unsigned char)std::min<size_t>(extra, 15);
+    if (extra >= 15)
+        writeLength(out, extra - 15);
+}
+
+inline std::vector<unsigned char> compress(const unsigned char* source, size_t size) {
+    std::vector<unsigned char> out;
+    out.reserve(size + size / 255 + 16);
+    const uint32_t NONE = 0xFFFFFFFFu;
+    std::vector<uint32_t> table(1 << 16, NONE);
+
+    size_t anchor = 0, position = 0, misses = 0;
+    while (size > MF_LIMIT && position + MF_LIMIT <= size) {
+        uint32_t sequence;
+        std::memcpy(&sequence, source + position, 4);
+        uint32_t slot = (sequence * 2654435761u) >> 16;
+        uint32_t candidate = table[slot];
+        table[slot] = (uint32_t)position;
+        if (candidate != NONE && position - candidate <= MAX_OFFSET && std::memcmp(source + candidate, source + position, 4) == 0) {
+            size_t length = MIN_MATCH;
+            while (position + length < size - LAST_LITERALS && source[candidate + length] == source[position + length])
+                length++;
+            writeSequence(out, source + anchor, position - anchor, position - candidate, length);
+            position += length;
+            anchor = position;
+            misses = 0;
+        } else {
+            // skip faster through data that doesn't compress, as the reference compressor does
+            position += 1 + (misses++ >> 6);
+        }
+    }
+    writeSequence(out, source + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+// false on malformed input or when it doesn't decode to exactly size bytes
+inline bool decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t size) {
+    size_t in = 0, out = 0;
+    auto readLength = [&](size_t& length) {
+        unsigned char byte;
+        do {
+            if (in >= sourceSize)
+                return false;
+            byte = source[in++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+    while (in < sourceSize) {
+        unsigned char token = source[in++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(literals))
+            return false;
+        if (literals > sourceSize - in || literals > size - out)
+            return false;
+        std::memcpy(destination + out, source + in, literals);
+        in += literals;
+        out += literals;
+        // the last sequence has literals only
+        if (in == sourceSize)
+            break;
+
+        if (sourceSize - in < 2)
+            return false;
+        size_t offset = source[in] | (size_t)source[in + 1] << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(length))
+            return false;
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out || length > size - out)
+            return false;
+        // the match may overlap what it produces, so it is copied forward byte by byte
+        for (size_t i = 0; i < length; ++i)
+            destination[out + i] = destination[out - offset + i];
+        out += length;
+    }
+    return out == size;
+}
+
+}
+
+}
+
+};
+
+// A packed archive of the project's resources, mounted as an AssetSource so loaders keep using their
+// loose file paths. Lookups binary search the hash index and compare the stored path, uncompressed
+// entries are handed out as ranges of the archive mapping and compressed ones are decompressed into
+// memory on every open. A loose file edited after it was packed shadows its entry, so a stale archive
+// in a development tree never hides changes.
+class AssetPack : public rg::AssetSource {
+public:
+    // root is the directory the archived paths are relative to
+    AssetPack(const std::string& archivePath, const std::string& root)
+            : archive(std::make_shared<rg::MappedFile>(archivePath)), root(rg::assetio::normalizePath(root)) {
+        using namespace rg::pack;
+        if (archive->size() < sizeof(AssetPackHeader))
+            return;
+        std::memcpy(&header, archive->data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.alignment != ALIGNMENT || !fits(sizeof(header), (uint64_t)header.entryCount * sizeof(AssetPackEntry)) ||
+            !fits(header.stringsOffset, header.stringsSize))
+            return;
+        entries.resize(header.entryCount);
+        std::memcpy(entries.data(), archive->data() + sizeof(header), entries.size() * sizeof(AssetPackEntry));
+        for (const AssetPackEntry& entry : entries) {
+            if (!fits(entry.offset, entry.storedSize) || (uint64_t)entry.pathOffset + entry.pathLength > header.stringsSize ||
+                (entry.compression == None && entry.storedSize != entry.size) || entry.compression > LZ4) {
+                entries.clear();
+                return;
+            }
+        }
+        loaded = true;
+    }
+
+    bool valid() const { return loaded; }
+    size_t size() const { return entries.size(); }
+
+    std::shared_ptr<rg::MappedFile> open(const std::string& path) override {
+        const rg::pack::AssetPackEntry* entry = find(path);
+        if (!entry)
+            return nullptr;
+        if (entry->compression == rg::pack::None)
+            return std::make_shared<rg::MappedFile>(archive, entry->offset, entry->size);
+        std::vector<unsigned char> contents(entry->size);
+        if (!rg::pack::lz4::decompress(archive->data() + entry->offset, entry->storedSize, contents.data(), contents.size()))
+            return nullptr;
+        return std::make_shared<rg::MappedFile>(std::move(contents));
+    }
+
+    bool stat(const std::string& path, long long& size, long long& mtime) override {
+        const rg::pack::AssetPackEntry* entry = find(path);
+        if (!entry)
+            return false;
+        size = (long long)entry->size;
+        mtime = (long long)entry->mtime;
+        return true;
+    }
+
+private:
+    std::shared_ptr<rg::MappedFile> archive;
+    std::string root;
+    rg::pack::AssetPackHeader header{};
+    std::vector<rg::pack::AssetPackEntry> entries;
+    bool loaded = false;
+
+    bool fits(uint64_t offset, uint64_t length) const {
+        return offset <= archive->size() && length <= archive->size() - offset;
+    }
+
+    const rg::pack::AssetPackEntry* find(const std::string& path) const {
+        if (!loaded)
+            return nullptr;
+        std::string absolute = rg::assetio::normalizePath(path);
+        if (absolute.compare(0, root.size(), root) != 0 || absolute.size() <= root.size() + 1 || absolute[root.size()] != '/')
+            return nullptr;
+        std::string relative = absolute.substr(root.size() + 1);
+        uint64_t hash = rg::pack::hashPath(relative);
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+                                   [](const rg::pack::AssetPackEntry& entry, uint64_t value) { return entry.hash < value; });
+        const char* strings = (const char*)archive->data() + header.stringsOffset;
+        for (; it != entries.end() && it->hash == hash; ++it) {
+            if (relative.compare(0, std::string::npos, strings + it->pathOffset, it->pathLength) == 0)
+                return newerLooseFile(absolute, *it) ? nullptr : &*it;
+        }
+        return nullptr;
+    }
+
+    // shipped builds have no loose files, the stat fails and the entry is used
+    static bool newerLooseFile(const std::string& path, const rg::pack::AssetPackEntry& entry) {
+        struct stat info;
+        return ::stat(path.c_str(), &info) == 0 && (int64_t)info.st_mtime > entry.mtime;
+    }
+};
+
+#endif //PROJECT_BASE_ASSETPACK_H
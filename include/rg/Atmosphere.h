@@ -0,0 +1,222 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_ATMOSPHERE_H
+#define PROJECT_BASE_ATMOSPHERE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/GpuTimer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+struct AtmosphereSettings {
+    bool enabled = true;
+    // sky luminance for a sun of illuminance 1, in the scene's HDR units
+    float intensity = 12.0f;
+    // the sky view is recomputed once the sun has moved this far since the last time
+    float updateDegrees = 0.5f;
+    // a recomputation is spread over this many frames, each one renders a band of the sky view rows
+    int updateFrames = 4;
+};
+
+struct AtmosphereStats {
+    unsigned int updates = 0;
+    // rows of the sky view rendered this frame, 0 while the sun stands still
+    int rowsThisFrame = 0;
+    bool updating = false;
+};
+
+// Physically based sky after Hillaire, "A Scalable and Production Ready Sky and Atmosphere Rendering
+// Technique" (2020). Rayleigh, Mie and ozone media are ray marched into three small LUTs:
+//  - transmittance to the top of the atmosphere by height and zenith angle, computed once
+//  - multiple scattering of all orders by height and sun zenith angle, computed once
+//  - the sky view, luminance by view azimuth and elevation for the current sun, which depends on the
+//    sun alone (the camera is always on the ground at this scale)
+// The sky view is recomputed into a back buffer a band of rows per frame, and only after the sun has
+// moved updateDegrees; the skybox pass then upsamples it through bilinear filtering. All three passes
+// share atmosphere_lut.fs.
+class Atmosphere {
+public:
+    static const int TRANSMITTANCE_WIDTH = 256;
+    static const int TRANSMITTANCE_HEIGHT = 64;
+    static const int MULTI_SCATTERING_SIZE = 32;
+    static const int SKY_VIEW_WIDTH = 192;
+    static const int SKY_VIEW_HEIGHT = 108;
+
+    AtmosphereSettings settings;
+    // GPU time of the LUT passes of a frame
+    GpuTimer updateTimer;
+
+    Atmosphere() : lutShader("post_vertex.vs", "atmosphere_lut.fs") {
+        glGenVertexArrays(1, &fullscreenVAO);
+        glGenFramebuffers(1, &fbo);
+        transmittance = createTarget(TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, GL_RGBA16F, GL_CLAMP_TO_EDGE);
+        multiScattering = createTarget(MULTI_SCATTERING_SIZE, MULTI_SCATTERING_SIZE, GL_RGBA16F, GL_CLAMP_TO_EDGE);
+        for (GLuint& target : skyView)
+            target = createTarget(SKY_VIEW_WIDTH, SKY_VIEW_HEIGHT, GL_R11F_G11F_B10F, GL_REPEAT);
+
+        // neither depends on the sun
+        lutShader.use();
+        lutShader.setInt("transmittanceLut", 0);
+        lutShader.setInt("multiScatteringLut", 1);
+        RenderState saved = save();
+        lutShader.setInt("lutPass", 0);
+        render(transmittance, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, 0, TRANSMITTANCE_HEIGHT);
+        lutShader.setInt("lutPass", 1);
+        // only the transmittance is read, the multiple scattering LUT is the target
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, transmittance);
+        render(multiScattering, MULTI_SCATTERING_SIZE, MULTI_SCATTERING_SIZE, 0, MULTI_SCATTERING_SIZE);
+        restore(saved);
+    }
+
+    ~Atmosphere() {
+        glDeleteTextures(1, &transmittance);
+        glDeleteTextures(1, &multiScattering);
+        glDeleteTextures(2, skyView);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteVertexArrays(1, &fullscreenVAO);
+    }
+
+    Atmosphere(const Atmosphere&) = delete;
+    Atmosphere& operator=(const Atmosphere&) = delete;
+
+    // world space direction towards the sun; renders this frame's share of a pending sky view update.
+    // Binds its own framebuffer and viewport, call it outside of a scene pass
+    void update(const glm::vec3& sunDirection) {
+        frameStats.rowsThisFrame = 0;
+        if (!settings.enabled)
+            return;
+        glm::vec3 direction = glm::normalize(sunDirection);
+        if (nextRow == SKY_VIEW_HEIGHT) {
+            float threshold = std::cos(glm::radians(std::max(settings.updateDegrees, 0.0f)));
+            if (valid && glm::dot(direction, shownSun) >= threshold)
+                return;
+            pendingSun = direction;
+            nextRow = 0;
+        }
+
+        int frames = std::max(settings.updateFrames, 1);
+        int rows = (SKY_VIEW_HEIGHT + frames - 1) / frames;
+        // the first recomputation is done at once, there is nothing to show until then
+        if (!valid)
+            rows = SKY_VIEW_HEIGHT;
+        int first = nextRow;
+        nextRow = std::min(nextRow + rows, (int)SKY_VIEW_HEIGHT);
+
+        updateTimer.begin();
+        RenderState saved = save();
+        lutShader.use();
+        lutShader.setInt("lutPass", 2);
+        lutShader.setVec3("sunDirection", pendingSun);
+        bindLuts();
+        render(skyView[1 - front], SKY_VIEW_WIDTH, SKY_VIEW_HEIGHT, first, nextRow);
+        restore(saved);
+        updateTimer.end();
+
+        frameStats.rowsThisFrame = nextRow - first;
+        if (nextRow == SKY_VIEW_HEIGHT) {
+            front = 1 - front;
+            shownSun = pendingSun;
+            valid = true;
+            frameStats.updates++;
+        }
+        frameStats.updating = nextRow < SKY_VIEW_HEIGHT;
+    }
+
+    // binds the sky view to the given unit and sets the shader's skyView, atmosphere and skyIntensity uniforms
+    void bind(Shader& shader, int unit) const {
+        bool shown = settings.enabled && valid;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, shown ? skyView[front] : 0);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("skyView", unit);
+        shader.setBool("atmosphere", shown);
+        shader.setFloat("skyIntensity", settings.intensity);
+    }
+
+    // the sky is drawn by the skybox pass, day or night, while this is set
+    bool active() const { return settings.enabled && valid; }
+
+    const AtmosphereStats& stats() const { return frameStats; }
+
+private:
+    struct RenderState {
+        GLint framebuffer;
+        GLint viewport[4];
+    };
+
+    Shader lutShader;
+    GLuint fullscreenVAO = 0;
+    GLuint fbo = 0;
+    GLuint transmittance = 0;
+    GLuint multiScattering = 0;
+    GLuint skyView[2] = {0, 0};
+    int front = 0;
+    bool valid = false;
+    // rows of the back sky view done so far, SKY_VIEW_HEIGHT when no update is in progress
+    int nextRow = SKY_VIEW_HEIGHT;
+    glm::vec3 shownSun = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 pendingSun = glm::vec3(0.0f, 1.0f, 0.0f);
+    AtmosphereStats frameStats;
+
+    static GLuint createTarget(int width, int height, GLenum format, GLenum wrapS) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    void bindLuts() const {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, transmittance);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, multiScattering);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // fills rows [firstRow, endRow) of the target with the bound LUT shader
+    void render(GLuint target, int width, int height, int firstRow, int endRow) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+        glViewport(0, 0, width, height);
+        bool partial = firstRow > 0 || endRow < height;
+        if (partial) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(0, firstRow, width, endRow - firstRow);
+        }
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(fullscreenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+        if (partial)
+            glDisable(GL_SCISSOR_TEST);
+    }
+
+    static RenderState save() {
+        RenderState state;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &state.framebuffer);
+        glGetIntegerv(GL_VIEWPORT, state.viewport);
+        return state;
+    }
+
+    static void restore(const RenderState& state) {
+        glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+        glViewport(state.viewport[0], state.viewport[1], state.viewport[2], state.viewport[3]);
+    }
+};
+
+#endif //PROJECT_BASE_ATMOSPHERE_H
@@ -0,0 +1,504 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_CUBEMAP_H
+#define PROJECT_BASE_CUBEMAP_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <rg/AssetIO.h>
+#include <rg/JobSystem.h>
+#include <rg/TextureCompression.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// how the source images hold the six faces: one file each (+X, -X, +Y, -Y, +Z, -Z), a cross of 3x4 or 4x3
+// tiles, or an equirectangular panorama (2:1)
+enum class CubemapLayout { Faces, VerticalCross, HorizontalCross, Equirect };
+
+// RGB9E5 faces with their whole mip chain, levels[level][face]
+struct CubemapImage {
+    int faceSize = 0;
+    std::vector<std::array<std::vector<uint32_t>, 6>> levels;
+
+    bool valid() const { return !levels.empty(); }
+
+    size_t sizeInBytes() const {
+        size_t bytes = 0;
+        for (const std::array<std::vector<uint32_t>, 6>& level : levels)
+            for (const std::vector<uint32_t>& face : level)
+                bytes += face.size() * sizeof(uint32_t);
+        return bytes;
+    }
+};
+
+struct CubemapStats {
+    CubemapLayout layout = CubemapLayout::Faces;
+    bool cacheHit = false;
+    // decoding the sources, and resampling, mip generation and packing, on a miss; reading the cache on a hit
+    double decodeMs = 0.0;
+    double convertMs = 0.0;
+    double cacheReadMs = 0.0;
+    double uploadMs = 0.0;
+};
+
+namespace cube {
+
+// bump when the conversion changes, older cache files are then rebuilt
+const char* const CACHE_VERSION = "rg-cube-1";
+// VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+const uint32_t VK_FORMAT_RGB9E5 = 123;
+
+// shared exponent packing from EXT_texture_shared_exponent, 9 bit mantissas and a 5 bit exponent (bias 15)
+inline uint32_t packRGB9E5(float r, float g, float b) {
+    const float maxValue = 65408.0f; // (2^9 - 1) / 2^9 * 2^16
+    r = std::min(std::max(r, 0.0f), maxValue);
+    g = std::min(std::max(g, 0.0f), maxValue);
+    b = std::min(std::max(b, 0.0f), maxValue);
+    float maxComponent = std::max(r, std::max(g, b));
+    int exponent = std::max(-16, (int)std::floor(std::log2(std::max(maxComponent, 1e-30f)))) + 1 + 15;
+    float scale = std::ldexp(1.0f, exponent - 15 - 9);
+    if ((int)std::floor(maxComponent / scale + 0.5f) == 512) {
+        exponent++;
+        scale *= 2.0f;
+    }
+    uint32_t ri = (uint32_t)std::floor(r / scale + 0.5f);
+    uint32_t gi = (uint32_t)std::floor(g / scale + 0.5f);
+    uint32_t bi = (uint32_t)std::floor(b / scale + 0.5f);
+    return (uint32_t)exponent << 27 | bi << 18 | gi << 9 | ri;
+}
+
+inline void unpackRGB9E5(uint32_t packed, float rgb[3]) {
+    float scale = std::ldexp(1.0f, (int)(packed >> 27) - 15 - 9);
+    rgb[0] = (float)(packed & 511) * scale;
+    rgb[1] = (float)((packed >> 9) & 511) * scale;
+    rgb[2] = (float)((packed >> 18) & 511) * scale;
+}
+
+// a decoded RGB8 source
+struct Source {
+    int width = 0;
+    int height = 0;
+    unsigned char* pixels = nullptr;
+};
+
+// GL's cube map table as axes, the direction through face coordinates s, t in [-1, 1] is
+// s * FACE_AXES[face][0] + t * FACE_AXES[face][1] + FACE_AXES[face][2], t = -1 being the first row uploaded
+const float FACE_AXES[6][3][3] = {
+        {{0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+        {{0.0f, 0.0f, 1.0f}, {0.0f, -1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}},
+        {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+        {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}},
+        {{1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+        {{-1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, -1.0f}}};
+
+// direction through texel center (x, y) of a face, not normalized
+inline void faceDirection(int face, int x, int y, int size, float direction[3]) {
+    float s = 2.0f * ((float)x + 0.5f) / (float)size - 1.0f;
+    float t = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+    for (int i = 0; i < 3; ++i)
+        direction[i] = s * FACE_AXES[face][0][i] + t * FACE_AXES[face][1][i] + FACE_AXES[face][2][i];
+}
+
+// averages the square [x0, x0 + tile) x [y0, y0 + tile) of the source down (or up) to size x size floats,
+// turned half way round when rotate is set
+inline std::vector<float> resampleTile(const Source& source, int x0, int y0, int tile, int size, bool rotate) {
+    std::vector<float> face((size_t)size * size * 3);
+    float scale = (float)tile / (float)size;
+    jobs().parallelFor((size_t)size, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            int sy0 = (int)(y * scale), sy1 = std::max(sy0 + 1, (int)((y + 1) * scale));
+            for (int x = 0; x < size; ++x) {
+                int sx0 = (int)(x * scale), sx1 = std::max(sx0 + 1, (int)((x + 1) * scale));
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                for (int sy = sy0; sy < sy1; ++sy) {
+                    for (int sx = sx0; sx < sx1; ++sx) {
+                        int px = rotate ? tile - 1 - sx : sx;
+                        int py = rotate ? tile - 1 - sy : sy;
+                        const unsigned char* texel = source.pixels + ((size_t)(y0 + py) * source.width + x0 + px) * 3;
+                        sum[0] += texel[0];
+                        sum[1] += texel[1];
+                        sum[2] += texel[2];
+                    }
+                }
+                float weight = 1.0f / (255.0f * (float)((sy1 - sy0) * (sx1 - sx0)));
+                float* out = &face[(y * size + x) * 3];
+                out[0] = sum[0] * weight;
+                out[1] = sum[1] * weight;
+                out[2] = sum[2] * weight;
+            }
+        }
+    });
+    return face;
+}
+
+// bilinear lookups of the panorama along each texel's direction, 2x2 supersampled
+inline std::vector<float> resampleEquirect(const Source& source, int face, int size) {
+    std::vector<float> out((size_t)size * size * 3);
+    const float pi = 3.14159265f;
+    jobs().parallelFor((size_t)size, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            for (int x = 0; x < size; ++x) {
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                for (int sample = 0; sample < 4; ++sample) {
+                    float d[3];
+                    faceDirection(face, 2 * x + (sample & 1), 2 * (int)y + (sample >> 1), 2 * size, d);
+                    float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                    float u = std::atan2(d[2], d[0]) / (2.0f * pi) + 0.5f;
+                    float v = std::acos(std::min(std::max(d[1] / length, -1.0f), 1.0f)) / pi;
+                    float fx = u * source.width - 0.5f, fy = v * source.height - 0.5f;
+                    int ix = (int)std::floor(fx), iy = (int)std::floor(fy);
+                    float ax = fx - ix, ay = fy - iy;
+                    for (int tap = 0; tap < 4; ++tap) {
+                        int tx = ((ix + (tap & 1)) % source.width + source.width) % source.width;
+                        int ty = std::min(std::max(iy + (tap >> 1), 0), source.height - 1);
+                        float w = ((tap & 1) ? ax : 1.0f - ax) * ((tap >> 1) ? ay : 1.0f - ay);
+                        const unsigned char* texel = source.pixels + ((size_t)ty * source.width + tx) * 3;
+                        sum[0] += texel[0] * w;
+                        sum[1] += texel[1] * w;
+                        sum[2] += texel[2] * w;
+                    }
+                }
+                float* o = &out[(y * size + x) * 3];
+                o[0] = sum[0] / (4.0f * 255.0f);
+                o[1] = sum[1] / (4.0f * 255.0f);
+                o[2] = sum[2] / (4.0f * 255.0f);
+            }
+        }
+    });
+    return out;
+}
+
+// 2x2 box filter of a square float RGB face
+inline std::vector<float> downsample(const std::vector<float>& face, int size) {
+    int half = std::max(size / 2, 1);
+    std::vector<float> out((size_t)half * half * 3);
+    for (int y = 0; y < half; ++y) {
+        for (int x = 0; x < half; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                int x1 = std::min(2 * x + 1, size - 1), y1 = std::min(2 * y + 1, size - 1);
+                out[((size_t)y * half + x) * 3 + c] = 0.25f * (face[((size_t)2 * y * size + 2 * x) * 3 + c] +
+                                                               face[((size_t)2 * y * size + x1) * 3 + c] +
+                                                               face[((size_t)y1 * size + 2 * x) * 3 + c] +
+                                                               face[((size_t)y1 * size + x1) * 3 + c]);
+            }
+        }
+    }
+    return out;
+}
+
+inline std::vector<uint32_t> pack(const std::vector<float>& face) {
+    std::vector<uint32_t> packed(face.size() / 3);
+    for (size_t i = 0; i < packed.size(); ++i)
+        packed[i] = packRGB9E5(face[i * 3], face[i * 3 + 1], face[i * 3 + 2]);
+    return packed;
+}
+
+inline std::string cachePath(const std::vector<std::string>& sources) {
+    return sources[0] + ".cube.ktx2";
+}
+
+// identifies the source files and the settings the cache was built from
+inline std::string sourceKey(const std::vector<std::string>& sources, int maxFaceSize) {
+    std::string key = std::string(CACHE_VERSION) + ":" + std::to_string(maxFaceSize);
+    for (const std::string& source : sources) {
+        std::string file = bc::sourceKey(source);
+        if (file.empty())
+            return std::string();
+        key += ";" + file;
+    }
+    return key;
+}
+
+// one key/value entry: its length, the bytes and padding to 4
+inline std::string kvdEntry(const std::string& keyAndValue) {
+    uint32_t length = (uint32_t)keyAndValue.size();
+    std::string entry((const char*)&length, 4);
+    entry += keyAndValue;
+    entry.resize((entry.size() + 3) / 4 * 4, '\0');
+    return entry;
+}
+
+// same KTX2 layout as the block compressed cache, with six faces per level; data, when given, is stored
+// as a second key/value entry (at most a few KB)
+inline bool writeCache(const std::string& path, const std::string& key, const CubemapImage& image,
+                       const std::string& data = std::string()) {
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+
+    std::string kvdBlock = kvdEntry(std::string("rg.source") + '\0' + key + '\0');
+    if (!data.empty())
+        kvdBlock += kvdEntry(std::string("rg.data") + '\0' + data);
+    kvdBlock.resize((kvdBlock.size() + 7) / 8 * 8, '\0');
+
+    bc::Ktx2Header header{};
+    header.vkFormat = VK_FORMAT_RGB9E5;
+    header.typeSize = 4;
+    header.pixelWidth = image.faceSize;
+    header.pixelHeight = image.faceSize;
+    header.faceCount = 6;
+    header.levelCount = (uint32_t)image.levels.size();
+    header.kvdByteOffset = (uint32_t)(sizeof(bc::KTX2_IDENTIFIER) + sizeof(header) + image.levels.size() * sizeof(bc::Ktx2Level));
+    header.kvdByteLength = (uint32_t)kvdBlock.size();
+
+    std::vector<bc::Ktx2Level> index(image.levels.size());
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        index[i].byteOffset = offset;
+        index[i].byteLength = index[i].uncompressedByteLength = image.levels[i][0].size() * sizeof(uint32_t) * 6;
+        offset += index[i].byteLength;
+    }
+
+    bool ok = std::fwrite(bc::KTX2_IDENTIFIER, sizeof(bc::KTX2_IDENTIFIER), 1, file) == 1 &&
+              std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(index.data(), sizeof(bc::Ktx2Level), index.size(), file) == index.size() &&
+              std::fwrite(kvdBlock.data(), 1, kvdBlock.size(), file) == kvdBlock.size();
+    for (const std::array<std::vector<uint32_t>, 6>& level : image.levels)
+        for (const std::vector<uint32_t>& face : level)
+            ok = ok && std::fwrite(face.data(), sizeof(uint32_t), face.size(), file) == face.size();
+    ok = std::fclose(file) == 0 && ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    if (!ok)
+        std::remove(temporary.c_str());
+    return ok;
+}
+
+inline bool readCache(const std::string& path, const std::string& key, CubemapImage& image,
+                      std::string* data = nullptr) {
+    std::shared_ptr<MappedFile> file = mapAsset(path);
+    const unsigned char* bytes = file->data();
+    size_t size = file->size();
+    auto fits = [size](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+    bc::Ktx2Header header;
+    bool ok = fits(0, sizeof(bc::KTX2_IDENTIFIER) + sizeof(header)) &&
+              std::memcmp(bytes, bc::KTX2_IDENTIFIER, sizeof(bc::KTX2_IDENTIFIER)) == 0;
+    if (ok) {
+        std::memcpy(&header, bytes + sizeof(bc::KTX2_IDENTIFIER), sizeof(header));
+        ok = header.vkFormat == VK_FORMAT_RGB9E5 && header.faceCount == 6 && header.pixelWidth == header.pixelHeight &&
+             header.pixelWidth > 0 && header.levelCount > 0 && header.levelCount <= 32;
+    }
+
+    std::vector<bc::Ktx2Level> index;
+    size_t indexOffset = sizeof(bc::KTX2_IDENTIFIER) + sizeof(header);
+    if (ok) {
+        index.resize(header.levelCount);
+        ok = fits(indexOffset, index.size() * sizeof(bc::Ktx2Level));
+        if (ok)
+            std::memcpy(index.data(), bytes + indexOffset, index.size() * sizeof(bc::Ktx2Level));
+    }
+
+    if (ok) {
+        std::string expected = std::string("rg.source") + '\0' + key + '\0';
+        ok = header.kvdByteLength >= 4 + expected.size() && header.kvdByteLength <= 4096 &&
+             fits(header.kvdByteOffset, header.kvdByteLength) &&
+             std::memcmp(bytes + header.kvdByteOffset + 4, expected.data(), expected.size()) == 0;
+        // the data entry follows the source key
+        if (ok && data) {
+            std::string prefix = std::string("rg.data") + '\0';
+            size_t entry = 4 + (expected.size() + 3) / 4 * 4;
+            uint32_t length = 0;
+            ok = entry + 4 <= header.kvdByteLength;
+            if (ok) {
+                std::memcpy(&length, bytes + header.kvdByteOffset + entry, 4);
+                ok = length >= prefix.size() && length <= header.kvdByteLength - entry - 4 &&
+                     std::memcmp(bytes + header.kvdByteOffset + entry + 4, prefix.data(), prefix.size()) == 0;
+            }
+            if (ok) {
+                const char* value = (const char*)bytes + header.kvdByteOffset + entry + 4 + prefix.size();
+                data->assign(value, length - prefix.size());
+            }
+        }
+    }
+
+    if (ok) {
+        image.faceSize = header.pixelWidth;
+        image.levels.clear();
+        int faceSize = image.faceSize;
+        for (const bc::Ktx2Level& entry : index) {
+            size_t faceTexels = (size_t)faceSize * faceSize;
+            ok = ok && fits(entry.byteOffset, entry.byteLength) && entry.byteLength == faceTexels * 6 * sizeof(uint32_t);
+            if (!ok)
+                break;
+            std::array<std::vector<uint32_t>, 6> level;
+            for (int face = 0; face < 6; ++face) {
+                level[face].resize(faceTexels);
+                std::memcpy(level[face].data(), bytes + entry.byteOffset + face * faceTexels * sizeof(uint32_t),
+                            faceTexels * sizeof(uint32_t));
+            }
+            image.levels.push_back(std::move(level));
+            faceSize = std::max(faceSize / 2, 1);
+        }
+        recordAssetIO(path, 0, image.sizeInBytes(), 0.0);
+    }
+    if (!ok)
+        image.levels.clear();
+    return ok;
+}
+
+}
+
+inline CubemapLayout detectCubemapLayout(int width, int height) {
+    if (width * 4 == height * 3)
+        return CubemapLayout::VerticalCross;
+    if (width * 3 == height * 4)
+        return CubemapLayout::HorizontalCross;
+    return CubemapLayout::Equirect;
+}
+
+// Loads a cube map from six face images (+X, -X, +Y, -Y, +Z, -Z) or from a single cross or equirectangular
+// image, with faces of at most maxFaceSize and a full mip chain, as RGB9E5. The result is read from a
+// cache next to the first source when it is up to date; otherwise the sources are decoded in parallel,
+// resampled, filtered down and packed on the job pool, and the cache is written. Values keep the 0-1
+// range of the 8 bit sources, the shared exponent only makes room for HDR sources and filtering.
+inline bool loadCubemapImage(const std::vector<std::string>& sources, int maxFaceSize, CubemapImage& image,
+                             CubemapStats* stats = nullptr) {
+    CubemapStats local;
+    CubemapStats& s = stats ? *stats : local;
+    s = CubemapStats();
+    if (sources.size() != 1 && sources.size() != 6)
+        return false;
+    if (sources.size() == 1) {
+        int width, height, components;
+        if (!imageInfo(sources[0], &width, &height, &components))
+            return false;
+        s.layout = detectCubemapLayout(width, height);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    std::string key = cube::sourceKey(sources, maxFaceSize);
+    if (key.empty())
+        return false;
+    if (cube::readCache(cube::cachePath(sources), key, image)) {
+        s.cacheHit = true;
+        s.cacheReadMs = elapsed();
+        return true;
+    }
+
+    // decode: each face on its own job, a single image at once
+    std::vector<cube::Source> decoded(sources.size());
+    jobs().parallelFor(sources.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int components;
+            decoded[i].pixels = loadImage(sources[i], &decoded[i].width, &decoded[i].height, &components, 3);
+        }
+    }, 1);
+    bool ok = true;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        if (!decoded[i].pixels) {
+            std::cout << "Cubemap texture failed to load at path: " << sources[i] << std::endl;
+            ok = false;
+        }
+    }
+    s.decodeMs = elapsed();
+
+    std::array<std::vector<float>, 6> faces;
+    int faceSize = 0;
+    if (ok) {
+        const cube::Source& source = decoded[0];
+        int tile = s.layout == CubemapLayout::VerticalCross ? source.width / 3
+                 : s.layout == CubemapLayout::HorizontalCross ? source.width / 4
+                 : s.layout == CubemapLayout::Equirect ? source.width / 4 : source.width;
+        faceSize = std::min(tile, maxFaceSize);
+        // tile column and row of each face in the crosses, the -Z tile of the vertical one is upside down
+        const int vertical[6][2] = {{2, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 1}, {1, 3}};
+        const int horizontal[6][2] = {{2, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 1}, {3, 1}};
+        for (int face = 0; face < 6 && ok; ++face) {
+            if (s.layout == CubemapLayout::Faces) {
+                const cube::Source& f = decoded[face];
+                ok = f.width == f.height && f.width == source.width;
+                if (ok)
+                    faces[face] = cube::resampleTile(f, 0, 0, f.width, faceSize, false);
+                else
+                    std::cout << "Cubemap faces must be square and of one size: " << sources[face] << std::endl;
+            } else if (s.layout == CubemapLayout::Equirect) {
+                faces[face] = cube::resampleEquirect(source, face, faceSize);
+            } else {
+                const int* cell = s.layout == CubemapLayout::VerticalCross ? vertical[face] : horizontal[face];
+                bool rotate = s.layout == CubemapLayout::VerticalCross && face == 5;
+                faces[face] = cube::resampleTile(source, cell[0] * tile, cell[1] * tile, tile, faceSize, rotate);
+            }
+        }
+    }
+    for (cube::Source& source : decoded)
+        if (source.pixels)
+            stbi_image_free(source.pixels);
+    if (!ok)
+        return false;
+
+    // the mip chain is filtered in float, every face on its own job
+    int levelCount = 1;
+    while ((faceSize >> (levelCount - 1)) > 1)
+        levelCount++;
+    image.faceSize = faceSize;
+    image.levels.assign(levelCount, std::array<std::vector<uint32_t>, 6>());
+    jobs().parallelFor(6, [&](size_t begin, size_t end) {
+        for (size_t face = begin; face < end; ++face) {
+            std::vector<float> level = std::move(faces[face]);
+            int size = faceSize;
+            for (int l = 0; l < levelCount; ++l) {
+                image.levels[l][face] = cube::pack(level);
+                if (l + 1 < levelCount) {
+                    level = cube::downsample(level, size);
+                    size = std::max(size / 2, 1);
+                }
+            }
+        }
+    }, 1);
+    s.convertMs = elapsed();
+
+    if (!cube::writeCache(cube::cachePath(sources), key, image))
+        std::cout << "ERROR::TEXTURE:: could not write cubemap cache for " << sources[0] << std::endl;
+    return true;
+}
+
+// creates a cube map texture with the whole chain, trilinear filtered
+inline GLuint uploadCubemap(const CubemapImage& image, CubemapStats* stats = nullptr) {
+    auto start = std::chrono::steady_clock::now();
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    int size = image.faceSize;
+    for (size_t level = 0; level < image.levels.size(); ++level) {
+        for (int face = 0; face < 6; ++face)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, (GLint)level, GL_RGB9_E5, size, size, 0, GL_RGB,
+                         GL_UNSIGNED_INT_5_9_9_9_REV, image.levels[level][face].data());
+        size = std::max(size / 2, 1);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    if (stats)
+        stats->uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return texture;
+}
+
+};
+
+#endif //PROJECT_BASE_CUBEMAP_H
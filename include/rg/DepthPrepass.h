@@ -0,0 +1,116 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_DEPTHPREPASS_H
+#define PROJECT_BASE_DEPTHPREPASS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader_m.h>
+#include <rg/Frustum.h>
+#include <rg/GeometryPool.h>
+#include <rg/GpuTimer.h>
+
+#include <vector>
+
+struct DepthPrepassStats {
+    unsigned int drawnMeshes = 0;
+    unsigned int culledMeshes = 0;
+};
+
+// Lays down a model's depth before it is shaded, so the expensive fragment shader runs once per pixel
+// instead of once per overlapping surface. The pre-pass reads a position-only copy of the model (12 bytes
+// a vertex instead of the 56 of the shading layout) from its own pool and writes depth alone; the shading
+// pass that follows tests GL_EQUAL without writing depth. Both vertex shaders declare gl_Position
+// invariant and transform the same way, otherwise EQUAL would reject pixels at random.
+class DepthPrepass {
+public:
+    // GPU time of the church with the pre-pass (pre-pass and shading together) and without it
+    GpuTimer prepassTimer;
+    GpuTimer directTimer;
+
+    DepthPrepass() : pool(VertexFormat{sizeof(glm::vec3), {{0, 3, GL_FLOAT, GL_FALSE, 0}}}, 1 << 16, 1 << 18),
+                     shader("depth_prepass.vs", "depth_prepass.fs") {}
+
+    DepthPrepass(const DepthPrepass&) = delete;
+    DepthPrepass& operator=(const DepthPrepass&) = delete;
+
+    // copies the positions of a loaded model, once; the model must keep its CPU side vertices
+    void build(const Model& model) {
+        if (built)
+            return;
+        std::vector<glm::vec3> positions;
+        for (const Mesh& mesh : model.meshes) {
+            positions.resize(mesh.vertices.size());
+            for (size_t i = 0; i < positions.size(); ++i)
+                positions[i] = mesh.vertices[i].Position;
+            Entry entry;
+            entry.range = pool.allocate(positions.data(), positions.size(), mesh.indices.data(), mesh.indices.size());
+            entry.boundsMin = mesh.boundsMin;
+            entry.boundsMax = mesh.boundsMax;
+            if (entry.range.valid())
+                entries.push_back(entry);
+        }
+        built = true;
+    }
+
+    bool ready() const { return built; }
+
+    // depth only, leaves color writes on and the depth test at GL_LESS
+    void draw(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) {
+        Frustum frustum(projection * view * model);
+        visible.clear();
+        for (const Entry& entry : entries) {
+            if (frustum.intersects(entry.boundsMin, entry.boundsMax))
+                visible.push_back(entry.range);
+        }
+        frameStats.drawnMeshes = (unsigned int)visible.size();
+        frameStats.culledMeshes = (unsigned int)(entries.size() - visible.size());
+        if (visible.empty())
+            return;
+
+        shader.use();
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+        shader.setMat4("model", model);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        pool.bind();
+        pool.multiDraw(visible.data(), visible.size());
+        glBindVertexArray(0);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // the shading draws go between these two, each pixel passes only for the surface the pre-pass kept
+    void beginShading() {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    void endShading() {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+
+    const DepthPrepassStats& stats() const { return frameStats; }
+
+private:
+    struct Entry {
+        GeometryRange range;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    GeometryPool pool;
+    Shader shader;
+    std::vector<Entry> entries;
+    std::vector<GeometryRange> visible;
+    bool built = false;
+    DepthPrepassStats frameStats;
+};
+
+#endif //PROJECT_BASE_DEPTHPREPASS_H
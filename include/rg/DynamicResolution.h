@@ -0,0 +1,72 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_DYNAMICRESOLUTION_H
+#define PROJECT_BASE_DYNAMICRESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+
+struct DynamicResolutionSettings {
+    bool enabled = true;
+    float targetMs = 16.6f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // fraction of the gap to the ideal scale closed per frame, lower is smoother but reacts slower
+    float responsiveness = 0.1f;
+};
+
+// Feedback loop from measured GPU frame time to the scene's render scale. GPU cost is taken to be
+// proportional to the pixel count, i.e. scale squared, so the ideal scale for the next frame is
+// scale * sqrt(target / measured). Timer results arrive several frames late, so after a change the
+// scale is held until a frame rendered at the new scale has been measured; reacting to the older
+// samples would keep correcting for a cost that is already gone and oscillate.
+class DynamicResolution {
+public:
+    static const int HISTORY_SIZE = 128;
+
+    DynamicResolutionSettings settings;
+
+    // sampleFrame numbers the frame gpuMs was measured on, nextFrame the frame about to use the scale
+    // (GpuTimer::lastFrame() and nextFrame())
+    void update(float gpuMs, unsigned int sampleFrame, unsigned int nextFrame) {
+        if (!settings.enabled || gpuMs <= 0.0f) {
+            if (scale != settings.maxScale)
+                firstFrameAtScale = nextFrame;
+            scale = settings.maxScale;
+        } else if ((int)(sampleFrame - firstFrameAtScale) >= 0) {
+            // aim slightly below the target so noise doesn't push every other frame over budget
+            float ideal = scale * std::sqrt(settings.targetMs * 0.9f / gpuMs);
+            ideal = std::min(std::max(ideal, settings.minScale), settings.maxScale);
+            // dead band, ignore changes smaller than 2% to keep the image stable
+            float previous = scale;
+            if (std::fabs(ideal - scale) > 0.02f)
+                scale += (ideal - scale) * settings.responsiveness;
+            scale = std::min(std::max(scale, settings.minScale), settings.maxScale);
+            if (scale != previous)
+                firstFrameAtScale = nextFrame;
+        }
+
+        scaleHistory[historyOffset] = scale;
+        gpuMsHistory[historyOffset] = gpuMs;
+        historyOffset = (historyOffset + 1) % HISTORY_SIZE;
+    }
+
+    float getScale() const { return scale; }
+
+    // ring buffers laid out for ImGui::PlotLines, pass getHistoryOffset() as values_offset
+    const float* getScaleHistory() const { return scaleHistory; }
+    const float* getGpuMsHistory() const { return gpuMsHistory; }
+    int getHistoryOffset() const { return historyOffset; }
+
+private:
+    float scale = 1.0f;
+    // the first frame rendered at the current scale, earlier samples don't reflect it
+    unsigned int firstFrameAtScale = 0;
+    float scaleHistory[HISTORY_SIZE] = {};
+    float gpuMsHistory[HISTORY_SIZE] = {};
+    int historyOffset = 0;
+};
+
+#endif //PROJECT_BASE_DYNAMICRESOLUTION_H
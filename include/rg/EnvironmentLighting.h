@@ -0,0 +1,489 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_ENVIRONMENTLIGHTING_H
+#define PROJECT_BASE_ENVIRONMENTLIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/Cubemap.h>
+#include <rg/JobSystem.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RG_SH_X86
+#include <emmintrin.h>
+#endif
+
+namespace rg {
+namespace ibl {
+
+// bump when the projection or the filtering changes, older cache files are then rebuilt
+const char* const CACHE_VERSION = "rg-ibl-1";
+// the SH is projected from the first skybox level at most this big
+const int SH_SOURCE_SIZE = 64;
+const int SPECULAR_SIZE = 128;
+// roughness 0, 0.25, 0.5, 0.75 and 1, one level each
+const int SPECULAR_LEVELS = 5;
+const int SPECULAR_SAMPLES = 64;
+const float PI = 3.14159265f;
+
+// nine RGB coefficients of bands 0 to 2, ordered (0, 0), (1, -1), (1, 0), (1, 1), (2, -2) ... (2, 2)
+struct SH9 {
+    float c[9][3] = {};
+};
+
+inline void shBasis(float x, float y, float z, float out[9]) {
+    out[0] = 0.282095f;
+    out[1] = 0.488603f * y;
+    out[2] = 0.488603f * z;
+    out[3] = 0.488603f * x;
+    out[4] = 1.092548f * x * y;
+    out[5] = 1.092548f * y * z;
+    out[6] = 0.315392f * (3.0f * z * z - 1.0f);
+    out[7] = 1.092548f * x * z;
+    out[8] = 0.546274f * (x * x - y * y);
+}
+
+// float RGB faces, levels[level][face]
+struct FloatCube {
+    int size = 0;
+    std::vector<std::array<std::vector<float>, 6>> levels;
+};
+
+// the levels of image no bigger than maxSize, unpacked
+inline FloatCube unpack(const CubemapImage& image, int maxSize) {
+    FloatCube cube;
+    int size = image.faceSize;
+    for (size_t level = 0; level < image.levels.size(); ++level, size = std::max(size / 2, 1)) {
+        if (size > maxSize && level + 1 < image.levels.size())
+            continue;
+        if (cube.levels.empty())
+            cube.size = size;
+        std::array<std::vector<float>, 6> faces;
+        for (int face = 0; face < 6; ++face) {
+            const std::vector<uint32_t>& packed = image.levels[level][face];
+            faces[face].resize(packed.size() * 3);
+            for (size_t i = 0; i < packed.size(); ++i)
+                cube::unpackRGB9E5(packed[i], &faces[face][i * 3]);
+        }
+        cube.levels.push_back(std::move(faces));
+    }
+    return cube;
+}
+
+// Sums radiance * basis * solid angle over texels [begin, end) of a row at face coordinate t; sums holds
+// the 27 products and the total solid angle
+inline void projectRowScalar(const float* rgb, int face, int size, float t, int begin, int end, float sums[28]) {
+    const float (&axes)[3][3] = cube::FACE_AXES[face];
+    float texelArea = 4.0f / ((float)size * (float)size);
+    for (int x = begin; x < end; ++x) {
+        float s = 2.0f * ((float)x + 0.5f) / (float)size - 1.0f;
+        float d[3];
+        for (int i = 0; i < 3; ++i)
+            d[i] = s * axes[0][i] + t * axes[1][i] + axes[2][i];
+        float lengthSquared = 1.0f + s * s + t * t;
+        float inverseLength = 1.0f / std::sqrt(lengthSquared);
+        // solid angle of a texel of the unit cube seen from its center
+        float weight = texelArea * inverseLength / lengthSquared;
+        float basis[9];
+        shBasis(d[0] * inverseLength, d[1] * inverseLength, d[2] * inverseLength, basis);
+        for (int i = 0; i < 9; ++i)
+            for (int c = 0; c < 3; ++c)
+                sums[i * 3 + c] += rgb[x * 3 + c] * basis[i] * weight;
+        sums[27] += weight;
+    }
+}
+
+#ifdef RG_SH_X86
+// four texels at a time, the basis evaluated in SSE lanes
+inline void projectRowSSE2(const float* rgb, int face, int size, float t, int begin, int end, float sums[28]) {
+    const float (&axes)[3][3] = cube::FACE_AXES[face];
+    __m128 acc[28];
+    for (__m128& a : acc)
+        a = _mm_setzero_ps();
+    const __m128 texelArea = _mm_set1_ps(4.0f / ((float)size * (float)size));
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 tt = _mm_set1_ps(t);
+    const __m128 step = _mm_set1_ps(2.0f / (float)size);
+    int x = begin;
+    for (; x + 4 <= end; x += 4) {
+        __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_set_ps(x + 3.5f, x + 2.5f, x + 1.5f, x + 0.5f), step), one);
+        __m128 lengthSquared = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(tt, tt)));
+        __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+        __m128 weight = _mm_div_ps(_mm_mul_ps(texelArea, inverseLength), lengthSquared);
+        __m128 d[3];
+        for (int i = 0; i < 3; ++i)
+            d[i] = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(axes[0][i])), _mm_set1_ps(t * axes[1][i])),
+                                         _mm_set1_ps(axes[2][i])), inverseLength);
+        __m128 basis[9];
+        basis[0] = _mm_set1_ps(0.282095f);
+        basis[1] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[1]);
+        basis[2] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[2]);
+        basis[3] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[0]);
+        basis[4] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[0], d[1]));
+        basis[5] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[1], d[2]));
+        basis[6] = _mm_mul_ps(_mm_set1_ps(0.315392f), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(d[2], d[2])), one));
+        basis[7] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[0], d[2]));
+        basis[8] = _mm_mul_ps(_mm_set1_ps(0.546274f), _mm_sub_ps(_mm_mul_ps(d[0], d[0]), _mm_mul_ps(d[1], d[1])));
+        // radiance, transposed from the interleaved texels
+        const float* p = rgb + x * 3;
+        __m128 color[3];
+        for (int c = 0; c < 3; ++c)
+            color[c] = _mm_mul_ps(_mm_set_ps(p[9 + c], p[6 + c], p[3 + c], p[c]), weight);
+        for (int i = 0; i < 9; ++i)
+            for (int c = 0; c < 3; ++c)
+                acc[i * 3 + c] = _mm_add_ps(acc[i * 3 + c], _mm_mul_ps(basis[i], color[c]));
+        acc[27] = _mm_add_ps(acc[27], weight);
+    }
+    for (int i = 0; i < 28; ++i) {
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc[i]);
+        sums[i] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    projectRowScalar(rgb, face, size, t, x, end, sums);
+}
+#endif
+
+inline void projectRow(const float* rgb, int face, int size, float t, float sums[28]) {
+#ifdef RG_SH_X86
+    projectRowSSE2(rgb, face, size, t, 0, size, sums);
+#else
+    projectRowScalar(rgb, face, size, t, 0, size, sums);
+#endif
+}
+
+// Projects the radiance onto the SH and convolves it with the clamped cosine, so evaluating the result at
+// a normal gives the irradiance over pi: the diffuse radiance leaving a white Lambertian surface.
+inline SH9 projectIrradiance(const FloatCube& cube) {
+    const std::array<std::vector<float>, 6>& faces = cube.levels[0];
+    int size = cube.size;
+    std::vector<std::array<float, 28>> partial(6 * size);
+    jobs().parallelFor(partial.size(), [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            int face = (int)(row / size), y = (int)(row % size);
+            float t = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+            partial[row].fill(0.0f);
+            projectRow(faces[face].data() + (size_t)y * size * 3, face, size, t, partial[row].data());
+        }
+    });
+    double sums[28] = {};
+    for (const std::array<float, 28>& row : partial)
+        for (int i = 0; i < 28; ++i)
+            sums[i] += row[i];
+
+    // the texel solid angles are approximate, they are rescaled to cover the sphere exactly;
+    // the clamped cosine's bands are pi, 2pi/3 and pi/4, divided by pi
+    const float bands[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+    double normalization = 4.0 * PI / sums[27];
+    SH9 sh;
+    for (int i = 0; i < 9; ++i)
+        for (int c = 0; c < 3; ++c)
+            sh.c[i][c] = (float)(sums[i * 3 + c] * normalization) * bands[i];
+    return sh;
+}
+
+// The coefficients of the environment turned by a rotation matrix: band 1 is a vector and turns as one,
+// band 2 is a traceless quadratic form n^T M n and turns as R M R^T. Cheap enough to do every frame.
+inline SH9 rotate(const SH9& sh, const glm::mat3& rotation) {
+    float r[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            r[i][j] = rotation[j][i];
+    const float k = 1.092548f * 0.5f, k0 = 0.315392f, k2 = 0.546274f;
+    SH9 out;
+    for (int c = 0; c < 3; ++c) {
+        out.c[0][c] = sh.c[0][c];
+
+        float v[3] = {sh.c[3][c], sh.c[1][c], sh.c[2][c]};
+        float rv[3];
+        for (int i = 0; i < 3; ++i)
+            rv[i] = r[i][0] * v[0] + r[i][1] * v[1] + r[i][2] * v[2];
+        out.c[1][c] = rv[1];
+        out.c[2][c] = rv[2];
+        out.c[3][c] = rv[0];
+
+        float m[3][3];
+        m[0][1] = m[1][0] = sh.c[4][c] * k;
+        m[1][2] = m[2][1] = sh.c[5][c] * k;
+        m[0][2] = m[2][0] = sh.c[7][c] * k;
+        m[0][0] = -sh.c[6][c] * k0 + sh.c[8][c] * k2;
+        m[1][1] = -sh.c[6][c] * k0 - sh.c[8][c] * k2;
+        m[2][2] = 2.0f * sh.c[6][c] * k0;
+        float rm[3][3], rmr[3][3];
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                rm[i][j] = r[i][0] * m[0][j] + r[i][1] * m[1][j] + r[i][2] * m[2][j];
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                rmr[i][j] = rm[i][0] * r[j][0] + rm[i][1] * r[j][1] + rm[i][2] * r[j][2];
+        out.c[4][c] = rmr[0][1] / k;
+        out.c[5][c] = rmr[1][2] / k;
+        out.c[6][c] = rmr[2][2] / (2.0f * k0);
+        out.c[7][c] = rmr[0][2] / k;
+        out.c[8][c] = (rmr[0][0] - rmr[1][1]) / (2.0f * k2);
+    }
+    return out;
+}
+
+// bilinear lookup in one level, clamped at the face edges
+inline void sampleLevel(const FloatCube& cube, int level, const float d[3], float out[3]) {
+    float ax = std::fabs(d[0]), ay = std::fabs(d[1]), az = std::fabs(d[2]);
+    int face;
+    float sc, tc, major;
+    if (ax >= ay && ax >= az) {
+        face = d[0] > 0.0f ? 0 : 1;
+        sc = d[0] > 0.0f ? -d[2] : d[2];
+        tc = -d[1];
+        major = ax;
+    } else if (ay >= az) {
+        face = d[1] > 0.0f ? 2 : 3;
+        sc = d[0];
+        tc = d[1] > 0.0f ? d[2] : -d[2];
+        major = ay;
+    } else {
+        face = d[2] > 0.0f ? 4 : 5;
+        sc = d[2] > 0.0f ? d[0] : -d[0];
+        tc = -d[1];
+        major = az;
+    }
+    int size = std::max(cube.size >> level, 1);
+    float fx = (sc / major * 0.5f + 0.5f) * size - 0.5f;
+    float fy = (tc / major * 0.5f + 0.5f) * size - 0.5f;
+    fx = std::min(std::max(fx, 0.0f), (float)(size - 1));
+    fy = std::min(std::max(fy, 0.0f), (float)(size - 1));
+    int x0 = (int)fx, y0 = (int)fy;
+    int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+    float wx = fx - x0, wy = fy - y0;
+    const float* texels = cube.levels[level][face].data();
+    for (int c = 0; c < 3; ++c) {
+        float top = texels[(y0 * size + x0) * 3 + c] * (1.0f - wx) + texels[(y0 * size + x1) * 3 + c] * wx;
+        float bottom = texels[(y1 * size + x0) * 3 + c] * (1.0f - wx) + texels[(y1 * size + x1) * 3 + c] * wx;
+        out[c] = top * (1.0f - wy) + bottom * wy;
+    }
+}
+
+inline void sample(const FloatCube& cube, const float d[3], float lod, float out[3]) {
+    lod = std::min(std::max(lod, 0.0f), (float)(cube.levels.size() - 1));
+    int level = (int)lod;
+    float blend = lod - level;
+    sampleLevel(cube, level, d, out);
+    if (blend > 0.0f && level + 1 < (int)cube.levels.size()) {
+        float next[3];
+        sampleLevel(cube, level + 1, d, next);
+        for (int c = 0; c < 3; ++c)
+            out[c] += (next[c] - out[c]) * blend;
+    }
+}
+
+// Prefilters the environment with the GGX lobe of the level's roughness for the split sum approximation
+// (Karis, "Real Shading in Unreal Engine 4"), taking n = v = r. The samples read a mip level that covers
+// their share of the lobe (filtered importance sampling), so few of them are needed.
+inline CubemapImage prefilterSpecular(const FloatCube& source) {
+    CubemapImage image;
+    image.faceSize = std::min(SPECULAR_SIZE, source.size);
+    image.levels.resize(SPECULAR_LEVELS);
+    float texelSolidAngle = 4.0f * PI / (6.0f * (float)source.size * (float)source.size);
+
+    std::vector<std::pair<int, int>> rows;
+    for (int level = 0; level < SPECULAR_LEVELS; ++level) {
+        int size = std::max(image.faceSize >> level, 1);
+        for (int face = 0; face < 6; ++face) {
+            image.levels[level][face].resize((size_t)size * size);
+            for (int y = 0; y < size; ++y)
+                rows.push_back(std::make_pair(level * 6 + face, y));
+        }
+    }
+
+    jobs().parallelFor(rows.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int level = rows[i].first / 6, face = rows[i].first % 6, y = rows[i].second;
+            int size = std::max(image.faceSize >> level, 1);
+            float roughness = (float)level / (float)(SPECULAR_LEVELS - 1);
+            float alpha = roughness * roughness;
+            for (int x = 0; x < size; ++x) {
+                float n[3];
+                cube::faceDirection(face, x, y, size, n);
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (float& component : n)
+                    component /= length;
+                float color[3] = {0.0f, 0.0f, 0.0f};
+                if (level == 0) {
+                    sample(source, n, std::log2((float)source.size / (float)size), color);
+                } else {
+                    // tangent frame around n
+                    float up[3] = {0.0f, 0.0f, 0.0f};
+                    up[std::fabs(n[2]) < 0.999f ? 2 : 0] = 1.0f;
+                    float tangent[3] = {up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0]};
+                    float tangentLength = std::sqrt(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+                    for (float& component : tangent)
+                        component /= tangentLength;
+                    float bitangent[3] = {n[1] * tangent[2] - n[2] * tangent[1], n[2] * tangent[0] - n[0] * tangent[2],
+                                          n[0] * tangent[1] - n[1] * tangent[0]};
+                    float totalWeight = 0.0f;
+                    for (int j = 0; j < SPECULAR_SAMPLES; ++j) {
+                        // Hammersley point, GGX distributed half vector
+                        uint32_t bits = (uint32_t)j;
+                        bits = (bits << 16) | (bits >> 16);
+                        bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+                        bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+                        bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+                        bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+                        float u = (float)j / (float)SPECULAR_SAMPLES, v = (float)bits * 2.3283064e-10f;
+                        float phi = 2.0f * PI * u;
+                        float cosTheta = std::sqrt((1.0f - v) / (1.0f + (alpha * alpha - 1.0f) * v));
+                        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+                        float h[3], l[3];
+                        for (int k = 0; k < 3; ++k)
+                            h[k] = tangent[k] * std::cos(phi) * sinTheta + bitangent[k] * std::sin(phi) * sinTheta + n[k] * cosTheta;
+                        for (int k = 0; k < 3; ++k)
+                            l[k] = 2.0f * cosTheta * h[k] - n[k];
+                        float nDotL = n[0] * l[0] + n[1] * l[1] + n[2] * l[2];
+                        if (nDotL <= 0.0f)
+                            continue;
+                        // with n = v the pdf of l is D / 4
+                        float denominator = cosTheta * cosTheta * (alpha * alpha - 1.0f) + 1.0f;
+                        float pdf = alpha * alpha / (PI * denominator * denominator) * 0.25f;
+                        float sampleSolidAngle = 1.0f / ((float)SPECULAR_SAMPLES * pdf + 1e-4f);
+                        float lod = 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+                        float radiance[3];
+                        sample(source, l, lod, radiance);
+                        for (int c = 0; c < 3; ++c)
+                            color[c] += radiance[c] * nDotL;
+                        totalWeight += nDotL;
+                    }
+                    for (float& component : color)
+                        component /= std::max(totalWeight, 1e-4f);
+                }
+                image.levels[level][face][(size_t)y * size + x] = cube::packRGB9E5(color[0], color[1], color[2]);
+            }
+        }
+    }, 4);
+    return image;
+}
+
+inline std::string cachePath(const std::vector<std::string>& sources) {
+    return sources[0] + ".ibl.ktx2";
+}
+
+}
+};
+
+struct EnvironmentSettings {
+    bool enabled = true;
+    // scales both terms; the skybox is further scaled by the moon's power, like the skybox pass does
+    float intensity = 2.0f;
+};
+
+struct EnvironmentStats {
+    bool cacheHit = false;
+    double shMs = 0.0;
+    double prefilterMs = 0.0;
+    double cacheReadMs = 0.0;
+    double uploadMs = 0.0;
+};
+
+// Image based lighting from the skybox: its irradiance as nine SH coefficients for the diffuse ambient,
+// and a GGX prefiltered mip chain for reflections. Both are built on the CPU when the skybox is loaded
+// and cached next to it. The skybox turns with its model matrix; the SH is rotated to match each frame
+// and the reflection vector is turned back into the cube map's space in the shader.
+class EnvironmentLighting {
+public:
+    EnvironmentSettings settings;
+
+    EnvironmentLighting() = default;
+
+    ~EnvironmentLighting() {
+        if (specular)
+            glDeleteTextures(1, &specular);
+    }
+
+    EnvironmentLighting(const EnvironmentLighting&) = delete;
+    EnvironmentLighting& operator=(const EnvironmentLighting&) = delete;
+
+    // from the loaded skybox; sources and maxFaceSize as given to rg::loadCubemapImage, they key the cache
+    bool build(const std::vector<std::string>& sources, const rg::CubemapImage& sky, int maxFaceSize) {
+        buildStats = EnvironmentStats();
+        if (!sky.valid())
+            return false;
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&start]() {
+            auto now = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(now - start).count();
+            start = now;
+            return ms;
+        };
+
+        std::string key = rg::cube::sourceKey(sources, maxFaceSize);
+        if (!key.empty())
+            key = std::string(rg::ibl::CACHE_VERSION) + ";" + key;
+        rg::CubemapImage prefiltered;
+        std::string data;
+        if (!key.empty() && rg::cube::readCache(rg::ibl::cachePath(sources), key, prefiltered, &data) &&
+            data.size() == sizeof(irradiance.c)) {
+            std::memcpy(irradiance.c, data.data(), data.size());
+            buildStats.cacheHit = true;
+            buildStats.cacheReadMs = elapsed();
+        } else {
+            rg::ibl::FloatCube diffuseSource = rg::ibl::unpack(sky, rg::ibl::SH_SOURCE_SIZE);
+            irradiance = rg::ibl::projectIrradiance(diffuseSource);
+            buildStats.shMs = elapsed();
+            rg::ibl::FloatCube specularSource = rg::ibl::unpack(sky, rg::ibl::SPECULAR_SIZE);
+            prefiltered = rg::ibl::prefilterSpecular(specularSource);
+            buildStats.prefilterMs = elapsed();
+            data.assign((const char*)irradiance.c, sizeof(irradiance.c));
+            if (key.empty() || !rg::cube::writeCache(rg::ibl::cachePath(sources), key, prefiltered, data))
+                std::cout << "ERROR::TEXTURE:: could not write environment lighting cache for " << sources[0] << std::endl;
+        }
+
+        if (specular)
+            glDeleteTextures(1, &specular);
+        rg::CubemapStats upload;
+        specular = rg::uploadCubemap(prefiltered, &upload);
+        buildStats.uploadMs = upload.uploadMs;
+        specularLevels = (int)prefiltered.levels.size();
+        return true;
+    }
+
+    bool ready() const { return specular != 0; }
+
+    // Binds the prefiltered map to the given unit and sets the shader's environment uniforms for the
+    // skybox's current rotation and power. The sampler is set even when disabled, a samplerCube left on
+    // unit 0 would clash with the 2D textures there.
+    void bind(Shader& shader, int unit, const glm::mat3& skyRotation, float skyPower) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, specular);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("prefilteredEnvironment", unit);
+        bool shown = settings.enabled && ready();
+        shader.setBool("environmentLighting", shown);
+        if (!shown)
+            return;
+        rg::ibl::SH9 rotated = rg::ibl::rotate(irradiance, skyRotation);
+        glUniform3fv(glGetUniformLocation(shader.ID, "irradianceSH"), 9, &rotated.c[0][0]);
+        shader.setMat3("environmentRotation", glm::transpose(skyRotation));
+        shader.setFloat("environmentMaxLod", (float)(specularLevels - 1));
+        shader.setFloat("environmentIntensity", settings.intensity * skyPower);
+    }
+
+    const EnvironmentStats& stats() const { return buildStats; }
+
+private:
+    rg::ibl::SH9 irradiance;
+    GLuint specular = 0;
+    int specularLevels = 0;
+    EnvironmentStats buildStats;
+};
+
+#endif //PROJECT_BASE_ENVIRONMENTLIGHTING_H
@@ -0,0 +1,129 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_FRAMEPIPELINE_H
+#define PROJECT_BASE_FRAMEPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs the simulation of frame N + 1 on its own thread while the caller renders frame N. The simulation
+// writes a State from an Input snapshot into one half of a double buffer, the render stage reads the
+// other half, and step() swaps them once per frame. The state being rendered therefore lags input by one
+// frame, in exchange the CPU frame costs max(simulate, render) instead of their sum.
+//
+// With threading switched off step() simulates inline and the state is rendered the frame it was made.
+template <typename Input, typename State>
+class FramePipeline {
+public:
+    typedef std::function<void(const Input& input, State& state)> Simulate;
+
+    explicit FramePipeline(Simulate simulate) : simulate(std::move(simulate)) {
+        thread = std::thread(&FramePipeline::threadMain, this);
+    }
+
+    ~FramePipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // publishes the frame simulated since the last call and starts the next one from input; current()
+    // is what to render until the next call
+    void step(const Input& input) {
+        if (pending) {
+            waitIdle();
+            front ^= 1;
+            pending = false;
+        }
+        // the first frame has nothing to show yet, so it is simulated in place
+        if (!threaded || !primed) {
+            run(input, states[front ^ 1]);
+            front ^= 1;
+            primed = true;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queuedInput = input;
+            queuedTarget = front ^ 1;
+            queued = true;
+        }
+        wake.notify_one();
+        pending = true;
+    }
+
+    const State& current() const { return states[front]; }
+
+    // the simulation owns everything it writes while a frame is pending, call this before touching it
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return !queued && !running; });
+    }
+
+    bool isThreaded() const { return threaded; }
+    // takes effect on the next step
+    void setThreaded(bool value) { threaded = value; }
+
+    // wall time of the last simulated frame
+    double simulateMs() const { return lastSimulateMs.load(std::memory_order_relaxed); }
+
+private:
+    Simulate simulate;
+    State states[2];
+    // the half render reads, only changed by step() while the simulation is idle
+    int front = 0;
+    bool threaded = true;
+    bool primed = false;
+    // a frame was handed to the thread and hasn't been published
+    bool pending = false;
+    std::atomic<double> lastSimulateMs{0.0};
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Input queuedInput;
+    int queuedTarget = 0;
+    bool queued = false;
+    bool running = false;
+    bool stopping = false;
+
+    void run(const Input& input, State& state) {
+        auto start = std::chrono::steady_clock::now();
+        simulate(input, state);
+        lastSimulateMs.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                             std::memory_order_relaxed);
+    }
+
+    void threadMain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || queued; });
+            if (stopping)
+                return;
+            Input input = queuedInput;
+            State& target = states[queuedTarget];
+            queued = false;
+            running = true;
+            lock.unlock();
+            run(input, target);
+            lock.lock();
+            running = false;
+            done.notify_all();
+        }
+    }
+};
+
+#endif //PROJECT_BASE_FRAMEPIPELINE_H
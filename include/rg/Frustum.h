@@ -0,0 +1,39 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_FRUSTUM_H
+#define PROJECT_BASE_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// view frustum planes extracted from a clip matrix (Gribb/Hartmann), normals point inwards
+class Frustum {
+public:
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4& clip) {
+        for (int i = 0; i < 3; ++i) {
+            glm::vec4 row(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+            glm::vec4 w(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+            planes[2 * i] = w + row;
+            planes[2 * i + 1] = w - row;
+        }
+    }
+
+    // conservative test of an axis aligned box given in the space the clip matrix expects
+    bool intersects(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 positive(plane.x > 0 ? boxMax.x : boxMin.x,
+                               plane.y > 0 ? boxMax.y : boxMin.y,
+                               plane.z > 0 ? boxMax.z : boxMin.z);
+            if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_FRUSTUM_H
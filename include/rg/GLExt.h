@@ -0,0 +1,90 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_GLEXT_H
+#define PROJECT_BASE_GLEXT_H
+
+#include <glad/glad.h>
+#include <cstring>
+
+// The bundled glad loader only covers core 3.3. Entry points from newer versions are declared
+// here the same way glad declares them and are resolved at runtime by rg::loadGLExtensions, so
+// code using them must check rg::glCaps first and keep a 3.3 fallback.
+
+#ifndef GL_VERSION_4_3
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_DRAW_INDIRECT_BUFFER_BINDING 0x8F43
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = nullptr;
+#define glMultiDrawElementsIndirect glad_glMultiDrawElementsIndirect
+#endif
+
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = nullptr;
+#define glBufferStorage glad_glBufferStorage
+#endif
+
+// BC1/BC3 are only exposed through EXT_texture_compression_s3tc; BC4/BC5 (RGTC) are core since 3.0
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace rg {
+
+struct GLCapabilities {
+    int major = 3;
+    int minor = 3;
+    // glMultiDrawElementsIndirect with a non-zero baseInstance (GL 4.3 or ARB_multi_draw_indirect + ARB_base_instance)
+    bool multiDrawIndirect = false;
+    // BC1/BC3 uploads through glCompressedTexImage2D
+    bool textureCompressionS3TC = false;
+    // immutable buffers that stay mapped while the GPU reads them (GL 4.4 or ARB_buffer_storage)
+    bool bufferStorage = false;
+};
+
+GLCapabilities glCaps;
+
+inline bool hasGLVersion(int major, int minor) {
+    return glCaps.major > major || (glCaps.major == major && glCaps.minor >= minor);
+}
+
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// must be called after gladLoadGLLoader, with the same loader
+inline void loadGLExtensions(GLADloadproc load) {
+    glCaps.major = GLVersion.major;
+    glCaps.minor = GLVersion.minor;
+
+    glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    glCaps.multiDrawIndirect = glad_glMultiDrawElementsIndirect != nullptr &&
+            (hasGLVersion(4, 3) || (hasGLExtension("GL_ARB_multi_draw_indirect") && hasGLExtension("GL_ARB_base_instance")));
+    glCaps.textureCompressionS3TC = hasGLExtension("GL_EXT_texture_compression_s3tc");
+
+    glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+    glCaps.bufferStorage = glad_glBufferStorage != nullptr &&
+            (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage"));
+}
+
+};
+
+#endif //PROJECT_BASE_GLEXT_H
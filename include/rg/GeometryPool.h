@@ -0,0 +1,327 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_GEOMETRYPOOL_H
+#define PROJECT_BASE_GEOMETRYPOOL_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+struct VertexAttribute {
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// describes one interleaved vertex layout; every pool owns exactly one format and one VAO
+struct VertexFormat {
+    GLsizei stride;
+    std::vector<VertexAttribute> attributes;
+};
+
+// a suballocated piece of the pool, drawn with glDrawElementsBaseVertex
+struct GeometryRange {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+    GLsizei vertexCount = 0;
+
+    bool valid() const { return indexCount > 0; }
+};
+
+struct GeometryPoolStats {
+    size_t vertexCapacity = 0;
+    size_t vertexUsed = 0;
+    size_t indexCapacity = 0;
+    size_t indexUsed = 0;
+
+    size_t uploadCount = 0;
+    size_t uploadBytes = 0;
+    double uploadMs = 0.0;
+    size_t growCount = 0;
+
+    size_t vertexFreeBlocks = 0;
+    size_t indexFreeBlocks = 0;
+    size_t largestVertexBlock = 0;
+    size_t largestIndexBlock = 0;
+
+    // 0 means all free space is one contiguous block, 1 means it is completely scattered
+    float vertexFragmentation = 0.0f;
+    float indexFragmentation = 0.0f;
+};
+
+// first-fit free list over a range of elements, adjacent free blocks are merged on release
+class FreeList {
+public:
+    explicit FreeList(size_t capacity = 0) : capacity(capacity) {
+        if (capacity > 0)
+            blocks.push_back({0, capacity});
+    }
+
+    bool allocate(size_t count, size_t& offset) {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blocks[i].size < count)
+                continue;
+            offset = blocks[i].offset;
+            blocks[i].offset += count;
+            blocks[i].size -= count;
+            if (blocks[i].size == 0)
+                blocks.erase(blocks.begin() + i);
+            return true;
+        }
+        return false;
+    }
+
+    void release(size_t offset, size_t count) {
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), offset,
+                                   [](const Block& b, size_t o) { return b.offset < o; });
+        it = blocks.insert(it, {offset, count});
+        // merge with the next block
+        auto next = it + 1;
+        if (next != blocks.end() && it->offset + it->size == next->offset) {
+            it->size += next->size;
+            blocks.erase(next);
+        }
+        // merge with the previous block
+        if (it != blocks.begin()) {
+            auto prev = it - 1;
+            if (prev->offset + prev->size == it->offset) {
+                prev->size += it->size;
+                blocks.erase(it);
+            }
+        }
+    }
+
+    void grow(size_t newCapacity) {
+        if (newCapacity <= capacity)
+            return;
+        release(capacity, newCapacity - capacity);
+        capacity = newCapacity;
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t blockCount() const { return blocks.size(); }
+
+    size_t freeTotal() const {
+        size_t total = 0;
+        for (const Block& b : blocks)
+            total += b.size;
+        return total;
+    }
+
+    size_t largestBlock() const {
+        size_t largest = 0;
+        for (const Block& b : blocks)
+            largest = std::max(largest, b.size);
+        return largest;
+    }
+
+    float fragmentation() const {
+        size_t total = freeTotal();
+        return total == 0 ? 0.0f : 1.0f - (float)largestBlock() / (float)total;
+    }
+
+private:
+    struct Block {
+        size_t offset;
+        size_t size;
+    };
+    std::vector<Block> blocks; // sorted by offset
+    size_t capacity;
+};
+
+// Shares one VBO/EBO/VAO between many meshes of the same vertex format, so drawing them
+// needs no VAO switches. Buffers grow (by copying on the GPU) when they run out of space.
+class GeometryPool {
+public:
+    GeometryPool(const VertexFormat& format, size_t vertexCapacity, size_t indexCapacity)
+            : format(format)
+            , vertexFree(vertexCapacity)
+            , indexFree(indexCapacity) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * format.stride, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        setupVertexArray();
+    }
+
+    ~GeometryPool() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // copies the mesh into the shared buffers; indices stay relative to the mesh's first vertex
+    GeometryRange allocate(const void* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount) {
+        GeometryRange range = reserve(vertexCount, indexCount);
+        if (!range.valid())
+            return range;
+        uploadVertices(range, 0, vertices, vertexCount);
+        uploadIndices(range, 0, indices, indexCount);
+        return range;
+    }
+
+    // only claims space, the contents follow through uploadVertices/uploadIndices (possibly in pieces)
+    GeometryRange reserve(size_t vertexCount, size_t indexCount) {
+        GeometryRange range;
+        if (vertexCount == 0 || indexCount == 0)
+            return range;
+
+        size_t vertexOffset, indexOffset;
+        while (!vertexFree.allocate(vertexCount, vertexOffset))
+            growVertices(vertexCount);
+        while (!indexFree.allocate(indexCount, indexOffset))
+            growIndices(indexCount);
+        poolStats.vertexUsed += vertexCount;
+        poolStats.indexUsed += indexCount;
+
+        range.baseVertex = (GLint)vertexOffset;
+        range.firstIndex = (GLuint)indexOffset;
+        range.vertexCount = (GLsizei)vertexCount;
+        range.indexCount = (GLsizei)indexCount;
+        return range;
+    }
+
+    // first is relative to the start of the range
+    void uploadVertices(const GeometryRange& range, size_t first, const void* vertices, size_t count) {
+        upload(VBO, (range.baseVertex + first) * format.stride, count * format.stride, vertices);
+    }
+
+    void uploadIndices(const GeometryRange& range, size_t first, const GLuint* indices, size_t count) {
+        upload(EBO, (range.firstIndex + first) * sizeof(GLuint), count * sizeof(GLuint), indices);
+    }
+
+    void release(GeometryRange& range) {
+        if (!range.valid())
+            return;
+        vertexFree.release(range.baseVertex, range.vertexCount);
+        indexFree.release(range.firstIndex, range.indexCount);
+        poolStats.vertexUsed -= range.vertexCount;
+        poolStats.indexUsed -= range.indexCount;
+        range = GeometryRange();
+    }
+
+    void bind() const {
+        glBindVertexArray(VAO);
+    }
+
+    // expects the pool to be bound
+    void draw(const GeometryRange& range) const {
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                                 (void*)(range.firstIndex * sizeof(GLuint)), range.baseVertex);
+    }
+
+    // draws several ranges that share the same shader state with a single call
+    void multiDraw(const GeometryRange* ranges, size_t count) const {
+        std::vector<GLsizei> counts(count);
+        std::vector<void*> offsets(count);
+        std::vector<GLint> baseVertices(count);
+        for (size_t i = 0; i < count; ++i) {
+            counts[i] = ranges[i].indexCount;
+            offsets[i] = (void*)(ranges[i].firstIndex * sizeof(GLuint));
+            baseVertices[i] = ranges[i].baseVertex;
+        }
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+                                      (GLsizei)count, baseVertices.data());
+    }
+
+    GLuint getVAO() const { return VAO; }
+    GLuint getVertexBuffer() const { return VBO; }
+    GLuint getIndexBuffer() const { return EBO; }
+
+    const GeometryPoolStats& stats() {
+        poolStats.vertexCapacity = vertexFree.getCapacity();
+        poolStats.indexCapacity = indexFree.getCapacity();
+        poolStats.vertexFreeBlocks = vertexFree.blockCount();
+        poolStats.indexFreeBlocks = indexFree.blockCount();
+        poolStats.largestVertexBlock = vertexFree.largestBlock();
+        poolStats.largestIndexBlock = indexFree.largestBlock();
+        poolStats.vertexFragmentation = vertexFree.fragmentation();
+        poolStats.indexFragmentation = indexFree.fragmentation();
+        return poolStats;
+    }
+
+private:
+    VertexFormat format;
+    FreeList vertexFree;
+    FreeList indexFree;
+    GeometryPoolStats poolStats;
+
+    unsigned int VAO, VBO, EBO;
+
+    void setupVertexArray() {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        for (const VertexAttribute& attribute : format.attributes) {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                                  format.stride, (void*)attribute.offset);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void upload(unsigned int buffer, size_t offset, size_t bytes, const void* data) {
+        auto start = std::chrono::steady_clock::now();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        auto end = std::chrono::steady_clock::now();
+
+        poolStats.uploadCount++;
+        poolStats.uploadBytes += bytes;
+        poolStats.uploadMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // reallocates a buffer with a bigger size and copies the old contents over, offsets stay valid
+    static void growBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes) {
+        unsigned int grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+    }
+
+    void growVertices(size_t atLeast) {
+        size_t oldCapacity = vertexFree.getCapacity();
+        size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + atLeast);
+        growBuffer(VBO, oldCapacity * format.stride, newCapacity * format.stride);
+        vertexFree.grow(newCapacity);
+        setupVertexArray();
+        poolStats.growCount++;
+    }
+
+    void growIndices(size_t atLeast) {
+        size_t oldCapacity = indexFree.getCapacity();
+        size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + atLeast);
+        growBuffer(EBO, oldCapacity * sizeof(GLuint), newCapacity * sizeof(GLuint));
+        indexFree.grow(newCapacity);
+        setupVertexArray();
+        poolStats.growCount++;
+    }
+};
+
+#endif //PROJECT_BASE_GEOMETRYPOOL_H
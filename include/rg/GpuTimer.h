@@ -0,0 +1,72 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_GPUTIMER_H
+#define PROJECT_BASE_GPUTIMER_H
+
+#include <glad/glad.h>
+
+// Measures GPU time between begin() and end() with GL_TIMESTAMP queries. Timestamps (unlike
+// GL_TIME_ELAPSED) may overlap, so pass timers can be nested inside a frame timer. Results are read
+// LATENCY frames later to avoid stalling the pipeline.
+class GpuTimer {
+public:
+    static const int LATENCY = 4;
+
+    GpuTimer() {
+        glGenQueries(2 * LATENCY, &queries[0][0]);
+    }
+
+    ~GpuTimer() {
+        glDeleteQueries(2 * LATENCY, &queries[0][0]);
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin() {
+        collect();
+        glQueryCounter(queries[current][0], GL_TIMESTAMP);
+        measuredFrame[current] = issued;
+    }
+
+    void end() {
+        glQueryCounter(queries[current][1], GL_TIMESTAMP);
+        pending[current] = true;
+        current = (current + 1) % LATENCY;
+        issued++;
+    }
+
+    // the latest resolved measurement and an exponential moving average of them
+    float lastMs() const { return last; }
+    float averageMs() const { return average; }
+    // measurements are numbered by their begin/end pair: the one lastMs() comes from, and the next to begin
+    unsigned int lastFrame() const { return lastIndex; }
+    unsigned int nextFrame() const { return issued; }
+
+private:
+    GLuint queries[LATENCY][2];
+    bool pending[LATENCY] = {};
+    unsigned int measuredFrame[LATENCY] = {};
+    int current = 0;
+    unsigned int issued = 0;
+    unsigned int lastIndex = 0;
+    float last = 0.0f;
+    float average = 0.0f;
+
+    // the slot about to be reused is the oldest one, its result is almost always available by now
+    void collect() {
+        if (!pending[current])
+            return;
+        GLuint64 start, end;
+        glGetQueryObjectui64v(queries[current][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[current][1], GL_QUERY_RESULT, &end);
+        pending[current] = false;
+        lastIndex = measuredFrame[current];
+        last = (float)((double)(end - start) / 1.0e6);
+        average = average == 0.0f ? last : average * 0.9f + last * 0.1f;
+    }
+};
+
+#endif //PROJECT_BASE_GPUTIMER_H
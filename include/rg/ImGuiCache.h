@@ -0,0 +1,113 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_IMGUICACHE_H
+#define PROJECT_BASE_IMGUICACHE_H
+
+#include <imgui.h>
+
+#include <cstring>
+#include <vector>
+
+// Keeps a copy of the last ImDrawData so an idle UI is drawn again without building it. The UI is
+// rebuilt when input reaches ImGui (mouse movement, which also covers hover changes, buttons, wheel,
+// keys, characters), when the display size changes, every frame while a widget is active, and
+// otherwise at most maxRefreshHz times a second so the values the windows show stay current.
+//
+// Input is read from ImGuiIO, so call needsRebuild after the platform backend's NewFrame and before
+// ImGui::NewFrame.
+class ImGuiFrameCache {
+public:
+    bool enabled = true;
+    // how often an idle UI is rebuilt
+    float maxRefreshHz = 15.0f;
+    // frames drawn from a fresh build and from the copy
+    unsigned long builtFrames = 0;
+    unsigned long cachedFrames = 0;
+
+    ImGuiFrameCache() = default;
+    ~ImGuiFrameCache() { clear(); }
+
+    ImGuiFrameCache(const ImGuiFrameCache&) = delete;
+    ImGuiFrameCache& operator=(const ImGuiFrameCache&) = delete;
+
+    bool needsRebuild(double time) const {
+        if (!enabled || !valid || interacting)
+            return true;
+        if (maxRefreshHz > 0.0f && time - lastBuild >= 1.0 / maxRefreshHz)
+            return true;
+        const ImGuiIO& io = ImGui::GetIO();
+        return io.MousePos.x != mousePos.x || io.MousePos.y != mousePos.y ||
+               std::memcmp(io.MouseDown, mouseDown, sizeof(mouseDown)) != 0 ||
+               io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f ||
+               std::memcmp(io.KeysDown, keysDown, sizeof(keysDown)) != 0 ||
+               io.KeyCtrl != keyCtrl || io.KeyShift != keyShift || io.KeyAlt != keyAlt || io.KeySuper != keySuper ||
+               io.InputQueueCharacters.Size > 0 ||
+               io.DisplaySize.x != displaySize.x || io.DisplaySize.y != displaySize.y;
+    }
+
+    // ImGui's clock only advances on the frames that are built
+    float deltaTime(double time) const {
+        return valid ? (float)(time - lastBuild) : ImGui::GetIO().DeltaTime;
+    }
+
+    // copies the draw data of the frame just built, after ImGui::Render
+    void store(double time) {
+        clear();
+        const ImDrawData* source = ImGui::GetDrawData();
+        if (!source || !source->Valid)
+            return;
+        drawData = *source;
+        lists.reserve(source->CmdListsCount);
+        for (int i = 0; i < source->CmdListsCount; ++i)
+            lists.push_back(source->CmdLists[i]->CloneOutput());
+        drawData.CmdLists = lists.empty() ? nullptr : lists.data();
+
+        const ImGuiIO& io = ImGui::GetIO();
+        mousePos = io.MousePos;
+        std::memcpy(mouseDown, io.MouseDown, sizeof(mouseDown));
+        std::memcpy(keysDown, io.KeysDown, sizeof(keysDown));
+        keyCtrl = io.KeyCtrl;
+        keyShift = io.KeyShift;
+        keyAlt = io.KeyAlt;
+        keySuper = io.KeySuper;
+        displaySize = io.DisplaySize;
+        // drags, text fields and the like animate or follow the mouse every frame
+        interacting = ImGui::IsAnyItemActive() || io.WantTextInput;
+        lastBuild = time;
+        valid = true;
+        builtFrames++;
+    }
+
+    ImDrawData* cached() {
+        cachedFrames++;
+        return &drawData;
+    }
+
+    // drops the copy, the next frame is built
+    void invalidate() { clear(); }
+
+private:
+    bool valid = false;
+    bool interacting = false;
+    double lastBuild = 0.0;
+    ImDrawData drawData;
+    std::vector<ImDrawList*> lists;
+
+    ImVec2 mousePos;
+    bool mouseDown[sizeof(ImGuiIO::MouseDown) / sizeof(bool)] = {};
+    bool keysDown[sizeof(ImGuiIO::KeysDown) / sizeof(bool)] = {};
+    bool keyCtrl = false, keyShift = false, keyAlt = false, keySuper = false;
+    ImVec2 displaySize;
+
+    void clear() {
+        for (ImDrawList* list : lists)
+            IM_DELETE(list);
+        lists.clear();
+        drawData.Clear();
+        valid = false;
+    }
+};
+
+#endif //PROJECT_BASE_IMGUICACHE_H
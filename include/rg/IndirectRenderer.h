@@ -0,0 +1,171 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_INDIRECTRENDERER_H
+#define PROJECT_BASE_INDIRECTRENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/Frustum.h>
+#include <rg/GeometryPool.h>
+#include <rg/GLExt.h>
+#include <rg/StreamBuffer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// layout mandated by GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct IndirectRendererStats {
+    unsigned int submittedMeshes = 0;
+    unsigned int culledMeshes = 0;
+    unsigned int drawCommands = 0;
+    unsigned int multiDrawCalls = 0;
+};
+
+// Collects the visible meshes of pooled models and draws them with one glMultiDrawElementsIndirect
+// per material. The model matrix of every draw is an instanced attribute (locations 5-8) indexed
+// by baseInstance, so shaders read it as aInstanceModel when useInstanceModel is set. Matrices and
+// commands are written straight into the stream buffer; the matrix attribute points at the start of
+// the stream buffer and baseInstance carries the matrices' offset in it. The matrix arrays are only
+// enabled inside flush(): the pool's VAO is shared with the ordinary draws, which must not source
+// attributes from a buffer that isn't attached. A draw call can't switch programs, so everything
+// submitted between begin() and flush() has to share the shader; the caller batches per shader.
+class IndirectRenderer {
+public:
+    static const GLuint MODEL_MATRIX_LOCATION = 5;
+
+    IndirectRenderer(GeometryPool& pool, StreamBuffer& stream) : pool(pool), stream(stream) {
+        // the divisor is part of the pool's VAO, the pool only touches locations of its vertex format;
+        // it has no effect while the arrays are disabled
+        pool.bind();
+        for (GLuint i = 0; i < 4; ++i)
+            glVertexAttribDivisor(MODEL_MATRIX_LOCATION + i, 1);
+        glBindVertexArray(0);
+    }
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // stats accumulate over all passes until reset, call this once per frame
+    void resetStats() {
+        frameStats = IndirectRendererStats();
+    }
+
+    void begin(const glm::mat4& viewProjection) {
+        this->viewProjection = viewProjection;
+        items.clear();
+        matrices.clear();
+    }
+
+    // frustum culls every mesh of the model, the model has to live in this renderer's pool
+    void submit(Model& model, const glm::mat4& transform) {
+        GLuint matrixIndex = (GLuint)matrices.size();
+        matrices.push_back(transform);
+        Frustum frustum(viewProjection * transform);
+        for (Mesh& mesh : model.meshes) {
+            frameStats.submittedMeshes++;
+            if (!frustum.intersects(mesh.boundsMin, mesh.boundsMax)) {
+                frameStats.culledMeshes++;
+                continue;
+            }
+            items.push_back({&mesh, matrixIndex});
+        }
+    }
+
+    // issues everything submitted since begin() with the given shader
+    void flush(Shader& shader) {
+        if (items.empty())
+            return;
+
+        // meshes sharing a material end up next to each other and form one multi draw
+        std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+            return batchKeyLess(*a.mesh, *b.mesh);
+        });
+
+        StreamAllocation matrixData = stream.allocateVertices(matrices.size() * sizeof(glm::mat4), sizeof(glm::mat4));
+        std::memcpy(matrixData.data, matrices.data(), matrixData.size);
+        stream.commit(matrixData);
+        GLuint firstMatrix = (GLuint)(matrixData.offset / sizeof(glm::mat4));
+
+        // written in order, the memory is write combined
+        StreamAllocation commandData = stream.allocateIndirect(items.size() * sizeof(DrawElementsIndirectCommand));
+        DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)commandData.data;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const GeometryRange& range = items[i].mesh->range;
+            commands[i] = {(GLuint)range.indexCount, 1, range.firstIndex, range.baseVertex, firstMatrix + items[i].matrixIndex};
+        }
+        stream.commit(commandData);
+
+        shader.setBool("useInstanceModel", true);
+        pool.bind();
+        // the stream buffer is replaced when it grows, so the pointer is set every flush
+        glBindBuffer(GL_ARRAY_BUFFER, matrixData.buffer);
+        for (GLuint i = 0; i < 4; ++i) {
+            glVertexAttribPointer(MODEL_MATRIX_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  (void*)(i * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(MODEL_MATRIX_LOCATION + i);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandData.buffer);
+        size_t batchStart = 0;
+        for (size_t i = 1; i <= items.size(); ++i) {
+            if (i < items.size() && !batchKeyLess(*items[batchStart].mesh, *items[i].mesh))
+                continue;
+            items[batchStart].mesh->BindTextures(shader);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void*)(commandData.offset + batchStart * sizeof(DrawElementsIndirectCommand)),
+                                        (GLsizei)(i - batchStart), 0);
+            frameStats.multiDrawCalls++;
+            batchStart = i;
+        }
+        frameStats.drawCommands += (unsigned int)items.size();
+        for (GLuint i = 0; i < 4; ++i)
+            glDisableVertexAttribArray(MODEL_MATRIX_LOCATION + i);
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setBool("useInstanceModel", false);
+
+        items.clear();
+        matrices.clear();
+    }
+
+    const IndirectRendererStats& stats() const { return frameStats; }
+
+private:
+    struct DrawItem {
+        Mesh* mesh;
+        GLuint matrixIndex;
+    };
+
+    GeometryPool& pool;
+    StreamBuffer& stream;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    std::vector<DrawItem> items;
+    std::vector<glm::mat4> matrices;
+    IndirectRendererStats frameStats;
+
+    // by material id; the textures only differ within an id when the material table overflowed into id 0
+    static bool batchKeyLess(const Mesh& a, const Mesh& b) {
+        if (a.materialId != b.materialId)
+            return a.materialId < b.materialId;
+        return std::lexicographical_compare(a.textures.begin(), a.textures.end(), b.textures.begin(), b.textures.end(),
+                                            [](const Texture& x, const Texture& y) { return x.id < y.id; });
+    }
+};
+
+#endif //PROJECT_BASE_INDIRECTRENDERER_H
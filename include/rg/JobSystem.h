@@ -0,0 +1,291 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_JOBSYSTEM_H
+#define PROJECT_BASE_JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job {
+    std::function<void()> function;
+    // decremented once the job has run, may be null
+    JobCounter* counter;
+};
+
+// Counts the jobs started against it that haven't finished yet. Waiting on it and running jobs after
+// it goes through JobSystem; a counter can be reused once it reached zero.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const {
+        if (pending.load(std::memory_order_acquire) != 0)
+            return false;
+        // the last job decrements under the lock, so taking it here means that job no longer touches
+        // the counter and the caller may destroy it
+        std::lock_guard<std::mutex> lock(mutex);
+        return true;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> pending{0};
+    mutable std::mutex mutex;
+    // started by JobSystem::runAfter, pushed when pending reaches zero
+    std::vector<Job> continuations;
+};
+
+struct JobSystemStats {
+    size_t jobsRun = 0;
+    // jobs taken from another thread's queue
+    size_t steals = 0;
+};
+
+// Fixed pool of worker threads with one double ended queue each. A worker pushes and pops its own jobs
+// at the back (the most recent first, while their data is still in cache) and when it runs dry steals
+// the oldest job from the front of another queue. Threads outside the pool push to a shared queue and,
+// while they wait on a counter, run jobs themselves instead of blocking, so waiting inside a job never
+// deadlocks the pool. Idle workers sleep on a condition variable.
+class JobSystem {
+public:
+    explicit JobSystem(unsigned workerCount) {
+        // the last queue is shared by every thread outside the pool
+        for (unsigned i = 0; i <= workerCount; ++i)
+            queues.emplace_back(new Queue());
+        for (unsigned i = 0; i < workerCount; ++i)
+            workers.emplace_back(&JobSystem::workerMain, this, i);
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned workerCount() const { return (unsigned)workers.size(); }
+
+    void run(std::function<void()> function, JobCounter* counter = nullptr) {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        submit(Job{std::move(function), counter});
+    }
+
+    // runs function once dependency reaches zero, right away when it already has
+    void runAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr) {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        Job job{std::move(function), counter};
+        {
+            std::lock_guard<std::mutex> lock(dependency.mutex);
+            if (dependency.pending.load(std::memory_order_acquire) != 0) {
+                dependency.continuations.push_back(std::move(job));
+                return;
+            }
+        }
+        submit(std::move(job));
+    }
+
+    // runs queued jobs on the calling thread until counter reaches zero
+    void wait(const JobCounter& counter) {
+        while (!counter.done()) {
+            Job job;
+            if (pop(job))
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // body(begin, end) over [0, count) in chunks of at least grain, returns once all have run; the
+    // default grain gives every thread a few chunks so stealing can even out uneven ones
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t grain = 0) {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = std::max<size_t>(1, count / ((workers.size() + 1) * 4));
+        if (grain >= count || workers.empty()) {
+            body(0, count);
+            return;
+        }
+        JobCounter counter;
+        // the calling thread takes the first chunk itself
+        for (size_t begin = grain; begin < count; begin += grain) {
+            size_t end = std::min(begin + grain, count);
+            run([&body, begin, end]() { body(begin, end); }, &counter);
+        }
+        body(0, grain);
+        wait(counter);
+    }
+
+    JobSystemStats stats() const {
+        JobSystemStats result;
+        result.jobsRun = jobsRun.load(std::memory_order_relaxed);
+        result.steals = steals.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // one worker per core besides the calling thread, which helps out whenever it waits
+    static unsigned defaultWorkerCount() {
+        return std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // jobs sitting in any queue, and workers asleep waiting for one
+    std::atomic<size_t> queued{0};
+    std::atomic<unsigned> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::atomic<size_t> jobsRun{0};
+    std::atomic<size_t> steals{0};
+
+    // the queue the calling thread owns in this system, the shared one for outside threads
+    size_t ownQueue() const {
+        const JobSystem*& system = currentSystem();
+        return system == this ? (size_t)currentWorker() : queues.size() - 1;
+    }
+
+    static const JobSystem*& currentSystem() {
+        static thread_local const JobSystem* system = nullptr;
+        return system;
+    }
+
+    static unsigned& currentWorker() {
+        static thread_local unsigned index = 0;
+        return index;
+    }
+
+    void submit(Job job) {
+        // without workers nothing would pick the job up unless someone happened to wait for it
+        if (workers.empty())
+            execute(job);
+        else
+            push(std::move(job));
+    }
+
+    void push(Job job) {
+        Queue& queue = *queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        queued.fetch_add(1);
+        // a worker going to sleep increments sleepers before it checks queued, so one of the two sees the other
+        if (sleepers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            wake.notify_one();
+        }
+    }
+
+    bool pop(Job& job) {
+        if (queued.load(std::memory_order_relaxed) == 0)
+            return false;
+        size_t own = ownQueue();
+        bool worker = own != queues.size() - 1;
+        {
+            Queue& queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                // workers take their newest job, outside threads share the queue oldest first
+                if (worker) {
+                    job = std::move(queue.jobs.back());
+                    queue.jobs.pop_back();
+                } else {
+                    job = std::move(queue.jobs.front());
+                    queue.jobs.pop_front();
+                }
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = *queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                queued.fetch_sub(1);
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(Job& job) {
+        job.function();
+        jobsRun.fetch_add(1, std::memory_order_relaxed);
+        JobCounter* counter = job.counter;
+        if (!counter)
+            return;
+        std::vector<Job> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter->continuations);
+        }
+        for (Job& continuation : ready)
+            submit(std::move(continuation));
+    }
+
+    void workerMain(unsigned index) {
+        currentSystem() = this;
+        currentWorker() = index;
+        while (true) {
+            Job job;
+            if (pop(job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1);
+            wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+            sleepers.fetch_sub(1);
+            if (stopping)
+                return;
+        }
+    }
+};
+
+namespace rg {
+
+// the engine's shared pool, started on first use
+inline JobSystem& jobs() {
+    static JobSystem instance(JobSystem::defaultWorkerCount());
+    return instance;
+}
+
+};
+
+#endif //PROJECT_BASE_JOBSYSTEM_H
@@ -0,0 +1,288 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_MAPPEDFILE_H
+#define PROJECT_BASE_MAPPEDFILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// A whole file mapped read-only. Readers get a pointer into the page cache instead of a copy; the
+// mapping lives as long as the object. The same interface also covers a range of another mapping (an
+// entry stored uncompressed in an AssetPack) and bytes that had to be produced in memory.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            if (info.st_size > 0) {
+                void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    bytes = (const unsigned char*)mapped;
+                    length = (size_t)info.st_size;
+                    ownsMapping = true;
+                }
+            } else {
+                // an empty file is valid, it just has nothing to map
+                empty = true;
+            }
+        }
+        // the mapping keeps the file referenced
+        ::close(fd);
+    }
+
+    // size bytes at offset in parent, which is kept mapped while this exists
+    MappedFile(std::shared_ptr<const MappedFile> parent, size_t offset, size_t size)
+            : bytes(size ? parent->data() + offset : nullptr), length(size), empty(size == 0), parent(std::move(parent)) {}
+
+    explicit MappedFile(std::vector<unsigned char> contents)
+            : length(contents.size()), empty(contents.empty()), buffer(std::move(contents)) {
+        bytes = buffer.empty() ? nullptr : buffer.data();
+    }
+
+    ~MappedFile() {
+        if (ownsMapping)
+            munmap((void*)bytes, length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return bytes != nullptr || empty; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    // the bytes live in memory of their own rather than in the page cache
+    bool inMemory() const { return !buffer.empty(); }
+
+    // hints the kernel to read the whole file ahead, returns immediately
+    void prefetch() const {
+#ifdef MADV_WILLNEED
+        if (!bytes || inMemory())
+            return;
+        // madvise wants a page aligned start, which a range of a mapping needn't have
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)bytes & ~(page - 1);
+        madvise((void*)start, length + ((uintptr_t)bytes - start), MADV_WILLNEED);
+#endif
+    }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+    bool empty = false;
+    bool ownsMapping = false;
+    std::shared_ptr<const MappedFile> parent;
+    std::vector<unsigned char> buffer;
+};
+
+// Somewhere assets are served from before the loose files are tried, see AssetPack.
+class AssetSource {
+public:
+    virtual ~AssetSource() = default;
+    // null when the source doesn't hold path
+    virtual std::shared_ptr<MappedFile> open(const std::string& path) = 0;
+    // size and modification time of the file the asset was made from, false when not held
+    virtual bool stat(const std::string& path, long long& size, long long& mtime) = 0;
+};
+
+struct AssetIORecord {
+    std::string path;
+    unsigned int reads = 0;
+    // bytes handed out as views into the mapping, and bytes that still had to be copied out of it
+    size_t bytesMapped = 0;
+    size_t bytesCopied = 0;
+    // open + map, plus the time the consumer spent reading through the mapping when it reports it
+    double ioMs = 0.0;
+};
+
+namespace assetio {
+
+inline std::mutex& mutex() {
+    static std::mutex instance;
+    return instance;
+}
+
+inline std::unordered_map<std::string, AssetIORecord>& records() {
+    static std::unordered_map<std::string, AssetIORecord> instance;
+    return instance;
+}
+
+// mappings opened by prefetchAssets by canonical path, reused by mapAsset whichever way a loader spells the path
+inline std::unordered_map<std::string, std::shared_ptr<MappedFile>>& prefetched() {
+    static std::unordered_map<std::string, std::shared_ptr<MappedFile>> instance;
+    return instance;
+}
+
+inline AssetSource*& source() {
+    static AssetSource* instance = nullptr;
+    return instance;
+}
+
+// absolute, with "." and ".." segments and repeated separators removed, without touching the files
+inline std::string normalizePath(const std::string& path) {
+    std::string absolute = path;
+    char cwd[PATH_MAX];
+    if ((path.empty() || path[0] != '/') && getcwd(cwd, sizeof(cwd)))
+        absolute = std::string(cwd) + "/" + path;
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (begin <= absolute.size()) {
+        size_t end = std::min(absolute.find('/', begin), absolute.size());
+        std::string part = absolute.substr(begin, end - begin);
+        if (part == "..") {
+            if (!parts.empty())
+                parts.pop_back();
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        begin = end + 1;
+    }
+    std::string result;
+    for (const std::string& part : parts)
+        result += "/" + part;
+    return result.empty() ? "/" : result;
+}
+
+// symlinks resolved when the file exists on disk, otherwise (an archived asset) only normalized
+inline std::string canonicalPath(const std::string& path) {
+    char resolved[PATH_MAX];
+    return realpath(path.c_str(), resolved) ? std::string(resolved) : normalizePath(path);
+}
+
+}
+
+inline void recordAssetIO(const std::string& path, size_t bytesMapped, size_t bytesCopied, double ms) {
+    std::lock_guard<std::mutex> lock(assetio::mutex());
+    AssetIORecord& record = assetio::records()[path];
+    record.path = path;
+    record.reads++;
+    record.bytesMapped += bytesMapped;
+    record.bytesCopied += bytesCopied;
+    record.ioMs += ms;
+}
+
+// per asset totals, sorted by path
+inline std::vector<AssetIORecord> assetIORecords() {
+    std::lock_guard<std::mutex> lock(assetio::mutex());
+    std::vector<AssetIORecord> result;
+    for (const auto& entry : assetio::records())
+        result.push_back(entry.second);
+    std::sort(result.begin(), result.end(), [](const AssetIORecord& a, const AssetIORecord& b) { return a.path < b.path; });
+    return result;
+}
+
+// serves assets from source first from now on, null unmounts; source must outlive its use
+inline void mountAssetSource(AssetSource* source) {
+    assetio::source() = source;
+}
+
+// the mounted source's copy of path, or the loose file mapped
+inline std::shared_ptr<MappedFile> openAsset(const std::string& path) {
+    if (AssetSource* source = assetio::source()) {
+        if (std::shared_ptr<MappedFile> file = source->open(path))
+            return file;
+    }
+    return std::make_shared<MappedFile>(path);
+}
+
+inline bool assetStat(const std::string& path, long long& size, long long& mtime) {
+    if (AssetSource* source = assetio::source()) {
+        if (source->stat(path, size, mtime))
+            return true;
+    }
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+        return false;
+    size = (long long)info.st_size;
+    mtime = (long long)info.st_mtime;
+    return true;
+}
+
+inline bool fileExists(const std::string& path) {
+    long long size, mtime;
+    return assetStat(path, size, mtime);
+}
+
+// maps an asset, or returns the mapping prefetchAssets already made; never null, check valid()
+inline std::shared_ptr<MappedFile> mapAsset(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<MappedFile> file;
+    std::string key = assetio::canonicalPath(path);
+    {
+        std::lock_guard<std::mutex> lock(assetio::mutex());
+        auto it = assetio::prefetched().find(key);
+        if (it != assetio::prefetched().end())
+            file = it->second;
+    }
+    if (!file)
+        file = openAsset(path);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // a compressed archive entry was decompressed into memory, which is a copy
+    if (file->valid())
+        recordAssetIO(path, file->inMemory() ? 0 : file->size(), file->inMemory() ? file->size() : 0, ms);
+    return file;
+}
+
+// Maps every file listed in the manifest (one path per line, relative to root, '#' starts a comment)
+// and asks the kernel to start reading them, so the loads that follow find them in the page cache.
+// The mappings are kept until releasePrefetchedAssets(). Returns the number of files mapped; entries
+// that can't be opened are reported, a stale manifest costs a failed open on every start.
+inline size_t prefetchAssets(const std::string& manifestPath, const std::string& root) {
+    // the manifest itself may be archived too
+    std::shared_ptr<MappedFile> contents = openAsset(manifestPath);
+    std::istringstream manifest(contents->size() ? std::string((const char*)contents->data(), contents->size()) : std::string());
+    std::string line;
+    size_t count = 0;
+    while (std::getline(manifest, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty())
+            continue;
+        std::string path = root.empty() ? line : root + "/" + line;
+        std::shared_ptr<MappedFile> file = openAsset(path);
+        if (!file->valid()) {
+            std::cout << "ERROR::ASSET_IO:: manifest entry " << line << " not found" << std::endl;
+            continue;
+        }
+        file->prefetch();
+        std::string key = assetio::canonicalPath(path);
+        std::lock_guard<std::mutex> lock(assetio::mutex());
+        assetio::prefetched()[key] = file;
+        count++;
+    }
+    return count;
+}
+
+// drops the prefetch mappings once loading is done, loaders holding a mapping keep theirs
+inline void releasePrefetchedAssets() {
+    std::lock_guard<std::mutex> lock(assetio::mutex());
+    assetio::prefetched().clear();
+}
+
+};
+
+#endif //PROJECT_BASE_MAPPEDFILE_H
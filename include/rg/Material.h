@@ -0,0 +1,151 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_MATERIAL_H
+#define PROJECT_BASE_MATERIAL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Where a material's texture goes. Each slot is bound to the texture unit of its index and to the
+// sampler named in TEXTURE_SLOT_NAMES, prefixed with the model's glslIdentifierPrefix.
+enum TextureSlot {
+    BaseColorTexture,
+    SpecularTexture,
+    NormalTexture,
+    HeightTexture,
+    MetallicRoughnessTexture,
+    EmissiveTexture,
+    TextureSlotCount
+};
+
+// the shaders' sampler names, the first four are the ones of the old texture_<type>N convention
+const char* const TEXTURE_SLOT_NAMES[TextureSlotCount] = {"texture_diffuse1", "texture_specular1", "texture_normal1",
+                                                          "texture_height1", "texture_metallic_roughness1",
+                                                          "texture_emissive1"};
+
+// One entry of the MaterialBlock uniform array, std140 layout. Textures are multiplied by the factors;
+// textureMask has bit 1 << slot set for every slot the material has a texture in.
+struct Material {
+    glm::vec4 baseColor = glm::vec4(1.0f);
+    glm::vec3 emissive = glm::vec3(0.0f);
+    float roughness = 1.0f;
+    float metalness = 0.0f;
+    float normalScale = 1.0f;
+    uint32_t textureMask = 0;
+    float padding = 0.0f;
+};
+
+static_assert(sizeof(Material) == 48, "Material must match the std140 layout of MaterialBlock");
+
+// Every material in use, deduplicated: meshes with the same factors and textures share an id, so sorting
+// draws by id groups the ones that can share texture bindings. Ids index the MaterialBlock array,
+// id 0 is the default material. Render thread only.
+class MaterialTable {
+public:
+    // MaterialBlock's array size in the shaders, 48 KB would exceed the 16 KB GL guarantees
+    static const unsigned int MAX_MATERIALS = 256;
+    // uniform buffer binding point of MaterialBlock
+    static const GLuint BINDING = 1;
+
+    MaterialTable() {
+        GLuint none[TextureSlotCount] = {};
+        add(Material(), none);
+    }
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // the id of an equal material with the same textures, added when there is none; 0 once the table is full
+    unsigned int add(const Material& material, const GLuint (&textures)[TextureSlotCount]) {
+        Entry entry;
+        entry.material = material;
+        std::memcpy(entry.textures, textures, sizeof(entry.textures));
+        std::string key((const char*)&entry, sizeof(entry));
+        auto found = ids.find(key);
+        if (found != ids.end())
+            return found->second;
+        if (entries.size() == MAX_MATERIALS) {
+            if (!overflowReported)
+                std::cout << "ERROR::MATERIAL:: more than " << MAX_MATERIALS << " materials, the rest use the default" << std::endl;
+            overflowReported = true;
+            return 0;
+        }
+        unsigned int id = (unsigned int)entries.size();
+        entries.push_back(entry);
+        ids[key] = id;
+        dirty = true;
+        return id;
+    }
+
+    const Material& material(unsigned int id) const { return entries[id].material; }
+    const GLuint* textures(unsigned int id) const { return entries[id].textures; }
+    size_t size() const { return entries.size(); }
+
+    // uploads the materials added since the last call and binds the array to BINDING
+    void bind() {
+        if (!buffer) {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(Material), nullptr, GL_DYNAMIC_DRAW);
+        }
+        if (dirty) {
+            std::vector<Material> packed(entries.size());
+            for (size_t i = 0; i < entries.size(); ++i)
+                packed[i] = entries[i].material;
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, packed.size() * sizeof(Material), packed.data());
+            dirty = false;
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+    }
+
+    // points the shader's MaterialBlock at BINDING, once after it is linked
+    static void connect(Shader& shader) {
+        GLuint index = glGetUniformBlockIndex(shader.ID, "MaterialBlock");
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, index, BINDING);
+    }
+
+    // the buffer goes before the context does
+    void release() {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        dirty = true;
+    }
+
+private:
+    struct Entry {
+        Material material;
+        GLuint textures[TextureSlotCount];
+    };
+
+    std::vector<Entry> entries;
+    std::map<std::string, unsigned int> ids;
+    GLuint buffer = 0;
+    bool dirty = true;
+    bool overflowReported = false;
+};
+
+namespace rg {
+
+inline MaterialTable& materials() {
+    static MaterialTable table;
+    return table;
+}
+
+};
+
+#endif //PROJECT_BASE_MATERIAL_H
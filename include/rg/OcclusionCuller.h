@@ -0,0 +1,135 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_OCCLUSIONCULLER_H
+#define PROJECT_BASE_OCCLUSIONCULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <vector>
+
+struct OcclusionStats {
+    // draws tested this frame, and drawn untested because their bounds reach the near plane
+    unsigned int tested = 0;
+    unsigned int skipped = 0;
+    // test results read back this frame (they are LATENCY frames old) and how many found nothing visible
+    unsigned int resolved = 0;
+    unsigned int occluded = 0;
+};
+
+// Occlusion culling with hardware queries and conditional rendering. Before an object is drawn its
+// bounding box is rasterized, without color or depth writes, into a GL_ANY_SAMPLES_PASSED query against
+// the depth of what was drawn so far; the object's draw calls then run under glBeginConditionalRender
+// and the GPU drops them when no sample passed. The CPU never waits for a result, it only reads old ones
+// back for the stats. Occluders (the church, the floor) have to be drawn before the objects tested.
+class OcclusionCuller {
+public:
+    static const int LATENCY = 4;
+
+    // objects are identified by an index below count, each has its own queries
+    explicit OcclusionCuller(int count) : boxShader("occlusion_box.vs", "occlusion_box.fs"), objects(count) {
+        // the box is generated from gl_VertexID, core profile still wants a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+        for (Object& object : objects)
+            glGenQueries(LATENCY, object.queries);
+    }
+
+    ~OcclusionCuller() {
+        for (Object& object : objects)
+            glDeleteQueries(LATENCY, object.queries);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    void beginFrame(const glm::mat4& viewProjection) {
+        this->viewProjection = viewProjection;
+        current = (current + 1) % LATENCY;
+        frameStats = OcclusionStats();
+    }
+
+    // Tests the bounds and starts conditional rendering on the result, the object's draw calls follow and
+    // endDraw() closes the block. Changes the bound program and VAO.
+    void beginDraw(int id, const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+        Object& object = objects[id];
+        collect(object);
+
+        // a box clipped by the near plane would hide an object the camera is next to or inside of
+        glm::mat4 mvp = viewProjection * model;
+        conditional = true;
+        for (int corner = 0; corner < 8 && conditional; ++corner) {
+            glm::vec3 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+                               (corner & 4) ? boundsMax.z : boundsMin.z);
+            glm::vec4 clip = mvp * glm::vec4(position, 1.0f);
+            conditional = clip.w > 0.0f && clip.z > -clip.w;
+        }
+        if (!conditional) {
+            frameStats.skipped++;
+            return;
+        }
+
+        boxShader.use();
+        boxShader.setMat4("mvp", mvp);
+        boxShader.setVec3("boundsMin", boundsMin);
+        boxShader.setVec3("boundsMax", boundsMax);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(emptyVAO);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, object.queries[current]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        glBindVertexArray(0);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        object.pending[current] = true;
+        frameStats.tested++;
+
+        // the wait happens on the GPU, right after a box of a few dozen pixels
+        glBeginConditionalRender(object.queries[current], GL_QUERY_WAIT);
+    }
+
+    void endDraw() {
+        if (conditional)
+            glEndConditionalRender();
+        conditional = false;
+    }
+
+    const OcclusionStats& stats() const { return frameStats; }
+
+private:
+    struct Object {
+        GLuint queries[LATENCY];
+        bool pending[LATENCY] = {};
+    };
+
+    Shader boxShader;
+    GLuint emptyVAO = 0;
+    std::vector<Object> objects;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    int current = 0;
+    bool conditional = false;
+    OcclusionStats frameStats;
+
+    // the result of the query about to be reused, skipped rather than waited for if it isn't there yet
+    void collect(Object& object) {
+        if (!object.pending[current])
+            return;
+        object.pending[current] = false;
+        GLuint available = 0;
+        glGetQueryObjectuiv(object.queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        GLuint visible = 0;
+        glGetQueryObjectuiv(object.queries[current], GL_QUERY_RESULT, &visible);
+        frameStats.resolved++;
+        if (!visible)
+            frameStats.occluded++;
+    }
+};
+
+#endif //PROJECT_BASE_OCCLUSIONCULLER_H
@@ -0,0 +1,261 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_POSTPROCESS_H
+#define PROJECT_BASE_POSTPROCESS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/GpuTimer.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+struct PostProcessSettings {
+    // number of bloom levels, each one half the size of the previous; fewer levels are cheaper
+    int bloomLevels = 5;
+    // the first bloom level is the scene size divided by this (2 or 4)
+    int bloomFirstDivisor = 2;
+    float bloomThreshold = 1.0f;
+    float bloomKnee = 0.5f;
+    float bloomIntensity = 0.6f;
+    float exposure = 1.0f;
+    // strength of the sharpening applied while upscaling a scene rendered below full resolution
+    float upscaleSharpness = 0.3f;
+};
+
+// Scene is rendered into an RGBA16F target, then a dual filter bloom chain (downsample into
+// progressively halved R11G11B10F textures, upsample back additively) and a filmic tonemapper
+// resolve it to the default framebuffer. The scene may be rendered into only the lower left
+// renderScale part of the target; the first bloom pass and the tonemapper then upscale from it.
+class PostProcess {
+public:
+    PostProcessSettings settings;
+
+    // whole GPU frame, from beginScene() to the end of tonemapping
+    GpuTimer frameTimer;
+    GpuTimer sceneTimer;
+    GpuTimer bloomDownTimer;
+    GpuTimer bloomUpTimer;
+    GpuTimer tonemapTimer;
+
+    PostProcess(int width, int height)
+            : downsampleShader("post_vertex.vs", "bloom_downsample.fs")
+            , upsampleShader("post_vertex.vs", "bloom_upsample.fs")
+            , tonemapShader("post_vertex.vs", "tonemap.fs") {
+        glGenVertexArrays(1, &fullscreenVAO);
+        glGenFramebuffers(1, &sceneFBO);
+        glGenFramebuffers(1, &bloomFBO);
+        glGenTextures(1, &sceneColor);
+        glGenRenderbuffers(1, &sceneDepth);
+        resize(width, height);
+    }
+
+    ~PostProcess() {
+        releaseBloomChain();
+        glDeleteVertexArrays(1, &fullscreenVAO);
+        glDeleteFramebuffers(1, &sceneFBO);
+        glDeleteFramebuffers(1, &bloomFBO);
+        glDeleteTextures(1, &sceneColor);
+        glDeleteRenderbuffers(1, &sceneDepth);
+    }
+
+    PostProcess(const PostProcess&) = delete;
+    PostProcess& operator=(const PostProcess&) = delete;
+
+    void resize(int width, int height) {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (width == sceneWidth && height == sceneHeight)
+            return;
+        sceneWidth = width;
+        sceneHeight = height;
+
+        glBindTexture(GL_TEXTURE_2D, sceneColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+        setLinearClamp();
+        glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::POSTPROCESS:: HDR framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        rebuildBloomChain();
+    }
+
+    // fraction of the target (per axis) the scene is rendered at, changing it never reallocates
+    void setRenderScale(float scale) {
+        renderScale = std::min(std::max(scale, 0.25f), 1.0f);
+    }
+
+    float getRenderScale() const { return renderScale; }
+
+    int getRenderWidth() const { return std::max((int)(sceneWidth * renderScale + 0.5f), 1); }
+    int getRenderHeight() const { return std::max((int)(sceneHeight * renderScale + 0.5f), 1); }
+
+    // everything drawn until endScene() lands in the HDR target
+    void beginScene() {
+        if (bloomLevelsBuilt != clampedLevels() || bloomDivisorBuilt != settings.bloomFirstDivisor)
+            rebuildBloomChain();
+        frameTimer.begin();
+        sceneTimer.begin();
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+        glViewport(0, 0, getRenderWidth(), getRenderHeight());
+    }
+
+    // runs bloom and tonemapping, the result is written to the default framebuffer of the given size;
+    // exposure multiplies settings.exposure and lets the caller adapt it to the scene's light
+    void endScene(int outputWidth, int outputHeight, float exposure = 1.0f) {
+        sceneTimer.end();
+
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(fullscreenVAO);
+
+        // maps [0, 1] texture coordinates onto the rendered part of the scene target, the clamp keeps
+        // bilinear taps from reaching texels that were not rendered this frame
+        glm::vec2 sceneTexelSize(1.0f / sceneWidth, 1.0f / sceneHeight);
+        glm::vec2 uvScale = glm::vec2(getRenderWidth(), getRenderHeight()) * sceneTexelSize;
+        glm::vec2 uvClamp = uvScale - sceneTexelSize * 0.5f;
+
+        bloomDownTimer.begin();
+        downsampleShader.use();
+        downsampleShader.setInt("source", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindFramebuffer(GL_FRAMEBUFFER, bloomFBO);
+        GLuint source = sceneColor;
+        glm::vec2 sourceSize(sceneWidth, sceneHeight);
+        for (size_t i = 0; i < bloomChain.size(); ++i) {
+            downsampleShader.setVec2("sourceTexelSize", glm::vec2(1.0f) / sourceSize);
+            downsampleShader.setBool("prefilter", i == 0);
+            downsampleShader.setVec2("uvScale", i == 0 ? uvScale : glm::vec2(1.0f));
+            downsampleShader.setVec2("uvClamp", i == 0 ? uvClamp : glm::vec2(1.0f));
+            downsampleShader.setFloat("threshold", settings.bloomThreshold);
+            downsampleShader.setFloat("knee", settings.bloomKnee);
+            renderTo(bloomChain[i]);
+            glBindTexture(GL_TEXTURE_2D, source);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            source = bloomChain[i].texture;
+            sourceSize = glm::vec2(bloomChain[i].width, bloomChain[i].height);
+        }
+        bloomDownTimer.end();
+
+        bloomUpTimer.begin();
+        upsampleShader.use();
+        upsampleShader.setInt("source", 0);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        for (size_t i = bloomChain.size(); i > 1; --i) {
+            const BloomLevel& from = bloomChain[i - 1];
+            upsampleShader.setVec2("sourceTexelSize", glm::vec2(1.0f / from.width, 1.0f / from.height));
+            renderTo(bloomChain[i - 2]);
+            glBindTexture(GL_TEXTURE_2D, from.texture);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glDisable(GL_BLEND);
+        bloomUpTimer.end();
+
+        tonemapTimer.begin();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, outputWidth, outputHeight);
+        tonemapShader.use();
+        tonemapShader.setInt("scene", 0);
+        tonemapShader.setInt("bloom", 1);
+        tonemapShader.setFloat("exposure", settings.exposure * exposure);
+        tonemapShader.setFloat("bloomIntensity", bloomChain.empty() ? 0.0f : settings.bloomIntensity);
+        tonemapShader.setVec2("uvScale", uvScale);
+        tonemapShader.setVec2("uvClamp", uvClamp);
+        tonemapShader.setVec2("sceneTexelSize", sceneTexelSize);
+        tonemapShader.setFloat("sharpness", renderScale < 1.0f ? settings.upscaleSharpness : 0.0f);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, sceneColor);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, bloomChain.empty() ? 0 : bloomChain[0].texture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glActiveTexture(GL_TEXTURE0);
+        tonemapTimer.end();
+        frameTimer.end();
+
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    GLuint getSceneFramebuffer() const { return sceneFBO; }
+    int getWidth() const { return sceneWidth; }
+    int getHeight() const { return sceneHeight; }
+
+private:
+    struct BloomLevel {
+        GLuint texture;
+        int width;
+        int height;
+    };
+
+    Shader downsampleShader;
+    Shader upsampleShader;
+    Shader tonemapShader;
+
+    // core profile still needs a VAO for the attribute-less fullscreen triangle
+    unsigned int fullscreenVAO;
+    unsigned int sceneFBO, bloomFBO;
+    unsigned int sceneColor, sceneDepth;
+    int sceneWidth = 0;
+    int sceneHeight = 0;
+    float renderScale = 1.0f;
+
+    std::vector<BloomLevel> bloomChain;
+    int bloomLevelsBuilt = 0;
+    int bloomDivisorBuilt = 0;
+
+    int clampedLevels() const {
+        return std::min(std::max(settings.bloomLevels, 0), 8);
+    }
+
+    static void setLinearClamp() {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    void renderTo(const BloomLevel& level) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, level.texture, 0);
+        glViewport(0, 0, level.width, level.height);
+    }
+
+    void releaseBloomChain() {
+        for (BloomLevel& level : bloomChain)
+            glDeleteTextures(1, &level.texture);
+        bloomChain.clear();
+    }
+
+    void rebuildBloomChain() {
+        releaseBloomChain();
+        settings.bloomFirstDivisor = settings.bloomFirstDivisor >= 4 ? 4 : 2;
+        int width = sceneWidth / settings.bloomFirstDivisor;
+        int height = sceneHeight / settings.bloomFirstDivisor;
+        for (int i = 0; i < clampedLevels() && width >= 2 && height >= 2; ++i) {
+            BloomLevel level{0, width, height};
+            glGenTextures(1, &level.texture);
+            glBindTexture(GL_TEXTURE_2D, level.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
+            setLinearClamp();
+            bloomChain.push_back(level);
+            width /= 2;
+            height /= 2;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        bloomLevelsBuilt = clampedLevels();
+        bloomDivisorBuilt = settings.bloomFirstDivisor;
+    }
+};
+
+#endif //PROJECT_BASE_POSTPROCESS_H
@@ -0,0 +1,249 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_STREAMBUFFER_H
+#define PROJECT_BASE_STREAMBUFFER_H
+
+#include <glad/glad.h>
+
+#include <rg/GLExt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// a range of the stream buffer the CPU writes this frame's data into
+struct StreamAllocation {
+    // write only, valid until StreamBuffer::commit
+    void* data = nullptr;
+    GLuint buffer = 0;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+};
+
+struct StreamBufferStats {
+    size_t capacity = 0;
+    size_t bytesLastFrame = 0;
+    unsigned int framesInFlight = 0;
+    // allocations that had to wait for the GPU to release older frames
+    size_t fenceWaits = 0;
+    double fenceWaitMs = 0.0;
+    size_t grows = 0;
+    bool persistent = false;
+};
+
+// Ring allocator for data that changes every frame (instance data, indirect commands, uniforms). The CPU
+// writes straight into GPU visible memory instead of re-specifying buffers with glBufferData, and a fence
+// per frame tells when the GPU is done with a range so it can be reused; the GL never has to synchronise
+// or rename a buffer behind our back.
+//
+// With ARB_buffer_storage (GL 4.4) the buffer is mapped once, persistently and coherently. On 3.3 each
+// allocation maps its range unsynchronized and commit() unmaps it, so an allocation has to be written
+// and committed before the next one is made. commit() is required on both paths.
+//
+// When a frame's own data doesn't fit the buffer grows; the old one stays alive until the GPU is done
+// with it, allocations already handed out keep their buffer name.
+class StreamBuffer {
+public:
+    explicit StreamBuffer(size_t capacity = 4 * 1024 * 1024) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        uniformAlignment = std::max(uniformAlignment, 4);
+        frameStats.persistent = rg::glCaps.bufferStorage;
+        create(capacity);
+    }
+
+    ~StreamBuffer() {
+        for (Frame& frame : inFlight)
+            glDeleteSync(frame.fence);
+        for (Retired& retired : retiredBuffers) {
+            if (retired.fence)
+                glDeleteSync(retired.fence);
+            glDeleteBuffers(1, &retired.buffer);
+        }
+        glDeleteBuffers(1, &bufferId);
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    StreamAllocation allocate(size_t size, size_t alignment) {
+        StreamAllocation allocation;
+        if (size == 0)
+            return allocation;
+        size_t offset;
+        while (!fits(size, alignment, offset)) {
+            if (inFlight.empty()) {
+                grow(size + alignment);
+                continue;
+            }
+            waitOldest();
+        }
+        // nothing live, the frame restarts at the front
+        if (inFlight.empty() && frameBytes == 0)
+            frameStart = offset;
+        head = offset + size;
+        frameBytes += size;
+
+        allocation.buffer = bufferId;
+        allocation.offset = (GLintptr)offset;
+        allocation.size = (GLsizeiptr)size;
+        if (mapped) {
+            allocation.data = mapped + offset;
+        } else {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, bufferId);
+            allocation.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        }
+        return allocation;
+    }
+
+    // aligned for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+    StreamAllocation allocateUniforms(size_t size) {
+        return allocate(size, (size_t)uniformAlignment);
+    }
+
+    // aligned to the stride, so offset / stride is the first element for baseVertex or baseInstance
+    StreamAllocation allocateVertices(size_t size, size_t stride) {
+        return allocate(size, stride);
+    }
+
+    // for GL_DRAW_INDIRECT_BUFFER, whose offsets have to be multiples of 4
+    StreamAllocation allocateIndirect(size_t size) {
+        return allocate(size, 4);
+    }
+
+    void commit(const StreamAllocation& allocation) {
+        if (mapped || !allocation.data)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, allocation.buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // after the last draw reading this frame's allocations
+    void endFrame() {
+        if (frameBytes > 0) {
+            inFlight.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameStart});
+            frameStart = head;
+        }
+        for (Retired& retired : retiredBuffers) {
+            if (!retired.fence)
+                retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        // release what the GPU finished without blocking
+        while (!inFlight.empty() && signaled(inFlight.front().fence, 0)) {
+            glDeleteSync(inFlight.front().fence);
+            inFlight.pop_front();
+        }
+        retiredBuffers.erase(std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [this](Retired& retired) {
+            if (!signaled(retired.fence, 0))
+                return false;
+            glDeleteSync(retired.fence);
+            glDeleteBuffers(1, &retired.buffer);
+            return true;
+        }), retiredBuffers.end());
+
+        frameStats.bytesLastFrame = frameBytes;
+        frameStats.framesInFlight = (unsigned int)inFlight.size();
+        frameBytes = 0;
+    }
+
+    GLuint buffer() const { return bufferId; }
+    bool persistent() const { return mapped != nullptr; }
+    const StreamBufferStats& stats() const { return frameStats; }
+
+private:
+    struct Frame {
+        GLsync fence;
+        // where the frame's allocations begin, they run up to the next frame's start
+        size_t start;
+    };
+
+    struct Retired {
+        GLuint buffer;
+        GLsync fence;
+    };
+
+    GLuint bufferId = 0;
+    size_t capacity = 0;
+    unsigned char* mapped = nullptr;
+    GLint uniformAlignment = 256;
+
+    // the next free byte, and where the current frame's allocations start
+    size_t head = 0;
+    size_t frameStart = 0;
+    size_t frameBytes = 0;
+    std::deque<Frame> inFlight;
+    std::vector<Retired> retiredBuffers;
+    StreamBufferStats frameStats;
+
+    void create(size_t size) {
+        capacity = size;
+        glGenBuffers(1, &bufferId);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferId);
+        if (rg::glCaps.bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+        } else {
+            glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        head = frameStart = 0;
+        frameStats.capacity = capacity;
+    }
+
+    // the current frame outgrew the whole ring: continue in a bigger buffer, the old one is deleted once
+    // the GPU has finished this frame
+    void grow(size_t needed) {
+        retiredBuffers.push_back({bufferId, nullptr});
+        for (Frame& frame : inFlight)
+            glDeleteSync(frame.fence);
+        inFlight.clear();
+        mapped = nullptr;
+        create(std::max(capacity * 2, needed * 2));
+        frameBytes = 0;
+        frameStats.grows++;
+    }
+
+    // the ring is used from the oldest in-flight frame's start up to head, wrapping at the end
+    bool fits(size_t size, size_t alignment, size_t& offset) const {
+        bool empty = inFlight.empty() && frameBytes == 0;
+        if (empty) {
+            offset = 0;
+            return size <= capacity;
+        }
+        size_t tail = inFlight.empty() ? frameStart : inFlight.front().start;
+        offset = (head + alignment - 1) / alignment * alignment;
+        if (head > tail) {
+            if (offset + size <= capacity)
+                return true;
+            // the rest of the buffer is skipped, it is free again once this frame's fence passes
+            offset = 0;
+            return size <= tail;
+        }
+        // head == tail with something in flight means the ring is full
+        return offset + size <= tail;
+    }
+
+    void waitOldest() {
+        auto start = std::chrono::steady_clock::now();
+        // the range is only reused once the GPU is done with it, a timeout just waits again
+        while (!signaled(inFlight.front().fence, 1000000000ull))
+            ;
+        glDeleteSync(inFlight.front().fence);
+        inFlight.pop_front();
+        frameStats.fenceWaits++;
+        frameStats.fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static bool signaled(GLsync fence, GLuint64 timeout) {
+        GLenum result = glClientWaitSync(fence, timeout ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+        // a failed wait can't be retried, treat the range as released rather than block forever
+        return result != GL_TIMEOUT_EXPIRED;
+    }
+};
+
+#endif //PROJECT_BASE_STREAMBUFFER_H
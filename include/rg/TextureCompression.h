@@ -0,0 +1,565 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_TEXTURECOMPRESSION_H
+#define PROJECT_BASE_TEXTURECOMPRESSION_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <rg/AssetIO.h>
+#include <rg/GLExt.h>
+#include <rg/JobSystem.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// BC1 for opaque color, BC3 when there is real alpha, BC4/BC5 for one and two channel data
+enum class BlockFormat { BC1, BC3, BC4, BC5 };
+
+struct CompressedLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> data;
+};
+
+// a block compressed texture with its whole mip chain, ready for glCompressedTexImage2D
+struct CompressedImage {
+    BlockFormat format = BlockFormat::BC1;
+    int width = 0;
+    int height = 0;
+    // components of the source image, so the uncompressed cost can be reported
+    int sourceComponents = 0;
+    std::vector<CompressedLevel> levels;
+
+    bool valid() const { return !levels.empty(); }
+
+    size_t sizeInBytes() const {
+        size_t bytes = 0;
+        for (const CompressedLevel& level : levels)
+            bytes += level.data.size();
+        return bytes;
+    }
+
+    // what the old path allocated: 8 bits per component (RGB counted as RGBA, as drivers pad it) plus a full mip chain
+    size_t uncompressedSizeInBytes() const {
+        size_t texelBytes = sourceComponents == 3 ? 4 : sourceComponents;
+        size_t bytes = 0;
+        for (const CompressedLevel& level : levels)
+            bytes += (size_t)level.width * level.height * texelBytes;
+        return bytes;
+    }
+};
+
+struct TextureCompressionStats {
+    unsigned int textures = 0;
+    unsigned int cacheHits = 0;
+    size_t compressedBytes = 0;
+    size_t uncompressedBytes = 0;
+    // decode + mips + encode + cache write for misses, cache read for hits
+    double encodeMs = 0.0;
+    double cacheReadMs = 0.0;
+    double uploadMs = 0.0;
+};
+
+namespace bc {
+
+inline int blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+inline GLenum glInternalFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+    return GL_NONE;
+}
+
+// VkFormat values used in the cache header
+inline uint32_t vkFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return 131; // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case BlockFormat::BC3: return 137; // VK_FORMAT_BC3_UNORM_BLOCK
+        case BlockFormat::BC4: return 139; // VK_FORMAT_BC4_UNORM_BLOCK
+        case BlockFormat::BC5: return 141; // VK_FORMAT_BC5_UNORM_BLOCK
+    }
+    return 0;
+}
+
+inline bool fromVkFormat(uint32_t value, BlockFormat& format) {
+    for (BlockFormat candidate : {BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5}) {
+        if (vkFormat(candidate) == value) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// splits [0, count) into chunks run on the shared job pool, the calling thread included
+inline void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body) {
+    jobs().parallelFor(count, body);
+}
+
+inline uint16_t packRGB565(const int color[3]) {
+    return (uint16_t)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+inline void unpackRGB565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block from 16 RGBA texels: endpoints from the inset bounding box (its diagonal flipped to
+// follow the color covariance), then every texel snapped to the nearest of the four palette entries
+inline void encodeBC1Block(const unsigned char* rgba, unsigned char* out) {
+    int minColor[3] = {255, 255, 255}, maxColor[3] = {0, 0, 0};
+    int mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            minColor[c] = std::min(minColor[c], (int)rgba[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], (int)rgba[i * 4 + c]);
+            mean[c] += rgba[i * 4 + c];
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+        mean[c] = (mean[c] + 8) / 16;
+
+    // the box spans from min to max in every channel, but the colors may run along another diagonal
+    int covRG = 0, covRB = 0;
+    for (int i = 0; i < 16; ++i) {
+        int r = rgba[i * 4] - mean[0];
+        covRG += r * (rgba[i * 4 + 1] - mean[1]);
+        covRB += r * (rgba[i * 4 + 2] - mean[2]);
+    }
+    if (covRG < 0)
+        std::swap(minColor[1], maxColor[1]);
+    if (covRB < 0)
+        std::swap(minColor[2], maxColor[2]);
+
+    // inset by 1/16 of the range, the extremes are usually outliers
+    for (int c = 0; c < 3; ++c) {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        minColor[c] = std::min(std::max(minColor[c] + inset, 0), 255);
+        maxColor[c] = std::min(std::max(maxColor[c] - inset, 0), 255);
+    }
+
+    uint16_t color0 = packRGB565(maxColor);
+    uint16_t color1 = packRGB565(minColor);
+    // color0 > color1 selects the four color mode
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int c0[3], c1[3];
+        unpackRGB565(color0, c0);
+        unpackRGB565(color1, c1);
+        int dir[3] = {c0[0] - c1[0], c0[1] - c1[1], c0[2] - c1[2]};
+        int lengthSq = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        // position along the line in thirds: 0 is color1, 3 is color0
+        static const uint32_t thirdsToIndex[4] = {1, 3, 2, 0};
+        for (int i = 0; i < 16; ++i) {
+            int dot = (rgba[i * 4] - c1[0]) * dir[0] + (rgba[i * 4 + 1] - c1[1]) * dir[1] + (rgba[i * 4 + 2] - c1[2]) * dir[2];
+            int thirds = std::min(std::max((dot * 3 + lengthSq / 2) / lengthSq, 0), 3);
+            indices |= thirdsToIndex[thirds] << (2 * i);
+        }
+    }
+
+    out[0] = color0 & 0xff;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xff;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+// expands a four color mode BC1 block back to 16 RGBA texels, for contexts that can't sample BC1
+inline void decodeBC1Block(const unsigned char* in, unsigned char* rgba) {
+    int palette[4][3];
+    unpackRGB565((uint16_t)(in[0] | in[1] << 8), palette[0]);
+    unpackRGB565((uint16_t)(in[2] | in[3] << 8), palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | (uint32_t)in[7] << 24;
+    for (int i = 0; i < 16; ++i) {
+        const int* color = palette[(indices >> (2 * i)) & 3];
+        rgba[i * 4] = (unsigned char)color[0];
+        rgba[i * 4 + 1] = (unsigned char)color[1];
+        rgba[i * 4 + 2] = (unsigned char)color[2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+// BC4 block for one channel of 16 RGBA texels, in the eight value mode between the block's min and max
+inline void encodeBC4Block(const unsigned char* rgba, int channel, unsigned char* out) {
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; ++i) {
+        minValue = std::min(minValue, (int)rgba[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)rgba[i * 4 + channel]);
+    }
+
+    uint64_t indices = 0;
+    if (maxValue != minValue) {
+        int range = maxValue - minValue;
+        // position in sevenths: 0 is the min (index 1), 7 the max (index 0), steps in between run 7..2
+        static const uint64_t seventhsToIndex[8] = {1, 7, 6, 5, 4, 3, 2, 0};
+        for (int i = 0; i < 16; ++i) {
+            int sevenths = ((rgba[i * 4 + channel] - minValue) * 7 + range / 2) / range;
+            indices |= seventhsToIndex[sevenths] << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char)maxValue;
+    out[1] = (unsigned char)minValue;
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+// gathers a 4x4 block, texels past the right/bottom edge repeat the last row/column
+inline void fetchBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, unsigned char* block) {
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(blockX * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+        }
+    }
+}
+
+// encodes one RGBA8 level, block rows are spread over the hardware threads
+inline CompressedLevel encodeLevel(const unsigned char* rgba, int width, int height, BlockFormat format) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    int bytes = blockBytes(format);
+
+    CompressedLevel level{width, height, std::vector<unsigned char>((size_t)blocksX * blocksY * bytes)};
+    unsigned char* out = level.data.data();
+    parallelFor(blocksY, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                fetchBlock(rgba, width, height, bx, (int)by, block);
+                unsigned char* dst = out + ((size_t)by * blocksX + bx) * bytes;
+                switch (format) {
+                    case BlockFormat::BC1:
+                        encodeBC1Block(block, dst);
+                        break;
+                    case BlockFormat::BC3:
+                        encodeBC4Block(block, 3, dst);
+                        encodeBC1Block(block, dst + 8);
+                        break;
+                    case BlockFormat::BC4:
+                        encodeBC4Block(block, 0, dst);
+                        break;
+                    case BlockFormat::BC5:
+                        encodeBC4Block(block, 0, dst);
+                        encodeBC4Block(block, 1, dst + 8);
+                        break;
+                }
+            }
+        }
+    });
+    return level;
+}
+
+// 2x2 box filter, odd edges reuse the last texel
+inline std::vector<unsigned char> downsample(const unsigned char* rgba, int width, int height, int& outWidth, int& outHeight) {
+    outWidth = std::max(width / 2, 1);
+    outHeight = std::max(height / 2, 1);
+    std::vector<unsigned char> result((size_t)outWidth * outHeight * 4);
+    for (int y = 0; y < outHeight; ++y) {
+        int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < outWidth; ++x) {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; ++c) {
+                int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c] +
+                          rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+                result[((size_t)y * outWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// Cache files follow the KTX2 layout (identifier, header, level index, key/value data, level data) but
+// carry no data format descriptor, so they are only meant to be read back by loadCompressedImage.
+const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+// bump when the encoder output changes, older cache files are then rebuilt
+const char* const CACHE_VERSION = "rg-bc-1";
+
+struct Ktx2Header {
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+inline std::string cachePath(const std::string& source) {
+    return source + ".ktx2";
+}
+
+// identifies the source file version the cache was built from
+inline std::string sourceKey(const std::string& source) {
+    // an archived source reports the size and time of the file it was packed from
+    long long size, mtime;
+    if (!assetStat(source, size, mtime))
+        return std::string();
+    return std::string(CACHE_VERSION) + ":" + std::to_string(size) + ":" + std::to_string(mtime);
+}
+
+inline bool writeCache(const std::string& path, const std::string& key, const CompressedImage& image) {
+    // written next to the cache and renamed over it, a reader may still have the old file mapped
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+
+    // one key/value pair: length, "rg.source\0", key, "\0", padded to 4 bytes
+    std::string kvd = std::string("rg.source") + '\0' + key + '\0';
+    uint32_t kvdLength = (uint32_t)kvd.size();
+    std::string kvdBlock((const char*)&kvdLength, 4);
+    kvdBlock += kvd;
+    kvdBlock.resize((kvdBlock.size() + 7) / 8 * 8, '\0');
+
+    Ktx2Header header{};
+    header.vkFormat = vkFormat(image.format);
+    header.typeSize = 1;
+    header.pixelWidth = image.width;
+    header.pixelHeight = image.height;
+    header.faceCount = 1;
+    header.levelCount = (uint32_t)image.levels.size();
+    header.kvdByteOffset = (uint32_t)(sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + image.levels.size() * sizeof(Ktx2Level));
+    header.kvdByteLength = (uint32_t)kvdBlock.size();
+
+    std::vector<Ktx2Level> index(image.levels.size());
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        index[i].byteOffset = offset;
+        index[i].byteLength = index[i].uncompressedByteLength = image.levels[i].data.size();
+        offset += image.levels[i].data.size();
+    }
+
+    bool ok = std::fwrite(KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER), 1, file) == 1 &&
+              std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(index.data(), sizeof(Ktx2Level), index.size(), file) == index.size() &&
+              std::fwrite(kvdBlock.data(), 1, kvdBlock.size(), file) == kvdBlock.size();
+    for (const CompressedLevel& level : image.levels)
+        ok = ok && std::fwrite(level.data.data(), 1, level.data.size(), file) == level.data.size();
+    ok = std::fclose(file) == 0 && ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    if (!ok)
+        std::remove(temporary.c_str());
+    return ok;
+}
+
+inline bool readCache(const std::string& path, const std::string& key, CompressedImage& image) {
+    std::shared_ptr<MappedFile> file = mapAsset(path);
+    const unsigned char* bytes = file->data();
+    size_t size = file->size();
+    auto fits = [size](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+    Ktx2Header header;
+    bool ok = fits(0, sizeof(KTX2_IDENTIFIER) + sizeof(header)) &&
+              std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    if (ok) {
+        std::memcpy(&header, bytes + sizeof(KTX2_IDENTIFIER), sizeof(header));
+        ok = fromVkFormat(header.vkFormat, image.format) && header.levelCount > 0 && header.levelCount <= 32;
+    }
+
+    std::vector<Ktx2Level> index;
+    size_t indexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(header);
+    if (ok) {
+        index.resize(header.levelCount);
+        ok = fits(indexOffset, index.size() * sizeof(Ktx2Level));
+        if (ok)
+            std::memcpy(index.data(), bytes + indexOffset, index.size() * sizeof(Ktx2Level));
+    }
+
+    // a stale cache (source edited since, or an older encoder) is ignored and rebuilt
+    if (ok) {
+        std::string expected = std::string("rg.source") + '\0' + key + '\0';
+        ok = header.kvdByteLength >= 4 + expected.size() && header.kvdByteLength <= 4096 &&
+             fits(header.kvdByteOffset, header.kvdByteLength) &&
+             std::memcmp(bytes + header.kvdByteOffset + 4, expected.data(), expected.size()) == 0;
+    }
+
+    if (ok) {
+        image.width = header.pixelWidth;
+        image.height = header.pixelHeight;
+        image.levels.clear();
+        int width = image.width, height = image.height;
+        size_t copied = 0;
+        for (const Ktx2Level& entry : index) {
+            ok = ok && fits(entry.byteOffset, entry.byteLength);
+            if (!ok)
+                break;
+            // the levels outlive the mapping (the streamer keeps them in system memory), so they are copied
+            CompressedLevel level{width, height, std::vector<unsigned char>(bytes + entry.byteOffset, bytes + entry.byteOffset + entry.byteLength)};
+            copied += level.data.size();
+            image.levels.push_back(std::move(level));
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        recordAssetIO(path, 0, copied, 0.0);
+    }
+    if (!ok)
+        image.levels.clear();
+    return ok;
+}
+
+inline std::mutex& statsMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+inline TextureCompressionStats& mutableStats() {
+    static TextureCompressionStats stats;
+    return stats;
+}
+
+}
+
+inline TextureCompressionStats textureCompressionStats() {
+    std::lock_guard<std::mutex> lock(bc::statsMutex());
+    return bc::mutableStats();
+}
+
+inline bool canUploadCompressed(BlockFormat format) {
+    return glCaps.textureCompressionS3TC || format == BlockFormat::BC4 || format == BlockFormat::BC5;
+}
+
+// Loads path as a block compressed image with a full mip chain. The result is read from the cache file
+// next to the source when it is up to date, otherwise the source is decoded, encoded and the cache
+// written. Safe to call from any thread; returns false when the image can't be loaded or the context
+// can't sample the chosen format, the caller then falls back to an uncompressed upload.
+inline bool loadCompressedImage(const std::string& path, CompressedImage& image) {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = bc::sourceKey(path);
+    if (key.empty())
+        return false;
+
+    bool cacheHit = bc::readCache(bc::cachePath(path), key, image);
+    if (!cacheHit) {
+        int width, height, components;
+        unsigned char* pixels = loadImage(path, &width, &height, &components, 4);
+        if (!pixels)
+            return false;
+
+        image.width = width;
+        image.height = height;
+        if (components == 1) {
+            image.format = BlockFormat::BC4;
+        } else if (components == 2) {
+            // gray + alpha, kept in the red and green channels like a GL_RG upload would
+            for (size_t i = 0; i < (size_t)width * height; ++i)
+                pixels[i * 4 + 1] = pixels[i * 4 + 3];
+            image.format = BlockFormat::BC5;
+        } else {
+            bool opaque = true;
+            for (size_t i = 0; i < (size_t)width * height && opaque; ++i)
+                opaque = pixels[i * 4 + 3] == 255;
+            image.format = opaque ? BlockFormat::BC1 : BlockFormat::BC3;
+        }
+
+        image.levels.clear();
+        image.levels.push_back(bc::encodeLevel(pixels, width, height, image.format));
+        std::vector<unsigned char> mip;
+        const unsigned char* source = pixels;
+        while (width > 1 || height > 1) {
+            mip = bc::downsample(source, width, height, width, height);
+            source = mip.data();
+            image.levels.push_back(bc::encodeLevel(source, width, height, image.format));
+        }
+        stbi_image_free(pixels);
+
+        if (!bc::writeCache(bc::cachePath(path), key, image))
+            std::cout << "ERROR::TEXTURE:: could not write compressed cache for " << path << std::endl;
+    }
+
+    // the source component count only matters for the report, so it is read from the header
+    int width, height;
+    if (!imageInfo(path, &width, &height, &image.sourceComponents))
+        image.sourceComponents = 4;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    static const char* const formatNames[] = {"BC1", "BC3", "BC4", "BC5"};
+    {
+        std::lock_guard<std::mutex> lock(bc::statsMutex());
+        std::cout << "Texture " << path << ": " << formatNames[(int)image.format] << " " << image.width << "x"
+                  << image.height << ", " << image.levels.size() << " levels, " << image.sizeInBytes() / 1024 << " KB ("
+                  << image.uncompressedSizeInBytes() / 1024 << " KB uncompressed), " << (cacheHit ? "cache read" : "encoded")
+                  << " in " << ms << " ms" << std::endl;
+        TextureCompressionStats& stats = bc::mutableStats();
+        stats.textures++;
+        stats.compressedBytes += image.sizeInBytes();
+        stats.uncompressedBytes += image.uncompressedSizeInBytes();
+        if (cacheHit) {
+            stats.cacheHits++;
+            stats.cacheReadMs += ms;
+        } else {
+            stats.encodeMs += ms;
+        }
+    }
+    return canUploadCompressed(image.format);
+}
+
+// uploads the given mip levels into the texture bound to target (GL_TEXTURE_2D or a cube map face)
+inline void uploadCompressedLevels(const CompressedImage& image, GLenum target, size_t firstLevel, size_t levelCount) {
+    auto start = std::chrono::steady_clock::now();
+    GLenum internalFormat = bc::glInternalFormat(image.format);
+    for (size_t i = firstLevel; i < std::min(firstLevel + levelCount, image.levels.size()); ++i) {
+        const CompressedLevel& level = image.levels[i];
+        glCompressedTexImage2D(target, (GLint)i, internalFormat, level.width, level.height, 0,
+                               (GLsizei)level.data.size(), level.data.data());
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(bc::statsMutex());
+    bc::mutableStats().uploadMs += ms;
+}
+
+// uploads the whole chain into the texture bound to GL_TEXTURE_2D, sampler state is left to the caller
+inline void uploadCompressedImage(const CompressedImage& image) {
+    uploadCompressedLevels(image, GL_TEXTURE_2D, 0, image.levels.size());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+}
+
+};
+
+#endif //PROJECT_BASE_TEXTURECOMPRESSION_H
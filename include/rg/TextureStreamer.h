@@ -0,0 +1,273 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_TEXTURESTREAMER_H
+#define PROJECT_BASE_TEXTURESTREAMER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/Frustum.h>
+#include <rg/TextureCompression.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+struct TextureStreamerSettings {
+    bool enabled = true;
+    // VRAM all streamed textures may use together
+    float budgetMB = 64.0f;
+    // upload per frame, at least one level is always uploaded
+    float uploadMBPerFrame = 2.0f;
+    // levels whose larger side is at most this are uploaded right away and never evicted
+    int residentFloorSize = 64;
+    // added to the computed level, positive values keep textures blurrier and memory lower
+    float levelBias = 0.0f;
+};
+
+struct TextureStreamerStats {
+    unsigned int textures = 0;
+    size_t residentBytes = 0;
+    // what the same textures would take with every level resident
+    size_t fullBytes = 0;
+    unsigned int uploadsLastFrame = 0;
+    unsigned int evictionsLastFrame = 0;
+    size_t uploads = 0;
+    size_t evictions = 0;
+    // textures that want a finer level than the budget allows
+    unsigned int starved = 0;
+};
+
+// Streams the mip chain of block compressed textures. Every texture keeps its levels in system memory
+// and only the coarse ones are uploaded at first; each frame the drawn meshes report how large their
+// textures appear on screen (from the mesh bounds, its UV density and the camera) and the streamer moves
+// each texture's GL_TEXTURE_BASE_LEVEL one level at a time towards that, largest deficit first. When the
+// budget is exceeded the top level of the least recently used texture is dropped (its storage
+// respecified to zero size, so the driver can release it).
+class TextureStreamer {
+public:
+    struct Entry {
+        GLuint id;
+        rg::CompressedImage image;
+        // finest level in VRAM, and the coarsest level that is always resident
+        int residentLevel;
+        int floorLevel;
+        // finest level asked for this frame, the floor when unused
+        float wantedLevel;
+        unsigned int lastUsed;
+    };
+
+    TextureStreamerSettings settings;
+
+    // takes over a compressed image for the texture object id, uploads its coarse levels and sets the
+    // base level; sampler state is left to the caller. Returns the bytes uploaded
+    size_t add(GLuint id, rg::CompressedImage image) {
+        Entry entry{id, std::move(image), 0, 0, 0.0f, frame};
+        entry.floorLevel = (int)entry.image.levels.size() - 1;
+        while (entry.floorLevel > 0 && std::max(entry.image.levels[entry.floorLevel - 1].width,
+                                                entry.image.levels[entry.floorLevel - 1].height) <= settings.residentFloorSize)
+            entry.floorLevel--;
+        entry.residentLevel = entry.floorLevel;
+        entry.wantedLevel = (float)entry.floorLevel;
+
+        glBindTexture(GL_TEXTURE_2D, id);
+        rg::uploadCompressedLevels(entry.image, GL_TEXTURE_2D, entry.floorLevel, entry.image.levels.size());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.floorLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)entry.image.levels.size() - 1);
+
+        size_t uploaded = levelBytes(entry, entry.floorLevel);
+        index[id] = entries.size();
+        entries.push_back(std::move(entry));
+        return uploaded;
+    }
+
+    bool contains(GLuint id) const { return index.count(id) != 0; }
+
+    // call before reporting usage; viewportHeight is in pixels
+    void beginFrame(const glm::mat4& projection, const glm::mat4& view, int viewportHeight) {
+        frame++;
+        viewProjection = projection * view;
+        cameraPosition = glm::vec3(glm::inverse(view)[3]);
+        // projection[1][1] is 1 / tan(fovY / 2): pixels per world unit at distance 1
+        pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+        for (Entry& entry : entries)
+            entry.wantedLevel = (float)entry.floorLevel;
+    }
+
+    // a mesh drawn with the given transform, with bounds in object space
+    void noteMeshUsage(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float uvDensity,
+                       const glm::mat4& transform, const GLuint* textures, size_t textureCount) {
+        if (!Frustum(viewProjection * transform).intersects(boundsMin, boundsMax))
+            return;
+
+        // world space box of the transformed corners, and the distance from the camera to it
+        glm::vec3 worldMin(1e30f), worldMax(-1e30f);
+        for (int i = 0; i < 8; ++i) {
+            glm::vec3 corner(i & 1 ? boundsMax.x : boundsMin.x, i & 2 ? boundsMax.y : boundsMin.y, i & 4 ? boundsMax.z : boundsMin.z);
+            glm::vec3 world = glm::vec3(transform * glm::vec4(corner, 1.0f));
+            worldMin = glm::min(worldMin, world);
+            worldMax = glm::max(worldMax, world);
+        }
+        glm::vec3 closest = glm::clamp(cameraPosition, worldMin, worldMax);
+        float distance = std::max(glm::length(closest - cameraPosition), 0.01f);
+
+        // uniform scale of the transform, object space units per world unit inverted
+        float scale = std::cbrt(std::fabs(glm::determinant(glm::mat3(transform))));
+        float uvPerPixel = uvDensity / std::max(scale, 1e-6f) * distance / pixelsPerUnit;
+
+        for (size_t i = 0; i < textureCount; ++i) {
+            auto it = index.find(textures[i]);
+            if (it == index.end())
+                continue;
+            Entry& entry = entries[it->second];
+            float texelsPerPixel = uvPerPixel * std::max(entry.image.width, entry.image.height);
+            float level = std::log2(std::max(texelsPerPixel, 1.0f)) + settings.levelBias;
+            entry.wantedLevel = std::min(entry.wantedLevel, std::max(level, 0.0f));
+            entry.lastUsed = frame;
+        }
+    }
+
+    // uploads and evicts towards the wanted levels within the budget, once per frame after all usage was noted
+    void update() {
+        frameStats.uploadsLastFrame = 0;
+        frameStats.evictionsLastFrame = 0;
+        frameStats.starved = 0;
+        if (!settings.enabled)
+            return;
+
+        size_t budget = (size_t)(settings.budgetMB * 1024.0f * 1024.0f);
+        size_t uploadBudget = (size_t)(settings.uploadMBPerFrame * 1024.0f * 1024.0f);
+
+        // the texture furthest from its wanted level gets the next upload
+        std::vector<Entry*> upgrades;
+        for (Entry& entry : entries) {
+            if (entry.residentLevel > (int)std::floor(entry.wantedLevel))
+                upgrades.push_back(&entry);
+        }
+        std::sort(upgrades.begin(), upgrades.end(), [](const Entry* a, const Entry* b) {
+            return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+        });
+
+        size_t uploaded = 0;
+        for (Entry* entry : upgrades) {
+            while (entry->residentLevel > (int)std::floor(entry->wantedLevel) && (uploaded == 0 || uploaded < uploadBudget)) {
+                size_t cost = entry->image.levels[entry->residentLevel - 1].data.size();
+                if (!makeRoom(cost, budget, entry)) {
+                    frameStats.starved++;
+                    break;
+                }
+                uploadLevel(*entry, entry->residentLevel - 1);
+                uploaded += cost;
+            }
+        }
+    }
+
+    const TextureStreamerStats& stats() {
+        frameStats.textures = (unsigned int)entries.size();
+        frameStats.residentBytes = residentBytes();
+        frameStats.fullBytes = 0;
+        for (const Entry& entry : entries)
+            frameStats.fullBytes += entry.image.sizeInBytes();
+        return frameStats;
+    }
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+private:
+    std::vector<Entry> entries;
+    std::unordered_map<GLuint, size_t> index;
+    unsigned int frame = 0;
+    TextureStreamerStats frameStats;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f;
+
+    static size_t levelBytes(const Entry& entry, int first) {
+        size_t bytes = 0;
+        for (size_t level = first; level < entry.image.levels.size(); ++level)
+            bytes += entry.image.levels[level].data.size();
+        return bytes;
+    }
+
+    size_t residentBytes() const {
+        size_t bytes = 0;
+        for (const Entry& entry : entries)
+            bytes += levelBytes(entry, entry.residentLevel);
+        return bytes;
+    }
+
+    // a texture drawn this frame that isn't finer than it wants
+    bool needsLevel(const Entry& entry) const {
+        return entry.lastUsed == frame && entry.residentLevel >= (int)std::floor(entry.wantedLevel);
+    }
+
+    // eviction order: unneeded before needed, then least recently used, then the finest resident level
+    bool evictBefore(const Entry& a, const Entry& b) const {
+        bool needsA = needsLevel(a), needsB = needsLevel(b);
+        if (needsA != needsB)
+            return !needsA;
+        if (a.lastUsed != b.lastUsed)
+            return a.lastUsed < b.lastUsed;
+        return a.residentLevel < b.residentLevel;
+    }
+
+    // evicts top levels until cost fits: levels nobody needs first, least recently used first among
+    // them; a texture still needing its level only gives it up to one that is coarser than it
+    bool makeRoom(size_t cost, size_t budget, const Entry* forEntry) {
+        size_t used = residentBytes();
+        int targetLevel = forEntry->residentLevel - 1;
+        while (used + cost > budget) {
+            Entry* victim = nullptr;
+            for (Entry& entry : entries) {
+                if (&entry == forEntry || entry.residentLevel >= entry.floorLevel)
+                    continue;
+                if (needsLevel(entry) && entry.residentLevel >= targetLevel)
+                    continue;
+                if (!victim || evictBefore(entry, *victim))
+                    victim = &entry;
+            }
+            if (!victim)
+                return false;
+            used -= victim->image.levels[victim->residentLevel].data.size();
+            evictTopLevel(*victim);
+        }
+        return true;
+    }
+
+    void uploadLevel(Entry& entry, int level) {
+        glBindTexture(GL_TEXTURE_2D, entry.id);
+        rg::uploadCompressedLevels(entry.image, GL_TEXTURE_2D, level, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        entry.residentLevel = level;
+        frameStats.uploads++;
+        frameStats.uploadsLastFrame++;
+    }
+
+    void evictTopLevel(Entry& entry) {
+        glBindTexture(GL_TEXTURE_2D, entry.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.residentLevel + 1);
+        // a zero sized image outside [base, max] keeps the texture complete and releases the level
+        glCompressedTexImage2D(GL_TEXTURE_2D, entry.residentLevel, rg::bc::glInternalFormat(entry.image.format), 0, 0, 0, 0, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        entry.residentLevel++;
+        frameStats.evictions++;
+        frameStats.evictionsLastFrame++;
+    }
+};
+
+namespace rg {
+
+// set by the application to stream textures loaded through TextureFromFile and the model loader
+inline TextureStreamer*& textureStreamer() {
+    static TextureStreamer* streamer = nullptr;
+    return streamer;
+}
+
+};
+
+#endif //PROJECT_BASE_TEXTURESTREAMER_H
@@ -0,0 +1,293 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_TIMEOFDAY_H
+#define PROJECT_BASE_TIMEOFDAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/DayProp.h>
+#include <rg/MappedFile.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// everything that follows the time of day, for one point of it
+struct TimeOfDaySample {
+    glm::vec3 sunPosition = glm::vec3(0.0f);
+    glm::vec3 sunColor = glm::vec3(0.0f);
+    glm::vec3 sunSpecular = glm::vec3(0.0f);
+    float sunPower = 0.0f;
+    glm::vec3 moonPosition = glm::vec3(0.0f);
+    glm::vec3 moonColor = glm::vec3(0.0f);
+    glm::vec3 moonSpecular = glm::vec3(0.0f);
+    float moonPower = 0.0f;
+    glm::vec3 skyColor = glm::vec3(0.0f);
+    // ambient of the directional light on the church
+    glm::vec3 ambient = glm::vec3(0.0f);
+};
+
+enum TimeOfDayCurve { SunColorCurve, SunSpecularCurve, SunPowerCurve, MoonColorCurve, MoonSpecularCurve,
+                      MoonPowerCurve, SkyColorCurve, AmbientCurve, TimeOfDayCurveCount };
+
+// Keyframed curves for the day/night look, baked into a table the CPU reads and a LUT texture the shaders
+// read, both indexed by the normalized time of day t: the sun's angle over 360 degrees, 0 at sunrise,
+// 0.25 noon, 0.5 sunset, 0.75 midnight. A frame costs one interpolated lookup instead of evaluating the
+// curves. The keys come from a text file (see resources/time_of_day.txt) so the look is tuned without
+// code changes; without the file they are sampled from DayProp's formulas.
+//
+// The LUT is LUT_SIZE x LUT_ROWS RGBA16F, repeating along t; sample a row at
+// (t + 0.5 / LUT_SIZE, (row + 0.5) / LUT_ROWS).
+class TimeOfDay {
+public:
+    static const int LUT_SIZE = 256;
+    enum LutRow { SunRow, MoonRow, SkyRow, AmbientRow, LUT_ROWS };
+
+    TimeOfDay() = default;
+
+    ~TimeOfDay() {
+        if (lut)
+            glDeleteTextures(1, &lut);
+    }
+
+    TimeOfDay(const TimeOfDay&) = delete;
+    TimeOfDay& operator=(const TimeOfDay&) = delete;
+
+    static float normalize(float sunDegrees) {
+        float t = sunDegrees / 360.0f;
+        return t - std::floor(t);
+    }
+
+    // reads the keys and bakes the table and the LUT, main thread; returns false if the defaults were used
+    bool load(const std::string& path) {
+        std::vector<Key> keys[TimeOfDayCurveCount];
+        bool fromFile = parse(path, keys);
+        if (!fromFile)
+            defaultKeys(keys);
+        keyCount = 0;
+        for (const std::vector<Key>& curve : keys)
+            keyCount += curve.size();
+        loadedFromFile = fromFile;
+
+        std::shared_ptr<Table> baked = std::make_shared<Table>(LUT_SIZE);
+        for (int i = 0; i < LUT_SIZE; ++i)
+            (*baked)[i] = evaluate(keys, (float)i / LUT_SIZE);
+        std::atomic_store(&table, std::shared_ptr<const Table>(baked));
+        upload(*baked);
+        return fromFile;
+    }
+
+    // interpolated between the two nearest table entries; safe to call from the simulation thread
+    TimeOfDaySample sample(float t) const {
+        std::shared_ptr<const Table> current = std::atomic_load(&table);
+        if (!current)
+            return TimeOfDaySample();
+        float x = (t - std::floor(t)) * LUT_SIZE;
+        int i0 = std::min((int)x, LUT_SIZE - 1);
+        int i1 = (i0 + 1) % LUT_SIZE;
+        float f = x - (float)i0;
+        const TimeOfDaySample& a = (*current)[i0];
+        const TimeOfDaySample& b = (*current)[i1];
+        TimeOfDaySample s;
+        s.sunPosition = glm::mix(a.sunPosition, b.sunPosition, f);
+        s.sunColor = glm::mix(a.sunColor, b.sunColor, f);
+        s.sunSpecular = glm::mix(a.sunSpecular, b.sunSpecular, f);
+        s.sunPower = glm::mix(a.sunPower, b.sunPower, f);
+        s.moonPosition = glm::mix(a.moonPosition, b.moonPosition, f);
+        s.moonColor = glm::mix(a.moonColor, b.moonColor, f);
+        s.moonSpecular = glm::mix(a.moonSpecular, b.moonSpecular, f);
+        s.moonPower = glm::mix(a.moonPower, b.moonPower, f);
+        s.skyColor = glm::mix(a.skyColor, b.skyColor, f);
+        s.ambient = glm::mix(a.ambient, b.ambient, f);
+        return s;
+    }
+
+    // fills the props the way DayProp::calc_day_properties and calc_night_properties do, returns the sample used
+    TimeOfDaySample apply(float sunDegrees, DayProp& sun, DayProp& moon) const {
+        TimeOfDaySample s = sample(normalize(sunDegrees));
+        sun.angle = sunDegrees;
+        sun.radians = glm::radians(sunDegrees);
+        sun.light_power = s.sunPower;
+        sun.active = s.sunPower > 0.0f;
+        sun.position = s.sunPosition;
+        sun.color = s.sunColor;
+        sun.specular = s.sunSpecular;
+        sun.sky_color = s.skyColor;
+        moon.angle = sunDegrees + 180.0f;
+        moon.radians = glm::radians(moon.angle);
+        moon.light_power = s.moonPower;
+        moon.active = s.moonPower > 0.0f;
+        moon.position = s.moonPosition;
+        moon.color = s.moonColor;
+        moon.specular = s.moonSpecular;
+        moon.sky_color = glm::vec3(0.0f);
+        return s;
+    }
+
+    // binds the LUT to the given unit and points the shader's timeOfDayLut/timeOfDay uniforms at it
+    void bind(Shader& shader, int unit, float t) const {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, lut);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("timeOfDayLut", unit);
+        shader.setFloat("timeOfDay", t);
+    }
+
+    GLuint texture() const { return lut; }
+    bool fromFile() const { return loadedFromFile; }
+    size_t keys() const { return keyCount; }
+
+    // for plotting, t of entry i is i / LUT_SIZE
+    float sunPowerAt(int i) const { return entry(i).sunPower; }
+    float moonPowerAt(int i) const { return entry(i).moonPower; }
+
+private:
+    struct Key {
+        float t;
+        glm::vec3 value;
+    };
+    typedef std::vector<TimeOfDaySample> Table;
+
+    std::shared_ptr<const Table> table;
+    GLuint lut = 0;
+    bool loadedFromFile = false;
+    size_t keyCount = 0;
+
+    TimeOfDaySample entry(int i) const {
+        std::shared_ptr<const Table> current = std::atomic_load(&table);
+        return current ? (*current)[i] : TimeOfDaySample();
+    }
+
+    static const char* curveName(int curve) {
+        static const char* names[TimeOfDayCurveCount] = {"sun_color", "sun_specular", "sun_power", "moon_color",
+                                                         "moon_specular", "moon_power", "sky_color", "ambient"};
+        return names[curve];
+    }
+
+    // lines of "<curve> <t> <value>" with one value for powers and three for colors, '#' starts a comment
+    static bool parse(const std::string& path, std::vector<Key> (&keys)[TimeOfDayCurveCount]) {
+        std::shared_ptr<rg::MappedFile> file = rg::mapAsset(path);
+        if (!file->valid() || file->size() == 0)
+            return false;
+        std::istringstream in(std::string((const char*)file->data(), file->size()));
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string name;
+            if (!(fields >> name))
+                continue;
+            int curve = 0;
+            while (curve < TimeOfDayCurveCount && name != curveName(curve))
+                curve++;
+            Key key;
+            if (curve == TimeOfDayCurveCount || !(fields >> key.t >> key.value.x)) {
+                std::cout << "TIME_OF_DAY::" << path << ":" << lineNumber << ": bad key" << std::endl;
+                continue;
+            }
+            if (!(fields >> key.value.y >> key.value.z))
+                key.value.y = key.value.z = key.value.x;
+            key.t = glm::clamp(key.t, 0.0f, 1.0f);
+            keys[curve].push_back(key);
+        }
+        for (int curve = 0; curve < TimeOfDayCurveCount; ++curve) {
+            if (keys[curve].empty()) {
+                std::cout << "TIME_OF_DAY::" << path << ": no keys for " << curveName(curve) << std::endl;
+                return false;
+            }
+            // stable, keys sharing a t make a step
+            std::stable_sort(keys[curve].begin(), keys[curve].end(),
+                             [](const Key& a, const Key& b) { return a.t < b.t; });
+        }
+        return true;
+    }
+
+    // the look from before the curves existed
+    static void defaultKeys(std::vector<Key> (&keys)[TimeOfDayCurveCount]) {
+        const int steps = 48;
+        for (int i = 0; i <= steps; ++i) {
+            float t = (float)i / steps;
+            DayProp sun, moon;
+            sun.calc_day_properties(t * 360.0f);
+            moon.calc_night_properties(t * 360.0f + 180.0f);
+            keys[SunColorCurve].push_back({t, sun.color});
+            keys[SunSpecularCurve].push_back({t, sun.specular});
+            keys[SunPowerCurve].push_back({t, glm::vec3(sun.light_power)});
+            keys[MoonColorCurve].push_back({t, moon.color});
+            keys[MoonSpecularCurve].push_back({t, moon.specular});
+            keys[MoonPowerCurve].push_back({t, glm::vec3(moon.light_power)});
+            keys[SkyColorCurve].push_back({t, sun.sky_color});
+        }
+        glm::vec3 day(0.5f), night(0.1f, 0.1f, 0.15f);
+        keys[AmbientCurve] = {{0.0f, day}, {0.5f, day}, {0.5f, night}, {1.0f, night}};
+    }
+
+    // linear between the keys around t, wrapping from the last key back to the first
+    static glm::vec3 evaluate(const std::vector<Key>& keys, float t) {
+        auto next = std::upper_bound(keys.begin(), keys.end(), t, [](float x, const Key& k) { return x < k.t; });
+        const Key& b = next == keys.end() ? keys.front() : *next;
+        const Key& a = next == keys.begin() ? keys.back() : *(next - 1);
+        float span = b.t - a.t;
+        float offset = t - a.t;
+        if (span <= 0.0f) {
+            span += 1.0f;
+            if (offset < 0.0f)
+                offset += 1.0f;
+        }
+        return span <= 0.0f ? a.value : glm::mix(a.value, b.value, glm::clamp(offset / span, 0.0f, 1.0f));
+    }
+
+    static TimeOfDaySample evaluate(const std::vector<Key> (&keys)[TimeOfDayCurveCount], float t) {
+        TimeOfDaySample s;
+        s.sunColor = evaluate(keys[SunColorCurve], t);
+        s.sunSpecular = evaluate(keys[SunSpecularCurve], t);
+        s.sunPower = std::max(evaluate(keys[SunPowerCurve], t).x, 0.0f);
+        s.moonColor = evaluate(keys[MoonColorCurve], t);
+        s.moonSpecular = evaluate(keys[MoonSpecularCurve], t);
+        s.moonPower = std::max(evaluate(keys[MoonPowerCurve], t).x, 0.0f);
+        s.skyColor = evaluate(keys[SkyColorCurve], t);
+        s.ambient = evaluate(keys[AmbientCurve], t);
+        // the orbits are geometry, not part of the look
+        DayProp sun, moon;
+        sun.calc_day_properties(t * 360.0f);
+        moon.calc_night_properties(t * 360.0f + 180.0f);
+        s.sunPosition = sun.position;
+        s.moonPosition = moon.position;
+        return s;
+    }
+
+    void upload(const Table& baked) {
+        std::vector<float> texels(LUT_SIZE * LUT_ROWS * 4);
+        for (int i = 0; i < LUT_SIZE; ++i) {
+            const TimeOfDaySample& s = baked[i];
+            glm::vec4 rows[LUT_ROWS] = {glm::vec4(s.sunColor, s.sunPower), glm::vec4(s.moonColor, s.moonPower),
+                                        glm::vec4(s.skyColor, 0.0f), glm::vec4(s.ambient, 0.0f)};
+            for (int row = 0; row < LUT_ROWS; ++row)
+                std::memcpy(&texels[(row * LUT_SIZE + i) * 4], &rows[row][0], sizeof(glm::vec4));
+        }
+        if (!lut) {
+            glGenTextures(1, &lut);
+            glBindTexture(GL_TEXTURE_2D, lut);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, lut);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, LUT_SIZE, LUT_ROWS, 0, GL_RGBA, GL_FLOAT, texels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+
+#endif //PROJECT_BASE_TIMEOFDAY_H
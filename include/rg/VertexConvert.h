@@ -0,0 +1,149 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_VERTEXCONVERT_H
+#define PROJECT_BASE_VERTEXCONVERT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RG_VERTEX_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace rg {
+
+// Builds interleaved vertices (position 3, normal 3, uv 2, tangent 3, bitangent 3 floats, the layout
+// of Vertex in learnopengl/mesh.h) from separate arrays of packed float triples, Assimp's aiVector3D.
+// A missing array reads as zeros; the uv takes the first two floats of its triple.
+const size_t VERTEX_FLOATS = 14;
+
+struct VertexStreams {
+    const float* position = nullptr;
+    const float* normal = nullptr;
+    const float* texCoord = nullptr;
+    const float* tangent = nullptr;
+    const float* bitangent = nullptr;
+    // vertices in every array, the kernels don't read past it
+    size_t count = 0;
+};
+
+// converts vertices [begin, end) into out + begin * VERTEX_FLOATS
+typedef void (*VertexKernel)(const VertexStreams& streams, float* out, size_t begin, size_t end);
+
+struct VertexKernelInfo {
+    const char* name;
+    VertexKernel kernel;
+};
+
+namespace vertexconvert {
+
+// a missing array is read through this one with a stride of 0, so the loops carry no branches; four
+// floats so the vector loads can't read past it
+alignas(16) const float ZEROS[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+// Ranges up to this many vertices (about 1.8 MB read and written) go to the SIMD kernel. While the
+// range stays in L2 the shuffles win by 1.1-2x; past it both kernels wait on memory and the scalar
+// loop measured the same or up to 20% faster.
+const size_t SIMD_MAX_VERTICES = 16384;
+
+struct Cursor {
+    const float* data;
+    size_t stride;
+
+    Cursor(const float* array, size_t begin) : data(array ? array + begin * 3 : ZEROS), stride(array ? 3 : 0) {}
+};
+
+inline void convertScalar(const VertexStreams& streams, float* out, size_t begin, size_t end) {
+    Cursor position(streams.position, begin), normal(streams.normal, begin), texCoord(streams.texCoord, begin),
+            tangent(streams.tangent, begin), bitangent(streams.bitangent, begin);
+    for (size_t i = begin; i < end; ++i) {
+        float* vertex = out + i * VERTEX_FLOATS;
+        vertex[0] = position.data[0]; vertex[1] = position.data[1]; vertex[2] = position.data[2];
+        vertex[3] = normal.data[0]; vertex[4] = normal.data[1]; vertex[5] = normal.data[2];
+        vertex[6] = texCoord.data[0]; vertex[7] = texCoord.data[1];
+        vertex[8] = tangent.data[0]; vertex[9] = tangent.data[1]; vertex[10] = tangent.data[2];
+        vertex[11] = bitangent.data[0]; vertex[12] = bitangent.data[1]; vertex[13] = bitangent.data[2];
+        position.data += position.stride;
+        normal.data += normal.stride;
+        texCoord.data += texCoord.stride;
+        tangent.data += tangent.stride;
+        bitangent.data += bitangent.stride;
+    }
+}
+
+#ifdef RG_VERTEX_CONVERT_SSE2
+
+// Loads each triple as four floats, the fourth being the next vertex's first, so the last vertex of the
+// arrays is always left to the scalar loop. Every vertex is assembled in registers and stored as
+// 4 + 4 + 4 + 2 floats that stay inside it, so parallel ranges never touch each other's output:
+//   (px py pz nx) (ny nz u v) (tx ty tz bx) (by bz)
+// Six shuffles and four stores per vertex. There is no AVX2 kernel: a 256 bit version converting two
+// vertices per step needs extra lane inserts and permutes for the same stores and measured slower, the
+// loop is bound by stores rather than width. SSE2 is part of x86-64, so no runtime check is needed.
+inline void convertSSE2(const VertexStreams& streams, float* out, size_t begin, size_t end) {
+    size_t vectorEnd = streams.count > 0 ? std::min(end, streams.count - 1) : 0;
+    Cursor position(streams.position, begin), normal(streams.normal, begin), texCoord(streams.texCoord, begin),
+            tangent(streams.tangent, begin), bitangent(streams.bitangent, begin);
+    size_t i = begin;
+    for (; i < vectorEnd; ++i) {
+        __m128 p = _mm_loadu_ps(position.data);
+        __m128 n = _mm_loadu_ps(normal.data);
+        __m128 t = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)texCoord.data);
+        __m128 tg = _mm_loadu_ps(tangent.data);
+        __m128 b = _mm_loadu_ps(bitangent.data);
+
+        // (pz pz nx nx) then (px py pz nx)
+        __m128 pn = _mm_shuffle_ps(p, n, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 v0 = _mm_shuffle_ps(p, pn, _MM_SHUFFLE(2, 0, 1, 0));
+        __m128 v1 = _mm_shuffle_ps(n, t, _MM_SHUFFLE(1, 0, 2, 1));
+        __m128 tb = _mm_shuffle_ps(tg, b, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 v2 = _mm_shuffle_ps(tg, tb, _MM_SHUFFLE(2, 0, 1, 0));
+        __m128 v3 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 2, 1));
+
+        float* vertex = out + i * VERTEX_FLOATS;
+        _mm_storeu_ps(vertex, v0);
+        _mm_storeu_ps(vertex + 4, v1);
+        _mm_storeu_ps(vertex + 8, v2);
+        _mm_storel_pi((__m64*)(vertex + 12), v3);
+
+        position.data += position.stride;
+        normal.data += normal.stride;
+        texCoord.data += texCoord.stride;
+        tangent.data += tangent.stride;
+        bitangent.data += bitangent.stride;
+    }
+    convertScalar(streams, out, i, end);
+}
+
+#endif
+
+}
+
+// every kernel built for this target, the SIMD one first
+inline const std::vector<VertexKernelInfo>& vertexKernels() {
+    static const std::vector<VertexKernelInfo> kernels = {
+#ifdef RG_VERTEX_CONVERT_SSE2
+            {"sse2", vertexconvert::convertSSE2},
+#endif
+            {"scalar", vertexconvert::convertScalar}};
+    return kernels;
+}
+
+// picks the kernel by how much of the range fits in cache, see SIMD_MAX_VERTICES
+inline void convertVertices(const VertexStreams& streams, float* out, size_t begin, size_t end) {
+#ifdef RG_VERTEX_CONVERT_SSE2
+    if (end - begin <= vertexconvert::SIMD_MAX_VERTICES) {
+        vertexconvert::convertSSE2(streams, out, begin, end);
+        return;
+    }
+#endif
+    vertexconvert::convertScalar(streams, out, begin, end);
+}
+
+};
+
+#endif //PROJECT_BASE_VERTEXCONVERT_H
@@ -0,0 +1,97 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_VIEWPORT_H
+#define PROJECT_BASE_VIEWPORT_H
+
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <vector>
+
+// Tracks the window's framebuffer size (in pixels, so HiDPI scaling is already applied) and its
+// content scale. The current size is available immediately for viewports and the projection aspect,
+// while render targets that depend on it are reallocated only once the size has stopped changing
+// for settleSeconds, so a drag-resize doesn't reallocate them every frame.
+class ViewportManager {
+public:
+    typedef std::function<void(int width, int height)> ResizeListener;
+
+    double settleSeconds;
+
+    explicit ViewportManager(GLFWwindow* window, double settleSeconds = 0.2)
+            : settleSeconds(settleSeconds) {
+        glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
+        settledWidth = currentWidth;
+        settledHeight = currentHeight;
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 3)
+        glfwGetWindowContentScale(window, &scaleX, &scaleY);
+#endif
+    }
+
+    // called from the framebuffer size callback
+    void onFramebufferResize(int width, int height, double now) {
+        currentWidth = width;
+        currentHeight = height;
+        lastChange = now;
+        resizeEvents++;
+    }
+
+    // called from the content scale callback, e.g. when the window moves to another monitor
+    void onContentScale(float x, float y) {
+        scaleX = x;
+        scaleY = y;
+    }
+
+    // call once per frame, notifies the listeners when the size has settled on a new value
+    void update(double now) {
+        if (minimized())
+            return;
+        if (currentWidth == settledWidth && currentHeight == settledHeight)
+            return;
+        if (now - lastChange < settleSeconds)
+            return;
+        settledWidth = currentWidth;
+        settledHeight = currentHeight;
+        reallocations++;
+        for (ResizeListener& listener : listeners)
+            listener(settledWidth, settledHeight);
+    }
+
+    void addResizeListener(ResizeListener listener) {
+        listeners.push_back(listener);
+    }
+
+    int width() const { return currentWidth; }
+    int height() const { return currentHeight; }
+    int settledWidthPx() const { return settledWidth; }
+    int settledHeightPx() const { return settledHeight; }
+
+    // falls back to a square aspect while the window is minimized and has a zero sized framebuffer
+    float aspect() const {
+        return minimized() ? 1.0f : (float)currentWidth / (float)currentHeight;
+    }
+
+    bool minimized() const { return currentWidth <= 0 || currentHeight <= 0; }
+
+    float contentScale() const { return scaleX > scaleY ? scaleX : scaleY; }
+
+    unsigned int resizeEventCount() const { return resizeEvents; }
+    unsigned int reallocationCount() const { return reallocations; }
+
+private:
+    int currentWidth = 0;
+    int currentHeight = 0;
+    int settledWidth = 0;
+    int settledHeight = 0;
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    double lastChange = 0.0;
+    unsigned int resizeEvents = 0;
+    unsigned int reallocations = 0;
+
+    std::vector<ResizeListener> listeners;
+};
+
+#endif //PROJECT_BASE_VIEWPORT_H
@@ -0,0 +1,683 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+#ifndef PROJECT_BASE_VIRTUALTEXTURE_H
+#define PROJECT_BASE_VIRTUALTEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/AssetIO.h>
+#include <rg/GLExt.h>
+#include <rg/TextureCompression.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct VirtualTextureSettings {
+    bool enabled = true;
+    // the feedback pass renders at the viewport size divided by this
+    int feedbackDivisor = 8;
+    // pages copied into the physical cache per frame
+    int uploadsPerFrame = 16;
+    // added to the computed mip level, positive values trade detail for fewer resident pages
+    float mipBias = 0.0f;
+};
+
+struct VirtualTextureStats {
+    unsigned int residentPages = 0;
+    unsigned int cachePages = 0;
+    // pages the last feedback asked for, and how many of those were not resident
+    unsigned int requestedPages = 0;
+    unsigned int pageFaults = 0;
+    unsigned int queuedPages = 0;
+    unsigned int uploadsLastFrame = 0;
+    size_t streamedPages = 0;
+    size_t evictions = 0;
+    size_t streamedBytes = 0;
+    double pageFileBuildMs = 0.0;
+};
+
+// Tiled virtual texture for one large image. The source is cut once into a page file next to it
+// (every mip level split into 128x128 pages with a 4 texel border, stored as BC1). A low resolution
+// feedback pass writes the page and mip each pixel needs; missing pages are read from the page file by
+// a background thread and copied on the render thread into a fixed size physical cache texture. An
+// indirection texture, one texel per page and level, maps virtual pages to cache slots, falling back
+// to the closest resident coarser page, so sampling never has to wait for the stream.
+class VirtualTexture {
+public:
+    static const int PAGE_SIZE = 128;
+    static const int PAGE_BORDER = 4;
+    static const int PADDED_PAGE_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+    static const int PAGE_BYTES = (PADDED_PAGE_SIZE / 4) * (PADDED_PAGE_SIZE / 4) * 8;
+
+    VirtualTextureSettings settings;
+
+    VirtualTexture(const std::string& source, int cachePagesPerSide = 16)
+            : source(source)
+            , pageFilePath(source + ".vtpages")
+            , cacheSide(cachePagesPerSide)
+            , feedbackShader("church_vertex.vs", "vt_feedback.fs") {
+        compressedCache = rg::glCaps.textureCompressionS3TC;
+        slots.resize(cacheSide * cacheSide);
+
+        glGenTextures(1, &cacheTexture);
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        int cacheTexels = cacheSide * PADDED_PAGE_SIZE;
+        if (compressedCache) {
+            std::vector<unsigned char> zero((size_t)(cacheTexels / 4) * (cacheTexels / 4) * 8, 0);
+            glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, cacheTexels, cacheTexels, 0,
+                                   (GLsizei)zero.size(), zero.data());
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheTexels, cacheTexels, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenTextures(1, &indirectionTexture);
+        glGenFramebuffers(1, &feedbackFBO);
+        glGenTextures(1, &feedbackColor);
+        glGenRenderbuffers(1, &feedbackDepth);
+        glGenBuffers(2, feedbackPBO);
+
+        streamThread = std::thread(&VirtualTexture::streamMain, this);
+    }
+
+    ~VirtualTexture() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        streamThread.join();
+
+        glDeleteTextures(1, &cacheTexture);
+        glDeleteTextures(1, &indirectionTexture);
+        glDeleteFramebuffers(1, &feedbackFBO);
+        glDeleteTextures(1, &feedbackColor);
+        glDeleteRenderbuffers(1, &feedbackDepth);
+        glDeleteBuffers(2, feedbackPBO);
+    }
+
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    static bool sourceAvailable(const std::string& path) {
+        int width, height, components;
+        return rg::imageInfo(path, &width, &height, &components);
+    }
+
+    // the page file is open and the coarsest page is resident, so every lookup resolves to something
+    bool ready() const {
+        return topLevel >= 0 && slotOf(pageKey(topLevel, 0, 0)) >= 0;
+    }
+
+    bool failed() const { return state.load(std::memory_order_acquire) == Failed; }
+
+    // shaders sample through the virtual texture, otherwise they fall back to the model's own albedo
+    bool active() const { return settings.enabled && ready(); }
+
+    // render thread, once per frame before drawing: reads back the previous feedback, queues missing
+    // pages for the stream thread and copies finished pages into the cache
+    void update() {
+        frame++;
+        stats.uploadsLastFrame = 0;
+        if (state.load(std::memory_order_acquire) != Streaming)
+            return;
+        if (topLevel < 0) {
+            // written by the stream thread before it published Streaming
+            stats.pageFileBuildMs = pageFileBuildMs;
+            createIndirection();
+        }
+
+        readFeedback();
+        uploadCompletedPages();
+        if (indirectionDirty)
+            rebuildIndirection();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.queuedPages = (unsigned int)requests.size();
+    }
+
+    // everything drawn with getFeedbackShader() until endFeedback() records the pages it needs
+    void beginFeedback(int viewportWidth, int viewportHeight, const glm::mat4& projection, const glm::mat4& view) {
+        int width = std::max(viewportWidth / std::max(settings.feedbackDivisor, 1), 1);
+        int height = std::max(viewportHeight / std::max(settings.feedbackDivisor, 1), 1);
+        if (width != feedbackWidth || height != feedbackHeight)
+            resizeFeedback(width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+        glViewport(0, 0, feedbackWidth, feedbackHeight);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        feedbackShader.use();
+        feedbackShader.setMat4("projection", projection);
+        feedbackShader.setMat4("view", view);
+        feedbackShader.setBool("useInstanceModel", false);
+        setLookupUniforms(feedbackShader);
+        // the feedback target is smaller, so its derivatives are feedbackDivisor times larger
+        feedbackShader.setFloat("vtMipBias", settings.mipBias - std::log2((float)std::max(settings.feedbackDivisor, 1)));
+    }
+
+    // starts an asynchronous read back of the feedback, picked up by the next update()
+    void endFeedback() {
+        feedbackWritePBO ^= 1;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[feedbackWritePBO]);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        feedbackPending = true;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    Shader& getFeedbackShader() { return feedbackShader; }
+
+    // binds the cache and indirection textures and sets the lookup uniforms on a shader that samples
+    // the virtual texture through SampleVirtual()
+    void apply(Shader& shader, int cacheUnit, int indirectionUnit) {
+        shader.setBool("virtualTexturing", active());
+        shader.setInt("vtCache", cacheUnit);
+        shader.setInt("vtIndirection", indirectionUnit);
+        setLookupUniforms(shader);
+        shader.setFloat("vtMipBias", settings.mipBias);
+        glActiveTexture(GL_TEXTURE0 + cacheUnit);
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    const VirtualTextureStats& getStats() const { return stats; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getLevels() const { return topLevel + 1; }
+
+private:
+    enum State { Building, Streaming, Failed };
+
+    struct StreamedPage {
+        uint32_t key;
+        std::vector<unsigned char> data;
+    };
+
+    struct Slot {
+        uint32_t key = 0;
+        bool used = false;
+        unsigned int lastUsed = 0;
+    };
+
+    std::string source;
+    std::string pageFilePath;
+    int cacheSide;
+    bool compressedCache;
+    Shader feedbackShader;
+
+    // virtual texture layout, written by the stream thread before it switches to Streaming
+    int width = 0;
+    int height = 0;
+    int topLevel = -1;
+    int levelCount = 0;
+    std::vector<int> levelPagesX, levelPagesY;
+    std::vector<size_t> levelFirstPage;
+    // indirection level 0 is indirectionSide^2 texels, a power of two so every level's page grid fits its mip
+    int indirectionSide = 1;
+
+    unsigned int cacheTexture, indirectionTexture;
+    unsigned int feedbackFBO, feedbackColor, feedbackDepth;
+    unsigned int feedbackPBO[2];
+    int feedbackWidth = 0;
+    int feedbackHeight = 0;
+    int feedbackWritePBO = 0;
+    bool feedbackPending = false;
+
+    // render thread residency state
+    std::vector<Slot> slots;
+    std::unordered_map<uint32_t, int> residentSlots;
+    // queued, being read, or read but not uploaded yet
+    std::unordered_set<uint32_t> pendingPages;
+    unsigned int frame = 0;
+    bool indirectionDirty = false;
+    std::vector<std::vector<unsigned char>> indirection;
+
+    // shared with the stream thread
+    std::thread streamThread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<State> state{Building};
+    // stream thread only until state is Streaming, update() copies it into stats then
+    double pageFileBuildMs = 0.0;
+    // sorted so the back, which is served first, holds the coarsest pages
+    std::vector<uint32_t> requests;
+    std::vector<StreamedPage> completed;
+
+    VirtualTextureStats stats;
+
+    static uint32_t pageKey(int level, int x, int y) {
+        return (uint32_t)level << 24 | (uint32_t)y << 12 | (uint32_t)x;
+    }
+    static int keyLevel(uint32_t key) { return key >> 24; }
+    static int keyY(uint32_t key) { return (key >> 12) & 0xfff; }
+    static int keyX(uint32_t key) { return key & 0xfff; }
+
+    int slotOf(uint32_t key) const {
+        auto it = residentSlots.find(key);
+        return it == residentSlots.end() ? -1 : it->second;
+    }
+
+    void setLookupUniforms(Shader& shader) {
+        shader.setVec2("vtSize", glm::vec2(width, height));
+        shader.setFloat("vtMaxLevel", (float)std::max(topLevel, 0));
+        shader.setFloat("vtPageSize", (float)PAGE_SIZE);
+        shader.setFloat("vtPageBorder", (float)PAGE_BORDER);
+        shader.setFloat("vtCacheSize", (float)(cacheSide * PADDED_PAGE_SIZE));
+    }
+
+    void computeLayout() {
+        levelPagesX.clear();
+        levelPagesY.clear();
+        levelFirstPage.clear();
+        size_t pages = 0;
+        for (int level = 0;; ++level) {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            levelPagesX.push_back((levelWidth + PAGE_SIZE - 1) / PAGE_SIZE);
+            levelPagesY.push_back((levelHeight + PAGE_SIZE - 1) / PAGE_SIZE);
+            levelFirstPage.push_back(pages);
+            pages += (size_t)levelPagesX.back() * levelPagesY.back();
+            if (levelPagesX.back() == 1 && levelPagesY.back() == 1)
+                break;
+        }
+        levelCount = (int)levelPagesX.size();
+        indirectionSide = 1;
+        while (indirectionSide < std::max(levelPagesX[0], levelPagesY[0]))
+            indirectionSide *= 2;
+    }
+
+    // -- stream thread --
+
+    struct PageFileHeader {
+        char magic[4];
+        uint32_t version;
+        int32_t width;
+        int32_t height;
+        int32_t pageSize;
+        int32_t pageBorder;
+        char sourceKey[64];
+    };
+
+    // the coarsest level is a single page and comes last
+    size_t pageFileSize() const {
+        return sizeof(PageFileHeader) + (levelFirstPage.back() + 1) * PAGE_BYTES;
+    }
+
+    // the page file is mapped, page reads are a copy out of the page cache instead of a seek and a read
+    bool openPageFile(std::shared_ptr<rg::MappedFile>& file) {
+        std::string key = rg::bc::sourceKey(source);
+        if (key.empty())
+            return false;
+
+        file = rg::mapAsset(pageFilePath);
+        PageFileHeader header;
+        if (file->size() >= sizeof(header)) {
+            std::memcpy(&header, file->data(), sizeof(header));
+            if (std::memcmp(header.magic, "RGVT", 4) == 0 && header.version == 1 && header.pageSize == PAGE_SIZE &&
+                header.pageBorder == PAGE_BORDER && std::strncmp(header.sourceKey, key.c_str(), sizeof(header.sourceKey)) == 0) {
+                width = header.width;
+                height = header.height;
+                computeLayout();
+                if (file->size() >= pageFileSize())
+                    return true;
+            }
+        }
+        file.reset();
+
+        auto start = std::chrono::steady_clock::now();
+        if (!buildPageFile(key))
+            return false;
+        pageFileBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Virtual texture page file for " << source << " built in " << pageFileBuildMs << " ms" << std::endl;
+
+        file = rg::mapAsset(pageFilePath);
+        return file->size() >= pageFileSize();
+    }
+
+    // cuts every mip level of the source into bordered pages and encodes them, pages in parallel
+    bool buildPageFile(const std::string& key) {
+        int components;
+        unsigned char* pixels = rg::loadImage(source, &width, &height, &components, 4);
+        if (!pixels)
+            return false;
+        computeLayout();
+
+        std::string tempPath = pageFilePath + ".tmp";
+        FILE* file = std::fopen(tempPath.c_str(), "wb");
+        if (!file) {
+            stbi_image_free(pixels);
+            return false;
+        }
+        PageFileHeader header{};
+        std::memcpy(header.magic, "RGVT", 4);
+        header.version = 1;
+        header.width = width;
+        header.height = height;
+        header.pageSize = PAGE_SIZE;
+        header.pageBorder = PAGE_BORDER;
+        std::strncpy(header.sourceKey, key.c_str(), sizeof(header.sourceKey) - 1);
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+        std::vector<unsigned char> mip;
+        const unsigned char* level = pixels;
+        int levelWidth = width, levelHeight = height;
+        for (int l = 0; l < levelCount && ok; ++l) {
+            if (l > 0) {
+                mip = rg::bc::downsample(level, levelWidth, levelHeight, levelWidth, levelHeight);
+                level = mip.data();
+            }
+            int pagesX = levelPagesX[l];
+            std::vector<unsigned char> encoded((size_t)pagesX * levelPagesY[l] * PAGE_BYTES);
+            rg::bc::parallelFor((size_t)pagesX * levelPagesY[l], [&](size_t begin, size_t end) {
+                std::vector<unsigned char> page((size_t)PADDED_PAGE_SIZE * PADDED_PAGE_SIZE * 4);
+                unsigned char block[64];
+                for (size_t p = begin; p < end; ++p) {
+                    int originX = (int)(p % pagesX) * PAGE_SIZE - PAGE_BORDER;
+                    int originY = (int)(p / pagesX) * PAGE_SIZE - PAGE_BORDER;
+                    // the border repeats the image edge where the page sits on it
+                    for (int y = 0; y < PADDED_PAGE_SIZE; ++y) {
+                        int sy = std::min(std::max(originY + y, 0), levelHeight - 1);
+                        for (int x = 0; x < PADDED_PAGE_SIZE; ++x) {
+                            int sx = std::min(std::max(originX + x, 0), levelWidth - 1);
+                            std::memcpy(&page[((size_t)y * PADDED_PAGE_SIZE + x) * 4], level + ((size_t)sy * levelWidth + sx) * 4, 4);
+                        }
+                    }
+                    unsigned char* out = &encoded[p * PAGE_BYTES];
+                    for (int by = 0; by < PADDED_PAGE_SIZE / 4; ++by) {
+                        for (int bx = 0; bx < PADDED_PAGE_SIZE / 4; ++bx) {
+                            rg::bc::fetchBlock(page.data(), PADDED_PAGE_SIZE, PADDED_PAGE_SIZE, bx, by, block);
+                            rg::bc::encodeBC1Block(block, out);
+                            out += 8;
+                        }
+                    }
+                }
+            });
+            ok = std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+        }
+        stbi_image_free(pixels);
+        std::fclose(file);
+        // written under a temporary name so an interrupted build is never mistaken for a complete one
+        ok = ok && std::rename(tempPath.c_str(), pageFilePath.c_str()) == 0;
+        if (!ok)
+            std::remove(tempPath.c_str());
+        return ok;
+    }
+
+    void streamMain() {
+        std::shared_ptr<rg::MappedFile> file;
+        if (!openPageFile(file)) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE:: could not open or build a page file for " << source << std::endl;
+            state.store(Failed, std::memory_order_release);
+            return;
+        }
+        state.store(Streaming, std::memory_order_release);
+
+        while (true) {
+            uint32_t key;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !requests.empty(); });
+                if (stopping)
+                    break;
+                key = requests.back();
+                requests.pop_back();
+            }
+
+            int level = keyLevel(key);
+            size_t index = levelFirstPage[level] + (size_t)keyY(key) * levelPagesX[level] + keyX(key);
+            const unsigned char* encoded = file->data() + sizeof(PageFileHeader) + index * PAGE_BYTES;
+            StreamedPage page{key, compressedCache ? std::vector<unsigned char>(encoded, encoded + PAGE_BYTES) : decodePage(encoded)};
+            rg::recordAssetIO(pageFilePath, 0, PAGE_BYTES, 0.0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back(std::move(page));
+        }
+    }
+
+    static std::vector<unsigned char> decodePage(const unsigned char* encoded) {
+        std::vector<unsigned char> rgba((size_t)PADDED_PAGE_SIZE * PADDED_PAGE_SIZE * 4);
+        unsigned char block[64];
+        const int blocksPerRow = PADDED_PAGE_SIZE / 4;
+        for (int b = 0; b < blocksPerRow * blocksPerRow; ++b) {
+            rg::bc::decodeBC1Block(&encoded[b * 8], block);
+            int x = (b % blocksPerRow) * 4, y = (b / blocksPerRow) * 4;
+            for (int row = 0; row < 4; ++row)
+                std::memcpy(&rgba[((size_t)(y + row) * PADDED_PAGE_SIZE + x) * 4], block + row * 16, 16);
+        }
+        return rgba;
+    }
+
+    // -- render thread --
+
+    void createIndirection() {
+        topLevel = levelCount - 1;
+        indirection.resize(levelCount);
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        for (int level = 0; level < levelCount; ++level) {
+            int side = std::max(indirectionSide >> level, 1);
+            indirection[level].assign((size_t)side * side * 4, 0);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8UI, side, side, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, topLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        stats.cachePages = (unsigned int)slots.size();
+        // the coarsest page is the fallback for every lookup, so it is requested first and never evicted
+        requestPages({pageKey(topLevel, 0, 0)});
+    }
+
+    void resizeFeedback(int newWidth, int newHeight) {
+        feedbackWidth = newWidth;
+        feedbackHeight = newHeight;
+        glBindTexture(GL_TEXTURE_2D, feedbackColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, feedbackWidth, feedbackHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::VIRTUAL_TEXTURE:: feedback framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)feedbackWidth * feedbackHeight * 4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        // the old contents have the wrong size
+        feedbackPending = false;
+    }
+
+    // the feedback was read into a PBO one frame ago, so mapping it doesn't stall on the GPU
+    void readFeedback() {
+        if (!feedbackPending)
+            return;
+        feedbackPending = false;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[feedbackWritePBO]);
+        const unsigned char* pixels = (const unsigned char*)glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, (size_t)feedbackWidth * feedbackHeight * 4, GL_MAP_READ_BIT);
+        if (!pixels) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            return;
+        }
+
+        std::unordered_set<uint32_t> needed;
+        for (size_t i = 0; i < (size_t)feedbackWidth * feedbackHeight; ++i) {
+            const unsigned char* texel = pixels + i * 4;
+            if (texel[3] == 0)
+                continue;
+            int level = std::min((int)texel[2], topLevel);
+            int x = texel[0], y = texel[1];
+            // the coarser pages covering it are needed too, they are what the lookup falls back to
+            for (; level <= topLevel; ++level, x /= 2, y /= 2) {
+                if (!needed.insert(pageKey(level, x, y)).second)
+                    break;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        std::vector<uint32_t> missing;
+        for (uint32_t key : needed) {
+            int level = keyLevel(key);
+            if (keyX(key) >= levelPagesX[level] || keyY(key) >= levelPagesY[level])
+                continue;
+            int slot = slotOf(key);
+            if (slot >= 0)
+                slots[slot].lastUsed = frame;
+            else
+                missing.push_back(key);
+        }
+        stats.requestedPages = (unsigned int)needed.size();
+        stats.pageFaults = (unsigned int)missing.size();
+        requestPages(missing);
+    }
+
+    // replaces the queue with the pages missing now; pages already being read are left alone
+    void requestPages(const std::vector<uint32_t>& missing) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint32_t key : requests)
+                pendingPages.erase(key);
+            requests.clear();
+            for (uint32_t key : missing) {
+                if (pendingPages.insert(key).second)
+                    requests.push_back(key);
+            }
+            // finest first, so popping from the back serves the coarse fallbacks before their children
+            std::sort(requests.begin(), requests.end(), [](uint32_t a, uint32_t b) { return keyLevel(a) < keyLevel(b); });
+        }
+        wake.notify_one();
+    }
+
+    // a free slot, or the least recently used one that wasn't needed this frame
+    int allocateSlot() {
+        int best = -1;
+        for (int i = 0; i < (int)slots.size(); ++i) {
+            if (!slots[i].used)
+                return i;
+            if (keyLevel(slots[i].key) == topLevel || slots[i].lastUsed == frame)
+                continue;
+            if (best < 0 || slots[i].lastUsed < slots[best].lastUsed)
+                best = i;
+        }
+        if (best >= 0) {
+            residentSlots.erase(slots[best].key);
+            slots[best].used = false;
+            stats.evictions++;
+        }
+        return best;
+    }
+
+    void uploadCompletedPages() {
+        std::vector<StreamedPage> pages;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t count = std::min(completed.size(), (size_t)std::max(settings.uploadsPerFrame, 1));
+            pages.assign(std::make_move_iterator(completed.begin()), std::make_move_iterator(completed.begin() + count));
+            completed.erase(completed.begin(), completed.begin() + count);
+            for (const StreamedPage& page : pages)
+                pendingPages.erase(page.key);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const StreamedPage& page : pages) {
+            if (slotOf(page.key) >= 0)
+                continue;
+            int slot = allocateSlot();
+            if (slot < 0)
+                break;
+            int x = (slot % cacheSide) * PADDED_PAGE_SIZE;
+            int y = (slot / cacheSide) * PADDED_PAGE_SIZE;
+            if (compressedCache)
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, PADDED_PAGE_SIZE, PADDED_PAGE_SIZE,
+                                          GL_COMPRESSED_RGB_S3TC_DXT1_EXT, (GLsizei)page.data.size(), page.data.data());
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, PADDED_PAGE_SIZE, PADDED_PAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE,
+                                page.data.data());
+
+            slots[slot].key = page.key;
+            slots[slot].used = true;
+            slots[slot].lastUsed = frame;
+            residentSlots[page.key] = slot;
+            stats.streamedPages++;
+            stats.streamedBytes += page.data.size();
+            stats.uploadsLastFrame++;
+            indirectionDirty = true;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        stats.residentPages = (unsigned int)residentSlots.size();
+    }
+
+    // every entry points at its own page when resident, otherwise at whatever its parent points at;
+    // the table is small (a few thousand texels), so it is rebuilt whole
+    void rebuildIndirection() {
+        indirectionDirty = false;
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = topLevel; level >= 0; --level) {
+            int side = std::max(indirectionSide >> level, 1);
+            int parentSide = std::max(indirectionSide >> (level + 1), 1);
+            std::vector<unsigned char>& entries = indirection[level];
+            for (int y = 0; y < side; ++y) {
+                for (int x = 0; x < side; ++x) {
+                    unsigned char* entry = &entries[((size_t)y * side + x) * 4];
+                    int slot = x < levelPagesX[level] && y < levelPagesY[level] ? slotOf(pageKey(level, x, y)) : -1;
+                    if (slot >= 0) {
+                        entry[0] = (unsigned char)(slot % cacheSide);
+                        entry[1] = (unsigned char)(slot / cacheSide);
+                        entry[2] = (unsigned char)level;
+                        entry[3] = 1;
+                    } else if (level < topLevel) {
+                        std::memcpy(entry, &indirection[level + 1][((size_t)std::min(y / 2, parentSide - 1) * parentSide +
+                                                                    std::min(x / 2, parentSide - 1)) * 4], 4);
+                    } else {
+                        std::memset(entry, 0, 4);
+                    }
+                }
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, side, side, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+
+#endif //PROJECT_BASE_VIRTUALTEXTURE_H
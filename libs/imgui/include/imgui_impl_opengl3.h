@@ -30,12 +30,30 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_Shutdown();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_NewFrame();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data);
 
+// (Optional) Rendering modes, see ImGui_ImplOpenGL3_RenderFlags_
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetRenderFlags(int flags);
+IMGUI_IMPL_API int      ImGui_ImplOpenGL3_GetRenderFlags();
+
 // (Optional) Called by Init/NewFrame/Shutdown
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+enum ImGui_ImplOpenGL3_RenderFlags_
+{
+    ImGui_ImplOpenGL3_RenderFlags_None                  = 0,
+    // Concatenate all draw lists into one vertex and one index upload per frame, written into a ring buffer with
+    // glMapBufferRange(GL_MAP_UNSYNCHRONIZED_BIT) and fenced so a range is only reused once the GPU has read it.
+    // Draws address their list through base vertex and index offsets. Desktop GL 3.2+, ignored otherwise.
+    ImGui_ImplOpenGL3_RenderFlags_StreamBuffer          = 1 << 0,
+    // Skip the GL state backup/restore. The caller guarantees this state on entry and gets it back: blending,
+    // face culling, scissor test and primitive restart disabled, depth test enabled, polygon mode fill, texture
+    // unit 0 active with no sampler bound, viewport covering the framebuffer. Program, vertex array, array
+    // buffer and 2D texture bindings are left at 0, the blend function and equation as imgui set them.
+    ImGui_ImplOpenGL3_RenderFlags_AssumeDefaultState    = 1 << 1
+};
+
 // Specific OpenGL ES versions
 //#define IMGUI_IMPL_OPENGL_ES2     // Auto-detected on Emscripten
 //#define IMGUI_IMPL_OPENGL_ES3     // Auto-detected on iOS/Android
@@ -13,6 +13,7 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  2026-10-19: OpenGL: Added ImGui_ImplOpenGL3_SetRenderFlags() with a ring buffer upload path and an option to skip the GL state backup.
 //  2020-10-23: OpenGL: Save and restore current GL_PRIMITIVE_RESTART state.
 //  2020-10-15: OpenGL: Use glGetString(GL_VERSION) instead of glGetIntegerv(GL_MAJOR_VERSION, ...) when the later returns zero (e.g. Desktop GL 2.x)
 //  2020-09-17: OpenGL: Fix to avoid compiling/calling glBindSampler() on ES or pre 3.3 context which have the defines set by a loader.
@@ -135,6 +136,11 @@ using namespace gl;
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
 #endif
 
+// Desktop GL 3.2+ has sync objects, used to fence the ring buffer of ImGui_ImplOpenGL3_RenderFlags_StreamBuffer
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && defined(GL_VERSION_3_2)
+#define IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+#endif
+
 // Desktop GL 3.1+ has GL_PRIMITIVE_RESTART state
 #if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && defined(GL_VERSION_3_1)
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
@@ -148,6 +154,21 @@ static GLuint       g_ShaderHandle = 0, g_VertHandle = 0, g_FragHandle = 0;
 static GLint        g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;                                // Uniforms location
 static GLuint       g_AttribLocationVtxPos = 0, g_AttribLocationVtxUV = 0, g_AttribLocationVtxColor = 0; // Vertex attributes location
 static unsigned int g_VboHandle = 0, g_ElementsHandle = 0;
+static int          g_RenderFlags = ImGui_ImplOpenGL3_RenderFlags_None;
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+// ImGui_ImplOpenGL3_RenderFlags_StreamBuffer: vertices and indices of every frame share one buffer and a VAO kept across frames
+#define IMGUI_IMPL_OPENGL_STREAM_FRAMES 3
+struct ImGui_ImplOpenGL3_StreamFrame
+{
+    GLsync      Fence;
+    GLsizeiptr  Begin, End;
+};
+static GLuint       g_StreamHandle = 0, g_StreamVertexArray = 0;
+static GLsizeiptr   g_StreamSize = 0, g_StreamHead = 0;
+static ImGui_ImplOpenGL3_StreamFrame g_StreamFrames[IMGUI_IMPL_OPENGL_STREAM_FRAMES] = {};
+static int          g_StreamFrameIndex = 0;
+#endif
 
 // Functions
 bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
@@ -235,13 +256,23 @@ void    ImGui_ImplOpenGL3_Shutdown()
     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 }
 
+void    ImGui_ImplOpenGL3_SetRenderFlags(int flags)
+{
+    g_RenderFlags = flags;
+}
+
+int     ImGui_ImplOpenGL3_GetRenderFlags()
+{
+    return g_RenderFlags;
+}
+
 void    ImGui_ImplOpenGL3_NewFrame()
 {
     if (!g_ShaderHandle)
         ImGui_ImplOpenGL3_CreateDeviceObjects();
 }
 
-static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object)
+static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object, GLuint vertex_buffer, GLuint index_buffer)
 {
     // Setup render state: alpha-blending enabled, no face culling, no depth testing, scissor enabled, polygon fill
     glEnable(GL_BLEND);
@@ -296,8 +327,8 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
 #endif
 
     // Bind vertex/index buffers and setup attributes for ImDrawVert
-    glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
     glEnableVertexAttribArray(g_AttribLocationVtxPos);
     glEnableVertexAttribArray(g_AttribLocationVtxUV);
     glEnableVertexAttribArray(g_AttribLocationVtxColor);
@@ -306,6 +337,161 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glVertexAttribPointer(g_AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
 }
 
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+static void ImGui_ImplOpenGL3_WaitStreamFrame(ImGui_ImplOpenGL3_StreamFrame* frame)
+{
+    if (frame->Fence == NULL)
+        return;
+    while (glClientWaitSync(frame->Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(frame->Fence);
+    frame->Fence = NULL;
+}
+
+// Copy the vertices, then the indices, of every draw list into the ring buffer with a single map.
+// Returns the byte offsets of both, or false if the buffer could not be mapped.
+static bool ImGui_ImplOpenGL3_UploadStream(ImDrawData* draw_data, GLsizeiptr* vtx_offset, GLsizeiptr* idx_offset)
+{
+    const GLsizeiptr vtx_size = (GLsizeiptr)draw_data->TotalVtxCount * (int)sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)draw_data->TotalIdxCount * (int)sizeof(ImDrawIdx);
+    const GLsizeiptr frame_size = vtx_size + idx_size;
+
+    // Room for every frame in flight. Re-specifying the store orphans the old one, the GL keeps it alive until the GPU is done with it.
+    if (frame_size * IMGUI_IMPL_OPENGL_STREAM_FRAMES > g_StreamSize)
+    {
+        GLsizeiptr size = 64 * 1024;
+        while (size < frame_size * IMGUI_IMPL_OPENGL_STREAM_FRAMES)
+            size *= 2;
+        for (int i = 0; i < IMGUI_IMPL_OPENGL_STREAM_FRAMES; i++)
+            if (g_StreamFrames[i].Fence) { glDeleteSync(g_StreamFrames[i].Fence); g_StreamFrames[i].Fence = NULL; }
+        if (g_StreamHandle == 0)
+            glGenBuffers(1, &g_StreamHandle);
+        glBindBuffer(GL_ARRAY_BUFFER, g_StreamHandle);
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        g_StreamSize = size;
+        g_StreamHead = 0;
+    }
+
+    // The frame starts on a whole vertex so its offset turns into a base vertex; the indices that follow the vertices stay 4 byte aligned.
+    GLsizeiptr begin = (g_StreamHead + (GLsizeiptr)sizeof(ImDrawVert) - 1) / (GLsizeiptr)sizeof(ImDrawVert) * (GLsizeiptr)sizeof(ImDrawVert);
+    if (begin + frame_size > g_StreamSize)
+        begin = 0;
+    const GLsizeiptr end = begin + frame_size;
+
+    // Keep at most IMGUI_IMPL_OPENGL_STREAM_FRAMES frames in flight, and never write a range the GPU may still be reading.
+    ImGui_ImplOpenGL3_StreamFrame* frame = &g_StreamFrames[g_StreamFrameIndex];
+    ImGui_ImplOpenGL3_WaitStreamFrame(frame);
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_STREAM_FRAMES; i++)
+        if (g_StreamFrames[i].Fence && g_StreamFrames[i].Begin < end && begin < g_StreamFrames[i].End)
+            ImGui_ImplOpenGL3_WaitStreamFrame(&g_StreamFrames[i]);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_StreamHandle);
+    char* dst = (char*)glMapBufferRange(GL_ARRAY_BUFFER, begin, frame_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst == NULL)
+        return false;
+    char* vtx_dst = dst;
+    char* idx_dst = dst + vtx_size;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        memcpy(vtx_dst, cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+        memcpy(idx_dst, cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        vtx_dst += cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        idx_dst += cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    frame->Begin = begin;
+    frame->End = end;
+    g_StreamHead = end;
+    *vtx_offset = begin;
+    *idx_offset = begin + vtx_size;
+    return true;
+}
+#endif
+
+// GL state touched by the render function, saved before and restored after unless ImGui_ImplOpenGL3_RenderFlags_AssumeDefaultState is set
+struct ImGui_ImplOpenGL3_StateBackup
+{
+    GLenum      ActiveTexture;
+    GLuint      Program;
+    GLuint      Texture;
+    GLuint      Sampler;
+    GLuint      ArrayBuffer;
+    GLuint      VertexArrayObject;
+    GLint       PolygonMode[2];
+    GLint       Viewport[4];
+    GLint       ScissorBox[4];
+    GLenum      BlendSrcRgb, BlendDstRgb, BlendSrcAlpha, BlendDstAlpha;
+    GLenum      BlendEquationRgb, BlendEquationAlpha;
+    GLboolean   EnableBlend, EnableCullFace, EnableDepthTest, EnableScissorTest, EnablePrimitiveRestart;
+};
+
+static void ImGui_ImplOpenGL3_BackupState(ImGui_ImplOpenGL3_StateBackup* backup)
+{
+    glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&backup->ActiveTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*)&backup->Program);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&backup->Texture);
+    backup->Sampler = 0;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
+    if (g_GlVersion >= 330) { glGetIntegerv(GL_SAMPLER_BINDING, (GLint*)&backup->Sampler); }
+#endif
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint*)&backup->ArrayBuffer);
+    backup->VertexArrayObject = 0;
+#ifndef IMGUI_IMPL_OPENGL_ES2
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint*)&backup->VertexArrayObject);
+#endif
+#ifdef GL_POLYGON_MODE
+    glGetIntegerv(GL_POLYGON_MODE, backup->PolygonMode);
+#endif
+    glGetIntegerv(GL_VIEWPORT, backup->Viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, backup->ScissorBox);
+    glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&backup->BlendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&backup->BlendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&backup->BlendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&backup->BlendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&backup->BlendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&backup->BlendEquationAlpha);
+    backup->EnableBlend = glIsEnabled(GL_BLEND);
+    backup->EnableCullFace = glIsEnabled(GL_CULL_FACE);
+    backup->EnableDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    backup->EnableScissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    backup->EnablePrimitiveRestart = GL_FALSE;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
+    backup->EnablePrimitiveRestart = (g_GlVersion >= 310) ? glIsEnabled(GL_PRIMITIVE_RESTART) : GL_FALSE;
+#endif
+}
+
+static void ImGui_ImplOpenGL3_RestoreState(const ImGui_ImplOpenGL3_StateBackup* backup)
+{
+    glUseProgram(backup->Program);
+    glBindTexture(GL_TEXTURE_2D, backup->Texture);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
+    if (g_GlVersion >= 330)
+        glBindSampler(0, backup->Sampler);
+#endif
+    glActiveTexture(backup->ActiveTexture);
+#ifndef IMGUI_IMPL_OPENGL_ES2
+    glBindVertexArray(backup->VertexArrayObject);
+#endif
+    glBindBuffer(GL_ARRAY_BUFFER, backup->ArrayBuffer);
+    glBlendEquationSeparate(backup->BlendEquationRgb, backup->BlendEquationAlpha);
+    glBlendFuncSeparate(backup->BlendSrcRgb, backup->BlendDstRgb, backup->BlendSrcAlpha, backup->BlendDstAlpha);
+    if (backup->EnableBlend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    if (backup->EnableCullFace) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    if (backup->EnableDepthTest) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    if (backup->EnableScissorTest) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
+    if (g_GlVersion >= 310) { if (backup->EnablePrimitiveRestart) glEnable(GL_PRIMITIVE_RESTART); else glDisable(GL_PRIMITIVE_RESTART); }
+#endif
+
+#ifdef GL_POLYGON_MODE
+    glPolygonMode(GL_FRONT_AND_BACK, (GLenum)backup->PolygonMode[0]);
+#endif
+    glViewport(backup->Viewport[0], backup->Viewport[1], (GLsizei)backup->Viewport[2], (GLsizei)backup->Viewport[3]);
+    glScissor(backup->ScissorBox[0], backup->ScissorBox[1], (GLsizei)backup->ScissorBox[2], (GLsizei)backup->ScissorBox[3]);
+}
+
 // OpenGL3 Render function.
 // Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly.
 // This is in order to be able to run within an OpenGL engine that doesn't do so.
@@ -318,57 +504,66 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
         return;
 
     // Backup GL state
-    GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
-    glActiveTexture(GL_TEXTURE0);
-    GLuint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*)&last_program);
-    GLuint last_texture; glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&last_texture);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
-    GLuint last_sampler; if (g_GlVersion >= 330) { glGetIntegerv(GL_SAMPLER_BINDING, (GLint*)&last_sampler); } else { last_sampler = 0; }
-#endif
-    GLuint last_array_buffer; glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint*)&last_array_buffer);
-#ifndef IMGUI_IMPL_OPENGL_ES2
-    GLuint last_vertex_array_object; glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint*)&last_vertex_array_object);
-#endif
-#ifdef GL_POLYGON_MODE
-    GLint last_polygon_mode[2]; glGetIntegerv(GL_POLYGON_MODE, last_polygon_mode);
-#endif
-    GLint last_viewport[4]; glGetIntegerv(GL_VIEWPORT, last_viewport);
-    GLint last_scissor_box[4]; glGetIntegerv(GL_SCISSOR_BOX, last_scissor_box);
-    GLenum last_blend_src_rgb; glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&last_blend_src_rgb);
-    GLenum last_blend_dst_rgb; glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&last_blend_dst_rgb);
-    GLenum last_blend_src_alpha; glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&last_blend_src_alpha);
-    GLenum last_blend_dst_alpha; glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&last_blend_dst_alpha);
-    GLenum last_blend_equation_rgb; glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&last_blend_equation_rgb);
-    GLenum last_blend_equation_alpha; glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&last_blend_equation_alpha);
-    GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
-    GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
-    GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
-    GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
-    GLboolean last_enable_primitive_restart = (g_GlVersion >= 310) ? glIsEnabled(GL_PRIMITIVE_RESTART) : GL_FALSE;
+    const bool backup_state = (g_RenderFlags & ImGui_ImplOpenGL3_RenderFlags_AssumeDefaultState) == 0;
+    ImGui_ImplOpenGL3_StateBackup backup;
+    if (backup_state)
+        ImGui_ImplOpenGL3_BackupState(&backup);
+
+    // Upload every draw list at once into the ring buffer, or one list at a time below
+    GLuint vertex_buffer = g_VboHandle, index_buffer = g_ElementsHandle;
+    GLint stream_base_vertex = 0;
+    GLsizeiptr stream_idx_offset = 0;
+    bool use_stream = false;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+    if ((g_RenderFlags & ImGui_ImplOpenGL3_RenderFlags_StreamBuffer) && g_GlVersion >= 320 && draw_data->TotalVtxCount > 0)
+    {
+        GLsizeiptr stream_vtx_offset = 0;
+        use_stream = ImGui_ImplOpenGL3_UploadStream(draw_data, &stream_vtx_offset, &stream_idx_offset);
+        if (use_stream)
+        {
+            vertex_buffer = index_buffer = g_StreamHandle;
+            stream_base_vertex = (GLint)(stream_vtx_offset / (GLsizeiptr)sizeof(ImDrawVert));
+        }
+    }
 #endif
 
     // Setup desired GL state
     // Recreate the VAO every time (this is to easily allow multiple GL contexts to be rendered to. VAO are not shared among GL contexts)
     // The renderer would actually work without any VAO bound, but then our VertexAttrib calls would overwrite the default one currently bound.
+    // The stream buffer mode keeps one VAO, it already ties the backend to the context its buffer lives in.
     GLuint vertex_array_object = 0;
 #ifndef IMGUI_IMPL_OPENGL_ES2
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+    if (use_stream)
+    {
+        if (g_StreamVertexArray == 0)
+            glGenVertexArrays(1, &g_StreamVertexArray);
+        vertex_array_object = g_StreamVertexArray;
+    }
+    else
+#endif
     glGenVertexArrays(1, &vertex_array_object);
 #endif
-    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object, vertex_buffer, index_buffer);
 
     // Will project scissor/clipping rectangles into framebuffer space
     ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
 
     // Render command lists
+    // (Offsets of the current list in the stream buffer, they stay 0 when each list is uploaded on its own)
+    int global_vtx_offset = 0;
+    int global_idx_offset = 0;
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
 
         // Upload vertex/index buffers
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        if (!use_stream)
+        {
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
@@ -378,7 +573,7 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
                 // User callback, registered via ImDrawList::AddCallback()
                 // (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
                 if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
-                    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+                    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object, vertex_buffer, index_buffer);
                 else
                     pcmd->UserCallback(cmd_list, pcmd);
             }
@@ -398,49 +593,53 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 
                     // Bind texture, Draw
                     glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->TextureId);
+                    const intptr_t idx_offset = (intptr_t)stream_idx_offset + (intptr_t)(global_idx_offset + pcmd->IdxOffset) * (intptr_t)sizeof(ImDrawIdx);
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
                     if (g_GlVersion >= 320)
-                        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset);
+                        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)idx_offset, stream_base_vertex + global_vtx_offset + (GLint)pcmd->VtxOffset);
                     else
 #endif
-                    glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)));
+                    glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)idx_offset);
                 }
             }
         }
+        if (use_stream)
+        {
+            global_vtx_offset += cmd_list->VtxBuffer.Size;
+            global_idx_offset += cmd_list->IdxBuffer.Size;
+        }
     }
 
-    // Destroy the temporary VAO
-#ifndef IMGUI_IMPL_OPENGL_ES2
-    glDeleteVertexArrays(1, &vertex_array_object);
-#endif
-
-    // Restore modified GL state
-    glUseProgram(last_program);
-    glBindTexture(GL_TEXTURE_2D, last_texture);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
-    if (g_GlVersion >= 330)
-        glBindSampler(0, last_sampler);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+    // Fence the frame's range of the stream buffer, destroy the temporary VAO otherwise
+    if (use_stream)
+    {
+        g_StreamFrames[g_StreamFrameIndex].Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        g_StreamFrameIndex = (g_StreamFrameIndex + 1) % IMGUI_IMPL_OPENGL_STREAM_FRAMES;
+    }
+    else
 #endif
-    glActiveTexture(last_active_texture);
+    {
 #ifndef IMGUI_IMPL_OPENGL_ES2
-    glBindVertexArray(last_vertex_array_object);
-#endif
-    glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
-    glBlendEquationSeparate(last_blend_equation_rgb, last_blend_equation_alpha);
-    glBlendFuncSeparate(last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha);
-    if (last_enable_blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
-    if (last_enable_cull_face) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
-    if (last_enable_depth_test) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
-    if (last_enable_scissor_test) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
-    if (g_GlVersion >= 310) { if (last_enable_primitive_restart) glEnable(GL_PRIMITIVE_RESTART); else glDisable(GL_PRIMITIVE_RESTART); }
+        glDeleteVertexArrays(1, &vertex_array_object);
 #endif
+    }
 
-#ifdef GL_POLYGON_MODE
-    glPolygonMode(GL_FRONT_AND_BACK, (GLenum)last_polygon_mode[0]);
+    // Restore modified GL state, or return to the state the caller promised
+    if (backup_state)
+    {
+        ImGui_ImplOpenGL3_RestoreState(&backup);
+        return;
+    }
+    glUseProgram(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+#ifndef IMGUI_IMPL_OPENGL_ES2
+    glBindVertexArray(0);
 #endif
-    glViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
-    glScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glEnable(GL_DEPTH_TEST);
 }
 
 bool ImGui_ImplOpenGL3_CreateFontsTexture()
@@ -703,6 +902,12 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
 {
     if (g_VboHandle)        { glDeleteBuffers(1, &g_VboHandle); g_VboHandle = 0; }
     if (g_ElementsHandle)   { glDeleteBuffers(1, &g_ElementsHandle); g_ElementsHandle = 0; }
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFER
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_STREAM_FRAMES; i++)
+        if (g_StreamFrames[i].Fence) { glDeleteSync(g_StreamFrames[i].Fence); g_StreamFrames[i].Fence = NULL; }
+    if (g_StreamVertexArray){ glDeleteVertexArrays(1, &g_StreamVertexArray); g_StreamVertexArray = 0; }
+    if (g_StreamHandle)     { glDeleteBuffers(1, &g_StreamHandle); g_StreamHandle = 0; g_StreamSize = g_StreamHead = 0; }
+#endif
     if (g_ShaderHandle && g_VertHandle) { glDetachShader(g_ShaderHandle, g_VertHandle); }
     if (g_ShaderHandle && g_FragHandle) { glDetachShader(g_ShaderHandle, g_FragHandle); }
     if (g_VertHandle)       { glDeleteShader(g_VertHandle); g_VertHandle = 0; }
@@ -0,0 +1,210 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// 0 transmittance, 1 multiple scattering, 2 sky view; see rg/Atmosphere.h
+uniform int lutPass;
+uniform sampler2D transmittanceLut;
+uniform sampler2D multiScatteringLut;
+// world space, towards the sun
+uniform vec3 sunDirection;
+
+const float PI = 3.14159265;
+
+// Earth's atmosphere, distances in km
+const float bottomRadius = 6360.0;
+const float topRadius = 6460.0;
+const vec3 rayleighScattering = vec3(5.802, 13.558, 33.1) * 1e-3;
+const float rayleighScaleHeight = 8.0;
+const float mieScattering = 3.996e-3;
+const float mieExtinction = 4.440e-3;
+const float mieScaleHeight = 1.2;
+const float mieAnisotropy = 0.8;
+// ozone only absorbs, its density is a tent 30 km wide around 25 km
+const vec3 ozoneAbsorption = vec3(0.650, 1.881, 0.085) * 1e-3;
+const vec3 groundAlbedo = vec3(0.3);
+// the camera stands 200 m above the ground
+const float viewRadius = bottomRadius + 0.2;
+
+// distance along the ray to the sphere around the planet's center, the far hit from inside; -1 on a miss
+float raySphere(vec3 origin, vec3 direction, float radius)
+{
+    float r = length(origin);
+    float b = dot(origin, direction);
+    // written as a product, r * r - radius * radius loses everything in float next to the planet's surface
+    float c = (r - radius) * (r + radius);
+    float d = b * b - c;
+    if (d < 0.0)
+        return -1.0;
+    float s = sqrt(d);
+    if (-b - s >= 0.0)
+        return -b - s;
+    return -b + s >= 0.0 ? -b + s : -1.0;
+}
+
+void sampleMedium(float radius, out vec3 rayleigh, out float mie, out vec3 extinction)
+{
+    float height = max(radius - bottomRadius, 0.0);
+    rayleigh = rayleighScattering * exp(-height / rayleighScaleHeight);
+    float mieDensity = exp(-height / mieScaleHeight);
+    mie = mieScattering * mieDensity;
+    float ozone = max(0.0, 1.0 - abs(height - 25.0) / 15.0);
+    extinction = rayleigh + vec3(mieExtinction * mieDensity) + ozoneAbsorption * ozone;
+}
+
+float rayleighPhase(float cosTheta)
+{
+    return 3.0 / (16.0 * PI) * (1.0 + cosTheta * cosTheta);
+}
+
+// Cornette-Shanks
+float miePhase(float cosTheta)
+{
+    float g = mieAnisotropy;
+    float k = 3.0 / (8.0 * PI) * (1.0 - g * g) / (2.0 + g * g);
+    return k * (1.0 + cosTheta * cosTheta) / pow(1.0 + g * g - 2.0 * g * cosTheta, 1.5);
+}
+
+// both LUTs are indexed by (cosine of the zenith angle, height)
+vec2 transmittanceUv(float radius, float cosZenith)
+{
+    return vec2(cosZenith * 0.5 + 0.5, sqrt(clamp((radius - bottomRadius) / (topRadius - bottomRadius), 0.0, 1.0)));
+}
+
+vec2 multiScatteringUv(float radius, float cosSunZenith)
+{
+    return vec2(cosSunZenith * 0.5 + 0.5, clamp((radius - bottomRadius) / (topRadius - bottomRadius), 0.0, 1.0));
+}
+
+vec3 sunTransmittance(vec3 position, vec3 sun)
+{
+    // in the planet's shadow
+    if (raySphere(position, sun, bottomRadius) > 0.0)
+        return vec3(0.0);
+    float radius = length(position);
+    return texture(transmittanceLut, transmittanceUv(radius, dot(position / radius, sun))).rgb;
+}
+
+vec3 transmittancePass(vec2 uv)
+{
+    float cosZenith = uv.x * 2.0 - 1.0;
+    float radius = bottomRadius + uv.y * uv.y * (topRadius - bottomRadius);
+    vec3 origin = vec3(0.0, radius, 0.0);
+    vec3 direction = vec3(sqrt(max(1.0 - cosZenith * cosZenith, 0.0)), cosZenith, 0.0);
+    float distance = max(raySphere(origin, direction, topRadius), 0.0);
+
+    const int steps = 40;
+    float dt = distance / float(steps);
+    vec3 opticalDepth = vec3(0.0);
+    for (int i = 0; i < steps; ++i) {
+        vec3 position = origin + direction * ((float(i) + 0.5) * dt);
+        vec3 rayleigh, extinction;
+        float mie;
+        sampleMedium(length(position), rayleigh, mie, extinction);
+        opticalDepth += extinction * dt;
+    }
+    return exp(-opticalDepth);
+}
+
+// Single scattering of sunlight (of illuminance 1) along the ray, and in scatteringAsOne the light scattered
+// along it when the incoming radiance is 1 everywhere. The multiple scattering pass uses an isotropic phase
+// for both media and adds the light the ground reflects; the sky view adds the multiple scattering LUT
+// instead.
+vec3 integrate(vec3 origin, vec3 direction, vec3 sun, bool multipleScatteringPass, int steps, out vec3 scatteringAsOne)
+{
+    scatteringAsOne = vec3(0.0);
+    float ground = raySphere(origin, direction, bottomRadius);
+    float distance = ground > 0.0 ? ground : raySphere(origin, direction, topRadius);
+    if (distance <= 0.0)
+        return vec3(0.0);
+
+    float cosTheta = dot(direction, sun);
+    float phaseR = multipleScatteringPass ? 1.0 / (4.0 * PI) : rayleighPhase(cosTheta);
+    float phaseM = multipleScatteringPass ? 1.0 / (4.0 * PI) : miePhase(cosTheta);
+
+    float dt = distance / float(steps);
+    vec3 luminance = vec3(0.0);
+    vec3 throughput = vec3(1.0);
+    for (int i = 0; i < steps; ++i) {
+        vec3 position = origin + direction * ((float(i) + 0.5) * dt);
+        float radius = length(position);
+        vec3 rayleigh, extinction;
+        float mie;
+        sampleMedium(radius, rayleigh, mie, extinction);
+        vec3 scattering = rayleigh + vec3(mie);
+        vec3 stepTransmittance = exp(-extinction * dt);
+
+        vec3 inScattered = (rayleigh * phaseR + mie * phaseM) * sunTransmittance(position, sun);
+        if (!multipleScatteringPass) {
+            float cosSunZenith = dot(position / radius, sun);
+            inScattered += scattering * texture(multiScatteringLut, multiScatteringUv(radius, cosSunZenith)).rgb;
+        }
+        // integrated analytically over the step, the medium is taken as constant within it
+        vec3 stepIntegral = (vec3(1.0) - stepTransmittance) / extinction;
+        luminance += throughput * inScattered * stepIntegral;
+        scatteringAsOne += throughput * scattering * stepIntegral;
+        throughput *= stepTransmittance;
+    }
+
+    if (multipleScatteringPass && ground > 0.0) {
+        vec3 normal = normalize(origin + direction * ground);
+        // lifted off the surface so the shadow test doesn't hit the ground the point lies on
+        vec3 position = normal * (bottomRadius + 0.01);
+        luminance += throughput * sunTransmittance(position, sun) * max(dot(normal, sun), 0.0) * groundAlbedo / PI;
+    }
+    return luminance;
+}
+
+// Second order scattering gathered from a sphere of directions, then all higher orders as the geometric
+// series 1 / (1 - f) of the fraction f that each order passes on.
+vec3 multiScatteringPass(vec2 uv)
+{
+    float cosSunZenith = uv.x * 2.0 - 1.0;
+    float radius = bottomRadius + uv.y * (topRadius - bottomRadius);
+    vec3 origin = vec3(0.0, radius, 0.0);
+    // the sun follows the texel here, sunDirection is only for the sky view
+    vec3 sun = vec3(sqrt(max(1.0 - cosSunZenith * cosSunZenith, 0.0)), cosSunZenith, 0.0);
+
+    const int sqrtSamples = 8;
+    vec3 secondOrder = vec3(0.0);
+    vec3 transfer = vec3(0.0);
+    for (int i = 0; i < sqrtSamples; ++i) {
+        for (int j = 0; j < sqrtSamples; ++j) {
+            // uniform over the sphere
+            float cosTheta = 1.0 - 2.0 * (float(i) + 0.5) / float(sqrtSamples);
+            float sinTheta = sqrt(max(1.0 - cosTheta * cosTheta, 0.0));
+            float phi = 2.0 * PI * (float(j) + 0.5) / float(sqrtSamples);
+            vec3 direction = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+            vec3 scatteringAsOne;
+            secondOrder += integrate(origin, direction, sun, true, 20, scatteringAsOne);
+            transfer += scatteringAsOne;
+        }
+    }
+    float samples = float(sqrtSamples * sqrtSamples);
+    // both are averages over the sphere weighted by the isotropic phase, 4 pi * 1 / (4 pi)
+    secondOrder /= samples;
+    transfer /= samples;
+    return secondOrder / (vec3(1.0) - transfer);
+}
+
+// sky view texel to view direction: azimuth around the sky, elevation squeezed towards the horizon
+vec3 skyViewDirection(vec2 uv)
+{
+    float azimuth = uv.x * 2.0 * PI;
+    float l = uv.y * 2.0 - 1.0;
+    float elevation = sign(l) * l * l * 0.5 * PI;
+    return vec3(cos(elevation) * cos(azimuth), sin(elevation), cos(elevation) * sin(azimuth));
+}
+
+void main()
+{
+    vec3 scatteringAsOne;
+    if (lutPass == 0)
+        FragColor = vec4(transmittancePass(TexCoords), 1.0);
+    else if (lutPass == 1)
+        FragColor = vec4(multiScatteringPass(TexCoords), 1.0);
+    else
+        FragColor = vec4(integrate(vec3(0.0, viewRadius, 0.0), skyViewDirection(TexCoords), normalize(sunDirection), false, 30,
+                                  scatteringAsOne), 1.0);
+}
@@ -0,0 +1,38 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+// only the lower left part of the scene target is rendered when the resolution is scaled down
+uniform vec2 uvScale;
+uniform vec2 uvClamp;
+// the first pass keeps only the bright part of the scene
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+
+vec3 Prefilter(vec3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+// dual filter downsample: the center and four diagonal taps between source texels
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec2 offset = sourceTexelSize;
+    vec3 sum = texture(source, min(uv, uvClamp)).rgb * 4.0;
+    sum += texture(source, min(uv + vec2(-offset.x, -offset.y), uvClamp)).rgb;
+    sum += texture(source, min(uv + vec2( offset.x, -offset.y), uvClamp)).rgb;
+    sum += texture(source, min(uv + vec2(-offset.x,  offset.y), uvClamp)).rgb;
+    sum += texture(source, min(uv + vec2( offset.x,  offset.y), uvClamp)).rgb;
+    vec3 color = sum / 8.0;
+    if (prefilter)
+        color = Prefilter(color);
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+
+// dual filter upsample: eight taps in a ring, blended additively onto the next larger level
+void main()
+{
+    vec2 offset = sourceTexelSize * 0.5;
+    vec3 sum = texture(source, TexCoords + vec2(-offset.x * 2.0, 0.0)).rgb;
+    sum += texture(source, TexCoords + vec2(-offset.x, offset.y)).rgb * 2.0;
+    sum += texture(source, TexCoords + vec2(0.0, offset.y * 2.0)).rgb;
+    sum += texture(source, TexCoords + vec2(offset.x, offset.y)).rgb * 2.0;
+    sum += texture(source, TexCoords + vec2(offset.x * 2.0, 0.0)).rgb;
+    sum += texture(source, TexCoords + vec2(offset.x, -offset.y)).rgb * 2.0;
+    sum += texture(source, TexCoords + vec2(0.0, -offset.y * 2.0)).rgb;
+    sum += texture(source, TexCoords + vec2(-offset.x, -offset.y)).rgb * 2.0;
+    FragColor = vec4(sum / 12.0, 1.0);
+}
@@ -8,9 +8,27 @@ in vec2 TexCoords;
 struct Material {
     sampler2D texture_diffuse1;
     sampler2D texture_specular1;
+    sampler2D texture_metallic_roughness1;
+    sampler2D texture_emissive1;
     float shininess;
 };
 
+// per material factors, see rg/Material.h; textureMask has bit 1 << slot set for every texture the material has
+struct MaterialFactors {
+    vec4 baseColor;
+    vec3 emissive;
+    float roughness;
+    float metalness;
+    float normalScale;
+    uint textureMask;
+    float padding;
+};
+
+layout (std140) uniform MaterialBlock {
+    MaterialFactors materials[256];
+};
+uniform int materialIndex;
+
 struct DirLight {
     vec3 direction;
     float power;
@@ -37,15 +55,83 @@ uniform vec3 viewPosition;
 
 uniform PointLight pointLight;
 
+// virtual texture for the albedo, see VirtualTexture.h
+uniform bool virtualTexturing;
+uniform sampler2D vtCache;
+uniform usampler2D vtIndirection;
+uniform vec2 vtSize;
+uniform float vtMaxLevel;
+uniform float vtPageSize;
+uniform float vtPageBorder;
+uniform float vtCacheSize;
+uniform float vtMipBias;
+
+// image based lighting from the skybox, see rg/EnvironmentLighting.h
+uniform bool environmentLighting;
+// irradiance over pi, already turned with the skybox
+uniform vec3 irradianceSH[9];
+uniform samplerCube prefilteredEnvironment;
+// world to cube map directions
+uniform mat3 environmentRotation;
+uniform float environmentMaxLod;
+uniform float environmentIntensity;
+
+vec3 albedo;
+// the specular map's red channel, 1 without one
+float specularMask;
+float roughness;
+float metalness;
+
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcEnvironment(vec3 normal, vec3 viewDir);
+bool HasTexture(uint slot);
+
+// the indirection entry for the page at the wanted level names the cache slot and the level of the
+// page actually resident there (the same one, or a coarser fallback)
+vec3 SampleVirtual(vec2 uv) {
+    vec2 texel = uv * vtSize;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float mip = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtMipBias;
+    float level = clamp(floor(mip), 0.0, vtMaxLevel);
+
+    uv = fract(uv);
+    vec2 levelSize = max(floor(vtSize / exp2(level)), vec2(1.0));
+    uvec4 entry = texelFetch(vtIndirection, ivec2(uv * levelSize / vtPageSize), int(level));
+    if (entry.a == 0u)
+        return vec3(0.5);
+
+    vec2 residentSize = max(floor(vtSize / exp2(float(entry.b))), vec2(1.0));
+    vec2 inPage = mod(uv * residentSize, vtPageSize);
+    vec2 cacheTexel = vec2(entry.rg) * (vtPageSize + 2.0 * vtPageBorder) + vtPageBorder + inPage;
+    return texture(vtCache, cacheTexel / vtCacheSize).rgb;
+}
 
 void main() {
+    MaterialFactors factors = materials[materialIndex];
+    albedo = virtualTexturing ? SampleVirtual(TexCoords) : vec3(texture(material.texture_diffuse1, TexCoords));
+    albedo *= factors.baseColor.rgb;
+    specularMask = HasTexture(1u) ? texture(material.texture_specular1, TexCoords).r : 1.0;
+    roughness = factors.roughness;
+    metalness = factors.metalness;
+    // glTF packing, roughness in green and metalness in blue
+    if (HasTexture(4u)) {
+        vec2 metallicRoughness = texture(material.texture_metallic_roughness1, TexCoords).bg;
+        roughness *= metallicRoughness.y;
+        metalness *= metallicRoughness.x;
+    }
+    vec3 emissive = factors.emissive;
+    if (HasTexture(5u))
+        emissive *= texture(material.texture_emissive1, TexCoords).rgb;
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
     vec3 result = CalcDirLight(light, normal, viewDir);
     result += CalcPointLight(pointLight,normal,FragPos,viewDir);
+    if (environmentLighting)
+        result += CalcEnvironment(normal, viewDir);
+    result += emissive;
     FragColor = vec4(result, 1.0);
 }
 
@@ -57,10 +143,12 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = vec3(max(light.ambient.x*light.power, 0.1f), max(light.ambient.y*light.power, 0.1f), max(light.ambient.z*light.power, 0.3f)) *
-            vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).rrr);
+    // the skybox's irradiance takes over from the floor under the ambient
+    vec3 ambient = environmentLighting ? light.ambient * light.power * albedo :
+            vec3(max(light.ambient.x*light.power, 0.1f), max(light.ambient.y*light.power, 0.1f), max(light.ambient.z*light.power, 0.3f)) *
+            albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularMask;
     return ambient + (diffuse + specular)*light.power;
     //return (ambient + diffuse);
 }
@@ -77,13 +165,39 @@ vec3 CalcPointLight(PointLight pointLight, vec3 normal, vec3 fragPos, vec3 viewD
     float distance = length(pointLight.position - fragPos);
     float attenuation = 1.0 / (pointLight.constant + pointLight.linear * distance + pointLight.quadratic * (distance * distance));
     // combine results
-    vec3 ambient = pointLight.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = pointLight.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = pointLight.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = pointLight.ambient * albedo;
+    vec3 diffuse = pointLight.diffuse * diff * albedo;
+    vec3 specular = pointLight.specular * spec * specularMask;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
     return (ambient + diffuse + specular)*pointLight.power;
 }
 
+vec3 CalcEnvironment(vec3 normal, vec3 viewDir)
+{
+    vec3 n = normal;
+    vec3 irradiance = irradianceSH[0] * 0.282095
+            + irradianceSH[1] * 0.488603 * n.y
+            + irradianceSH[2] * 0.488603 * n.z
+            + irradianceSH[3] * 0.488603 * n.x
+            + irradianceSH[4] * 1.092548 * n.x * n.y
+            + irradianceSH[5] * 1.092548 * n.y * n.z
+            + irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+            + irradianceSH[7] * 1.092548 * n.x * n.z
+            + irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    // metals have no diffuse term and tint their reflections with the base color
+    vec3 diffuse = max(irradiance, vec3(0.0)) * albedo * (1.0 - metalness);
+    // reflections, the specular map masks a Schlick Fresnel
+    vec3 reflectDir = environmentRotation * reflect(-viewDir, normal);
+    vec3 prefiltered = textureLod(prefilteredEnvironment, reflectDir, roughness * environmentMaxLod).rgb;
+    vec3 f0 = mix(vec3(0.04), albedo, metalness);
+    vec3 fresnel = f0 + (1.0 - f0) * pow(1.0 - max(dot(normal, viewDir), 0.0), 5.0);
+    vec3 specular = prefiltered * fresnel * specularMask;
+    return (diffuse + specular) * environmentIntensity;
+}
 
+bool HasTexture(uint slot)
+{
+    return (materials[materialIndex].textureMask & (1u << slot)) != 0u;
+}
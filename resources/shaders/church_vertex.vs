@@ -2,6 +2,8 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per-draw model matrix of the multi-draw indirect path, selected by the command's baseInstance
+layout (location = 5) in mat4 aInstanceModel;
 
 out vec3 Normal;
 out vec3 FragPos;
@@ -10,11 +12,16 @@ out vec2 TexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool useInstanceModel;
+
+// must match depth_prepass.vs, the shading pass after a depth pre-pass tests GL_EQUAL
+invariant gl_Position;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = vec3(model * vec4(aNormal, 1.0));
+    mat4 modelMatrix = useInstanceModel ? aInstanceModel : model;
+    FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
+    Normal = vec3(modelMatrix * vec4(aNormal, 1.0));
     TexCoords = aTexCoords;
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -4,12 +4,17 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D texture1;
-uniform float power;
+// time of day LUT, rows: sun (color, power), moon (color, power), sky, ambient
+uniform sampler2D timeOfDayLut;
+uniform float timeOfDay;
 
 void main()
 {
     vec4 texColor = texture(texture1, TexCoords);
        if(texColor.a < 0.5)
         discard;
+    float t = timeOfDay + 0.5 / float(textureSize(timeOfDayLut, 0).x);
+    // only one of them is above the horizon at a time
+    float power = texture(timeOfDayLut, vec2(t, 0.125)).a * 0.65 + texture(timeOfDayLut, vec2(t, 0.375)).a * 0.1;
     FragColor = texColor * power;
-}
\ No newline at end of file
+}
@@ -2,15 +2,19 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per-draw model matrix of the multi-draw indirect path, selected by the command's baseInstance
+layout (location = 5) in mat4 aInstanceModel;
 
 out vec2 TexCoords;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool useInstanceModel;
 
 void main()
 {
+    mat4 modelMatrix = useInstanceModel ? aInstanceModel : model;
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
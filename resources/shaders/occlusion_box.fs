@@ -0,0 +1,6 @@
+#version 330 core
+
+// only depth testing matters, color writes are masked off
+void main()
+{
+}
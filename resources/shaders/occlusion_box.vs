@@ -0,0 +1,17 @@
+#version 330 core
+
+uniform mat4 mvp;
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+// the 12 triangles of a box, as corners numbered by their x, y and z bits
+const int CORNERS[36] = int[36](0, 1, 3, 0, 3, 2,  4, 6, 7, 4, 7, 5,  0, 4, 5, 0, 5, 1,
+                                2, 3, 7, 2, 7, 6,  0, 2, 6, 0, 6, 4,  1, 5, 7, 1, 7, 3);
+
+// bounding box for an occlusion query, drawn with glDrawArrays(GL_TRIANGLES, 0, 36) and no vertex buffers
+void main()
+{
+    int corner = CORNERS[gl_VertexID];
+    vec3 t = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+    gl_Position = mvp * vec4(mix(boundsMin, boundsMax, t), 1.0);
+}
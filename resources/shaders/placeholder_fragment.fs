@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 LocalPos;
+
+uniform vec3 color;
+// 0..1, how much of the model has been uploaded
+uniform float progress;
+uniform float time;
+
+void main()
+{
+    // fill the box from the bottom up with the load progress, the rest pulses gently
+    float filled = step(LocalPos.y * 0.5 + 0.5, progress);
+    float pulse = 0.6 + 0.4 * sin(time * 4.0);
+    FragColor = vec4(color * mix(pulse * 0.5, 1.0, filled), 1.0);
+}
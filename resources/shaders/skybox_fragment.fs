@@ -2,10 +2,32 @@
 out vec4 FragColor;
 
 in vec3 TexCoords;
+in vec3 WorldDirection;
 
 uniform samplerCube skybox;
-uniform float power;
+// time of day LUT, the night sky follows the moon's power
+uniform sampler2D timeOfDayLut;
+uniform float timeOfDay;
+// atmosphere sky view LUT by azimuth and elevation, see rg/Atmosphere.h
+uniform sampler2D skyView;
+uniform bool atmosphere;
+uniform float skyIntensity;
+
+const float PI = 3.14159265;
+
+vec3 skyLuminance(vec3 direction)
+{
+    float azimuth = atan(direction.z, direction.x);
+    float elevation = asin(clamp(direction.y, -1.0, 1.0));
+    // inverse of the LUT's squeeze towards the horizon
+    float l = sign(elevation) * sqrt(abs(elevation) / (0.5 * PI));
+    return texture(skyView, vec2(azimuth / (2.0 * PI), l * 0.5 + 0.5)).rgb;
+}
 
 void main(){
-    FragColor = texture(skybox, TexCoords)*power;
-}
\ No newline at end of file
+    float t = timeOfDay + 0.5 / float(textureSize(timeOfDayLut, 0).x);
+    float power = texture(timeOfDayLut, vec2(t, 0.375)).a;
+    vec3 stars = texture(skybox, TexCoords).rgb * power;
+    vec3 sky = atmosphere ? skyLuminance(normalize(WorldDirection)) * skyIntensity : vec3(0.0);
+    FragColor = vec4(stars + sky, 1.0);
+}
@@ -2,6 +2,7 @@
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
+out vec3 WorldDirection;
 
 uniform mat4 projection;
 uniform mat4 view;
@@ -9,6 +10,8 @@ uniform mat4 model;
 
 void main(){
     TexCoords = aPos;
+    // the stars turn with the model matrix, the atmosphere stays put
+    WorldDirection = mat3(model) * aPos;
     vec4 pos = projection * view * model * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
@@ -4,8 +4,10 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform vec3 sun_color;
+// values above 1 only survive when rendering into the HDR target, where they feed the bloom
+uniform float sun_intensity;
 
 void main()
 {
-    FragColor = vec4(sun_color, 1.0f);
-}
\ No newline at end of file
+    FragColor = vec4(sun_color * sun_intensity, 1.0f);
+}
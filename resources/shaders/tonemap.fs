@@ -0,0 +1,51 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform sampler2D bloom;
+uniform float exposure;
+uniform float bloomIntensity;
+
+// the scene may cover only part of its target (dynamic resolution), it is upscaled here
+uniform vec2 uvScale;
+uniform vec2 uvClamp;
+uniform vec2 sceneTexelSize;
+uniform float sharpness;
+
+// filmic curve fitted to the ACES reference transform (Narkowicz)
+vec3 ACESFilm(vec3 x) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+
+vec3 SampleScene(vec2 uv) {
+    return texture(scene, min(uv, uvClamp)).rgb;
+}
+
+// bilinear upscale followed by an unsharp mask limited to the local min/max, so edges don't ring
+vec3 UpscaleSharpened(vec2 uv) {
+    vec3 center = SampleScene(uv);
+    if (sharpness <= 0.0)
+        return center;
+    vec3 left = SampleScene(uv - vec2(sceneTexelSize.x, 0.0));
+    vec3 right = SampleScene(uv + vec2(sceneTexelSize.x, 0.0));
+    vec3 down = SampleScene(uv - vec2(0.0, sceneTexelSize.y));
+    vec3 up = SampleScene(uv + vec2(0.0, sceneTexelSize.y));
+    vec3 lowest = min(center, min(min(left, right), min(down, up)));
+    vec3 highest = max(center, max(max(left, right), max(down, up)));
+    vec3 sharpened = center + (center - (left + right + down + up) * 0.25) * sharpness * 4.0;
+    return clamp(sharpened, lowest, highest);
+}
+
+void main()
+{
+    vec3 color = UpscaleSharpened(TexCoords * uvScale);
+    color += texture(bloom, TexCoords).rgb * bloomIntensity;
+    FragColor = vec4(ACESFilm(color * exposure), 1.0);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform vec2 vtSize;
+uniform float vtMaxLevel;
+uniform float vtPageSize;
+uniform float vtMipBias;
+
+// writes the virtual page (x, y at its level) and the level this pixel samples; alpha 0 marks no request
+void main()
+{
+    vec2 texel = TexCoords * vtSize;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float mip = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtMipBias;
+    float level = clamp(floor(mip), 0.0, vtMaxLevel);
+
+    vec2 levelSize = max(floor(vtSize / exp2(level)), vec2(1.0));
+    vec2 page = floor(fract(TexCoords) * levelSize / vtPageSize);
+    FragColor = vec4(min(page, vec2(255.0)) / 255.0, level / 255.0, 1.0);
+}
@@ -16,22 +16,48 @@
 #include <learnopengl/model.h>
 #include <learnopengl/camera.h>
 #include <rg/DayProp.h>
+#include <rg/GeometryPool.h>
+#include <rg/GLExt.h>
+#include <rg/IndirectRenderer.h>
+#include <rg/PostProcess.h>
+#include <rg/DynamicResolution.h>
+#include <rg/Viewport.h>
+#include <rg/TextureCompression.h>
+#include <rg/VirtualTexture.h>
+#include <rg/TextureStreamer.h>
+#include <rg/MappedFile.h>
+#include <rg/FramePipeline.h>
+#include <rg/Frustum.h>
+#include <rg/StreamBuffer.h>
+#include <rg/ImGuiCache.h>
+#include <rg/OcclusionCuller.h>
+#include <rg/DepthPrepass.h>
+#include <rg/TimeOfDay.h>
+#include <rg/Atmosphere.h>
+#include <rg/Cubemap.h>
+#include <rg/EnvironmentLighting.h>
+#include <rg/Material.h>
 
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void content_scale_callback(GLFWwindow* window, float xscale, float yscale);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int load_cubemap(vector<std::string> faces);
-void calculate_day(float angle);
-void calculate_night(float angle);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 unsigned int loadTexture(const char *path);
+struct InputSnapshot;
+struct FrameState;
+InputSnapshot gather_input(float time);
+void simulate_frame(const InputSnapshot& input, FrameState& frame);
 
-// settings
+// settings, initial window size in screen coordinates
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// skybox faces are filtered down to this, RGB9E5 at the 2048 of the sources would take 134 MB with mips
+const int SKYBOX_FACE_SIZE = 1024;
 
 // camera
 float lastX = SCR_WIDTH / 2.0f ;
@@ -62,14 +88,54 @@ struct PointLight{
     float quadratic;
 };
 
+// simulation thread only, the render stage reads their copies in FrameState
 DayProp sun_prop;
 DayProp moon_prop;
+float sun_degrees=0.0f;
+float moon_rotate=0.0f;
+
+// set up once before the first frame, read only afterwards
+DirLight sun_light;
+DirLight moon_light;
+PointLight pointLight;
 
 struct ProgramState{
     bool ImGuiEnabled=false;
     float SunScale=0.05f;
     float SunSpeed=1.0f;
     bool SunSpeedCheck=false;
+    bool IndirectDraw=false;
+    bool HdrEnabled=true;
+    float SunIntensity=4.0f;
+    // smoothed CPU time spent submitting the church and props, per path
+    float LoopSubmitMs=0.0f;
+    float IndirectSubmitMs=0.0f;
+    // GPU upload budget per frame for models that are still loading
+    float UploadBudgetMB=4.0f;
+    // seconds from startup until the first frame was presented
+    double TimeToFirstFrame=0.0;
+    // files from the asset manifest mapped and prefetched at startup, and how long issuing that took
+    size_t PrefetchedAssets=0;
+    double PrefetchMs=0.0;
+    // simulate the next frame on its own thread while this one renders
+    bool SimulationThread=true;
+    // smoothed CPU times: simulating a frame, rendering one, and the whole frame without the swap
+    float SimulateMs=0.0f;
+    float RenderMs=0.0f;
+    float CpuFrameMs=0.0f;
+    // draw the UI from one ring buffer upload without saving and restoring GL state, and the smoothed CPU time of that
+    bool ImGuiStreamBuffer=true;
+    float ImGuiRenderMs=0.0f;
+    // redraw an idle UI from its last build, rebuilt at most ImGuiRefreshHz times a second; smoothed build time per frame
+    bool ImGuiCache=true;
+    float ImGuiRefreshHz=15.0f;
+    float ImGuiBuildMs=0.0f;
+    // skip the sun and moon draws when occlusion queries find their bounds hidden
+    bool OcclusionCulling=true;
+    // lay down the church's depth first and shade it with GL_EQUAL, so each pixel is shaded once
+    bool DepthPrepass=true;
+    // normalized time of day of the frame last rendered, 0 sunrise, 0.25 noon, 0.5 sunset, 0.75 midnight
+    float TimeOfDay=0.0f;
     void LoadFromDisk(string path);
     void SaveToDisk(string path);
 
@@ -101,8 +167,111 @@ void ProgramState::SaveToDisk(string path){
     <<camera.Yaw<<'\n';
 }
 
+// model space bounds of a model for culling, known once it has loaded
+struct SceneModelInfo{
+    bool ready=false;
+    glm::vec3 boundsMin=glm::vec3(0.0f);
+    glm::vec3 boundsMax=glm::vec3(0.0f);
+};
+
+// what one simulated frame gets from the main thread: GLFW input and the settings keys and ImGui change,
+// copied so the simulation never reads anything the main thread writes
+struct InputSnapshot{
+    double time=0.0;
+    float deltaTime=0.0f;
+    bool forward=false;
+    bool backward=false;
+    bool left=false;
+    bool right=false;
+    // mouse and scroll movement since the previous snapshot
+    float mouseX=0.0f;
+    float mouseY=0.0f;
+    float scroll=0.0f;
+    float aspect=1.0f;
+    float sunSpeed=1.0f;
+    float sunScale=0.05f;
+    float sunIntensity=4.0f;
+    bool hdrEnabled=true;
+    // the skybox pass draws the atmosphere, so it runs by day as well
+    bool atmosphere=false;
+    SceneModelInfo church;
+    SceneModelInfo sun;
+    SceneModelInfo moon;
+};
+
+enum class DrawKind{ Church, Placeholder, Sun, Moon, Floor, Skybox };
+
+struct DrawItem{
+    DrawKind kind;
+    glm::mat4 model;
+};
+
+// everything the render stage needs for one frame, written by the simulation and only read afterwards
+struct FrameState{
+    double time=0.0;
+    glm::vec3 cameraPosition=glm::vec3(0.0f);
+    glm::mat4 projection=glm::mat4(1.0f);
+    glm::mat4 view=glm::mat4(1.0f);
+    DayProp sun;
+    DayProp moon;
+    // normalized time of day the shaders look the time of day LUT up with
+    float timeOfDay=0.0f;
+    float moonRotate=0.0f;
+    // the skybox's model rotation, the environment lighting turns with it
+    glm::mat3 skyRotation=glm::mat3(1.0f);
+    // the directional light on the church, the moon's while it is up; none when both are below the horizon
+    bool lightActive=false;
+    DirLight light;
+    float shininess=0.5f;
+    float lightPower=0.0f;
+    PointLight pointLight;
+    float sunIntensity=1.0f;
+    // the church transform is kept for the virtual texture feedback pass
+    glm::mat4 churchModel=glm::mat4(1.0f);
+    bool churchVisible=false;
+    // what survived culling, in draw order
+    std::vector<DrawItem> draws;
+};
+
 ProgramState* programState;
+// simulates frame N + 1 on its own thread while frame N renders
+FramePipeline<InputSnapshot, FrameState>* frame_pipeline = nullptr;
+// what the GLFW callbacks collected since the last snapshot, main thread only
+InputSnapshot pending_input;
+// vertex/index storage shared by all static models
+GeometryPool* static_geometry;
+// per-frame dynamic data, written straight into GPU visible memory
+StreamBuffer* stream_buffer = nullptr;
+// multi-draw indirect path over static_geometry, null when the context can't do it
+IndirectRenderer* static_renderer = nullptr;
+// HDR scene target with the bloom and tonemapping chain
+PostProcess* post_process = nullptr;
+// scales the HDR scene's render resolution to hold the GPU frame time target
+DynamicResolution dynamic_resolution;
+// framebuffer size, projection aspect and debounced reallocation of render targets
+ViewportManager* viewport_manager = nullptr;
+// occlusion queries and conditional rendering for the sun and moon
+OcclusionCuller* occlusion_culler = nullptr;
+// position-only copy of the church for its depth pre-pass
+DepthPrepass* depth_prepass = nullptr;
+// sun, moon and sky curves baked into a table and a LUT, read by the simulation and the shaders
+TimeOfDay* time_of_day = nullptr;
+// precomputed scattering LUTs for the sky, updated when the sun has moved
+Atmosphere* atmosphere = nullptr;
+// how the skybox was loaded: decoded and converted, or read from its cache
+rg::CubemapStats skybox_load;
+// irradiance SH and prefiltered reflections of the skybox, built with it
+EnvironmentLighting* environment_lighting = nullptr;
+// last UI draw data, redrawn while nothing in the UI changes
+ImGuiFrameCache imgui_cache;
+// models imported in the background and uploaded a slice per frame
+std::shared_ptr<AsyncModel> church_async, sun_async, moon_async;
+// raises each texture's resident mip level to what its on-screen size needs, within a VRAM budget
+TextureStreamer texture_streamer;
+// streams the church's photogrammetry albedo page by page, null when the source image is missing
+VirtualTexture* church_virtual_texture = nullptr;
 void DrawImGui(ProgramState* programState);
+void BuildImGui(ProgramState* programState);
 
 int main()
 {
@@ -116,6 +285,9 @@ int main()
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+#ifdef GLFW_SCALE_TO_MONITOR
+    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GL_TRUE);
+#endif
 
     // glfw window creation
     // --------------------
@@ -131,12 +303,16 @@ int main()
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window,key_callback);
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 3)
+    glfwSetWindowContentScaleCallback(window, content_scale_callback);
+#endif
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    rg::loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
 
     IMGUI_CHECKVERSION();
@@ -149,6 +325,8 @@ int main()
 
 
     glEnable(GL_DEPTH_TEST);
+    // filter across cube map face edges, the skybox mips would show the seams otherwise
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     programState=new ProgramState();
 
@@ -157,14 +335,63 @@ int main()
     if(programState->ImGuiEnabled)
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
+    // a packed build reads its resources from the archive; loose files edited since packing still win
+    if(FileSystem::mountArchive(FileSystem::getPath("resources.pack")))
+        std::cout << "Mounted resources.pack, " << FileSystem::getArchive()->size() << " files" << std::endl;
+
+    // start reading everything the loaders will need, set RG_PREFETCH=0 to measure without it
+    const char* prefetch = getenv("RG_PREFETCH");
+    if(!prefetch || std::string(prefetch) != "0") {
+        double prefetch_start = glfwGetTime();
+        programState->PrefetchedAssets = rg::prefetchAssets(FileSystem::getPath("resources/asset_manifest.txt"), FileSystem::getPath("."));
+        programState->PrefetchMs = (glfwGetTime() - prefetch_start) * 1000.0;
+        std::cout << "Prefetched " << programState->PrefetchedAssets << " assets in " << programState->PrefetchMs << " ms" << std::endl;
+    }
+
+    rg::textureStreamer() = &texture_streamer;
+    static_geometry = new GeometryPool(MeshVertexFormat(), 256 * 1024, 768 * 1024);
+    stream_buffer = new StreamBuffer();
+    occlusion_culler = new OcclusionCuller((int)DrawKind::Skybox + 1);
+    depth_prepass = new DepthPrepass();
+    time_of_day = new TimeOfDay();
+    if(!time_of_day->load(FileSystem::getPath("resources/time_of_day.txt")))
+        std::cout << "Time of day curves not found, using the built-in ones" << std::endl;
+    atmosphere = new Atmosphere();
+    environment_lighting = new EnvironmentLighting();
+    if(rg::glCaps.multiDrawIndirect)
+        static_renderer = new IndirectRenderer(*static_geometry, *stream_buffer);
+
+    viewport_manager = new ViewportManager(window);
+    io.FontGlobalScale = viewport_manager->contentScale();
+    post_process = new PostProcess(viewport_manager->width(), viewport_manager->height());
+    viewport_manager->addResizeListener([](int width, int height) {
+        post_process->resize(width, height);
+    });
+
+    // the church albedo is far too large to upload whole, it is virtually textured when available
+    std::string church_albedo = FileSystem::getPath("resources/objects/church/aberkios_100k_texture_u1_v1.jpg");
+    if(VirtualTexture::sourceAvailable(church_albedo))
+        church_virtual_texture = new VirtualTexture(church_albedo);
+
+    // the models load in the background, meshes show up as they are uploaded. The church keeps its own
+    // albedo for when the virtual texture is off, building or failed; the streamer keeps only its coarse
+    // levels resident while the virtual texture is in use
+    church_async = Model::LoadAsync(FileSystem::getPath("resources/objects/church/aberkios_100k_texture.obj"), false, static_geometry);
+    sun_async = Model::LoadAsync(FileSystem::getPath("resources/objects/planet/planet.obj"), false, static_geometry);
+    moon_async = Model::LoadAsync(FileSystem::getPath("resources/objects/moon/planet.obj"), false, static_geometry);
+
     Shader church_shader("church_vertex.vs", "church_fragment.fs");
-    Model church_model(FileSystem::getPath("resources/objects/church/aberkios_100k_texture.obj"));
+    MaterialTable::connect(church_shader);
+    Model& church_model = church_async->get();
 
     Shader sun_shader("sun_vertex.vs", "sun_fragment.fs");
-    Model sun_model(FileSystem::getPath("resources/objects/planet/planet.obj"));
+    Model& sun_model = sun_async->get();
 
     Shader moon_shader("moon_vertex.vs", "moon_fragment.fs");
-    Model moon_model(FileSystem::getPath("resources/objects/moon/planet.obj"));
+    Model& moon_model = moon_async->get();
+
+    // stands in for the church until it has finished loading
+    Shader placeholder_shader("placeholder_vertex.vs", "placeholder_fragment.fs");
 
     sun_model.SetShaderTextureNamePrefix("material.");
     moon_model.SetShaderTextureNamePrefix("material.");
@@ -227,6 +454,24 @@ int main()
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     glBindVertexArray(0);
 
+    // the floor's bounds and texture coordinates per unit, for the texture streamer
+    glm::vec3 floor_bounds_min(planeVertices[0], planeVertices[1], planeVertices[2]);
+    glm::vec3 floor_bounds_max = floor_bounds_min;
+    double floor_area = 0.0, floor_uv_area = 0.0;
+    for(int i = 0; i < 6; i += 3) {
+        const float* a = &planeVertices[i * 5];
+        const float* b = a + 5;
+        const float* c = b + 5;
+        for(const float* v : {a, b, c}) {
+            floor_bounds_min = glm::min(floor_bounds_min, glm::vec3(v[0], v[1], v[2]));
+            floor_bounds_max = glm::max(floor_bounds_max, glm::vec3(v[0], v[1], v[2]));
+        }
+        glm::vec3 edge_ab(b[0] - a[0], b[1] - a[1], b[2] - a[2]), edge_ac(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+        floor_area += 0.5 * glm::length(glm::cross(edge_ab, edge_ac));
+        floor_uv_area += 0.5 * std::abs((b[3] - a[3]) * (c[4] - a[4]) - (b[4] - a[4]) * (c[3] - a[3]));
+    }
+    float floor_uv_density = floor_area > 0.0 ? (float)std::sqrt(floor_uv_area / floor_area) : 0.0f;
+
     unsigned int floorTexture = loadTexture(FileSystem::getPath("resources/textures/grass_circle.png").c_str());
 
     float skyboxVertices[] = {
@@ -289,19 +534,14 @@ int main()
     skybox_shader.use();
     skybox_shader.setInt("skybox", 0);
 
-    DirLight sun_light;
     sun_light.direction = glm::vec3(4.0f, 40.f, 0.0f);
-    sun_light.ambient = glm::vec3(0.5f);
     sun_light.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
     sun_light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
 
-    DirLight moon_light;
     moon_light.direction = glm::vec3(4.0f, 40.f, 0.0f);
-    moon_light.ambient = glm::vec3(0.1f, 0.1f, 0.15f);
     moon_light.diffuse = glm::vec3(0.02f, 0.02f, 0.1f);
     moon_light.specular = glm::vec3(0.05f, 0.05f, 0.3f);
 
-    PointLight pointLight;
     pointLight.position=glm::vec3 (0.5,0.7,0.5);
     pointLight.ambient=glm::vec3(0.2f,0.2f,0.2f);
     pointLight.diffuse=glm::vec3(0.2f,0.2f,0.0f);
@@ -320,8 +560,7 @@ int main()
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
-    float degrees=0.00f;
-    float moon_rotate=0.0f;
+    frame_pipeline = new FramePipeline<InputSnapshot, FrameState>(simulate_frame);
 
     while (!glfwWindowShouldClose(window))
     {
@@ -332,147 +571,262 @@ int main()
 
         processInput(window);
 
-        glClearColor(sun_prop.sky_color.x, sun_prop.sky_color.y, sun_prop.sky_color.z, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        viewport_manager->update(glfwGetTime());
+        if(viewport_manager->minimized()) {
+            // nothing to render into, wait for the window to be restored
+            glfwWaitEventsTimeout(0.1);
+            continue;
+        }
 
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
+        // publishes the frame simulated while the previous one rendered and starts simulating the next
+        double cpu_start = glfwGetTime();
+        frame_pipeline->setThreaded(programState->SimulationThread);
+        frame_pipeline->step(gather_input(currentFrame));
+        const FrameState& frame = frame_pipeline->current();
+        double render_start = glfwGetTime();
+
+        // the sky view LUT follows the sun, a band of it per frame; before the scene pass, it binds its own target
+        atmosphere->update(glm::vec3(0.0f, sin(frame.sun.radians), -cos(frame.sun.radians)));
+
+        if(programState->HdrEnabled) {
+            const GpuTimer& frame_timer = post_process->frameTimer;
+            dynamic_resolution.update(frame_timer.lastMs(), frame_timer.lastFrame(), frame_timer.nextFrame());
+            post_process->setRenderScale(dynamic_resolution.getScale());
+            post_process->beginScene();
+        }
+
+        programState->TimeOfDay = frame.timeOfDay;
+        glClearColor(frame.sun.sky_color.x, frame.sun.sky_color.y, frame.sun.sky_color.z, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        degrees+=0.5f * programState->SunSpeed;
-        moon_rotate =abs(degrees - 0.5f*programState->SunSpeed);
+        const glm::mat4& projection = frame.projection;
+        const glm::mat4& view = frame.view;
 
-        calculate_day(degrees);
-        calculate_night(degrees+180);
-        if(programState->SunSpeedCheck) {
-            programState->SunSpeed = 0.0f;
+        // the budget is shared, the church gets it first since it is the slowest to appear
+        size_t upload_budget = (size_t)(programState->UploadBudgetMB * 1024.0f * 1024.0f);
+        for(AsyncModel* loading : {church_async.get(), sun_async.get(), moon_async.get()}) {
+            size_t used = loading->Update(upload_budget);
+            upload_budget -= std::min(used, upload_budget);
+        }
+        // the prefetch mappings only need to outlive the initial loads
+        if(programState->PrefetchedAssets && church_async->IsReady() && sun_async->IsReady() && moon_async->IsReady()) {
+            rg::releasePrefetchedAssets();
+            programState->PrefetchedAssets = 0;
         }
 
-        church_shader.use();
+        if(church_async->IsReady())
+            depth_prepass->build(church_model);
+        if(church_virtual_texture)
+            church_virtual_texture->update();
+        texture_streamer.beginFrame(projection, view, viewport_manager->height());
+
+        bool use_indirect = programState->IndirectDraw && static_renderer;
+        double submit_time = 0.0;
+        if(use_indirect)
+            static_renderer->resetStats();
+
+        bool church_virtual = church_virtual_texture && church_virtual_texture->active();
+        // church, sun and moon each have their own shader and one draw a frame, so a multi draw per model is
+        // already one per shader (and, within it, per material); the timing compares the paths per shader
+        auto submit_model = [&](Model& model, Shader& shader, const glm::mat4& transform) {
+            if(&model != &church_model || !church_virtual)
+                model.NoteTextureUsage(texture_streamer, transform);
+            double submit_start = glfwGetTime();
+            if(use_indirect) {
+                static_renderer->begin(projection * view);
+                static_renderer->submit(model, transform);
+                static_renderer->flush(shader);
+            }
+            else {
+                shader.setMat4("model", transform);
+                model.Draw(shader);
+            }
+            submit_time += glfwGetTime() - submit_start;
+        };
+
+        // the sun and moon are tested against what was drawn before them
+        occlusion_culler->beginFrame(projection * view);
+        auto occlusion_begin = [&](DrawKind kind, Model& model, const glm::mat4& transform) {
+            glm::vec3 bounds_min, bounds_max;
+            if(programState->OcclusionCulling && model.GetBounds(bounds_min, bounds_max))
+                occlusion_culler->beginDraw((int)kind, transform, bounds_min, bounds_max);
+        };
 
-        if(sun_prop.active) {
-            church_shader.setVec3("light.direction", sun_prop.position);
-            church_shader.setVec3("viewPosition", programState->camera.Position);
-            church_shader.setVec3("light.ambient", sun_light.ambient);
-            church_shader.setVec3("light.diffuse", sun_light.diffuse);
-            church_shader.setVec3("light.specular", sun_prop.specular);
-            church_shader.setFloat("material.shininess", 0.5f);
-            church_shader.setFloat("light.power", sun_prop.light_power);
-        }
+        church_shader.use();
 
-        if(moon_prop.active) {
-            church_shader.setVec3("light.direction", moon_prop.position);
-            church_shader.setVec3("viewPosition", programState->camera.Position);
-            church_shader.setVec3("light.ambient", moon_light.ambient);
-            church_shader.setVec3("light.diffuse", moon_light.diffuse);
-            church_shader.setVec3("light.specular", moon_prop.specular);
-            church_shader.setFloat("material.shininess", 0.1f);
-            church_shader.setFloat("light.power", moon_prop.light_power);
+        if(frame.lightActive) {
+            church_shader.setVec3("light.direction", frame.light.direction);
+            church_shader.setVec3("viewPosition", frame.cameraPosition);
+            church_shader.setVec3("light.ambient", frame.light.ambient);
+            church_shader.setVec3("light.diffuse", frame.light.diffuse);
+            church_shader.setVec3("light.specular", frame.light.specular);
+            church_shader.setFloat("material.shininess", frame.shininess);
+            church_shader.setFloat("light.power", frame.lightPower);
         }
 
-        church_shader.setVec3("pointLight.position",pointLight.position);
-        church_shader.setVec3("pointLight.ambient", pointLight.ambient);
-        church_shader.setVec3("pointLight.diffuse",pointLight.diffuse);
-        church_shader.setFloat("pointLight.power",moon_prop.light_power);
-        church_shader.setVec3("pointLight.specular",pointLight.specular);
-        church_shader.setFloat("pointLight.constant", pointLight.constant);
-        church_shader.setFloat("pointLight.linear",pointLight.linear);
-        church_shader.setFloat("pointLight.quadratic",pointLight.quadratic * (sin(moon_rotate*0.5)/4+0.5));
+        church_shader.setVec3("pointLight.position",frame.pointLight.position);
+        church_shader.setVec3("pointLight.ambient", frame.pointLight.ambient);
+        church_shader.setVec3("pointLight.diffuse",frame.pointLight.diffuse);
+        church_shader.setFloat("pointLight.power",frame.pointLight.power);
+        church_shader.setVec3("pointLight.specular",frame.pointLight.specular);
+        church_shader.setFloat("pointLight.constant", frame.pointLight.constant);
+        church_shader.setFloat("pointLight.linear",frame.pointLight.linear);
+        church_shader.setFloat("pointLight.quadratic",frame.pointLight.quadratic);
 
         church_shader.setMat4("projection", projection);
         church_shader.setMat4("view", view);
+        // the skybox shows its stars at the moon's power; units 0-5 are the material slots
+        environment_lighting->bind(church_shader, 8, frame.skyRotation, frame.moon.light_power);
+        rg::materials().bind();
+        if(church_virtual_texture)
+            church_virtual_texture->apply(church_shader, 6, 7);
+        else
+            church_shader.setBool("virtualTexturing", false);
+
+        for(const DrawItem& item : frame.draws) {
+            if(item.kind == DrawKind::Church) {
+                bool prepass = programState->DepthPrepass && depth_prepass->ready();
+                GpuTimer& church_timer = prepass ? depth_prepass->prepassTimer : depth_prepass->directTimer;
+                church_timer.begin();
+                if(prepass) {
+                    depth_prepass->draw(projection, view, item.model);
+                    depth_prepass->beginShading();
+                }
+                church_shader.use();
+                submit_model(church_model, church_shader, item.model);
+                if(prepass)
+                    depth_prepass->endShading();
+                church_timer.end();
+            }
+            else if(item.kind == DrawKind::Placeholder) {
+                placeholder_shader.use();
+                placeholder_shader.setMat4("projection", projection);
+                placeholder_shader.setMat4("view", view);
+                placeholder_shader.setMat4("model", item.model);
+                placeholder_shader.setVec3("color", glm::vec3(0.6f, 0.55f, 0.5f));
+                placeholder_shader.setFloat("progress", church_async->Progress());
+                placeholder_shader.setFloat("time", (float)frame.time);
+                glBindVertexArray(skyboxVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glBindVertexArray(0);
+            }
+            else if(item.kind == DrawKind::Sun) {
+                occlusion_begin(item.kind, sun_model, item.model);
+                sun_shader.use();
+                sun_shader.setMat4("projection", projection);
+                sun_shader.setMat4("view", view);
+                sun_shader.setVec3("sun_color", frame.sun.color);
+                sun_shader.setFloat("sun_intensity", frame.sunIntensity);
+                submit_model(sun_model, sun_shader, item.model);
+                occlusion_culler->endDraw();
+            }
+            else if(item.kind == DrawKind::Moon) {
+                occlusion_begin(item.kind, moon_model, item.model);
+                moon_shader.use();
+                moon_shader.setMat4("projection", projection);
+                moon_shader.setMat4("view", view);
+                moon_shader.setVec3("moon_color", frame.moon.color);
+                submit_model(moon_model, moon_shader, item.model);
+                occlusion_culler->endDraw();
+            }
+            else if(item.kind == DrawKind::Floor) {
+                grass_shader.use();
+                glBindVertexArray(planeVAO);
+                glBindTexture(GL_TEXTURE_2D, floorTexture);
+                grass_shader.setMat4("model", item.model);
+                texture_streamer.noteMeshUsage(floor_bounds_min, floor_bounds_max, floor_uv_density, item.model, &floorTexture, 1);
+                grass_shader.setMat4("projection", projection);
+                grass_shader.setMat4("view", view);
+                time_of_day->bind(grass_shader, 1, frame.timeOfDay);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+            else if(item.kind == DrawKind::Skybox) {
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_LEQUAL);
+                skybox_shader.use();
+
+                skybox_shader.setMat4("model", item.model);
+                skybox_shader.setMat4("view", glm::mat4(glm::mat3(view)));
+                skybox_shader.setMat4("projection", projection);
+                time_of_day->bind(skybox_shader, 1, frame.timeOfDay);
+                atmosphere->bind(skybox_shader, 2);
+
+                glBindVertexArray(skyboxVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_texture);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LESS);
+            }
+        }
 
-        // render the loaded model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f)); // translate it down so it's at the center of the scene
-        model = glm::rotate(model,glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.2f));	// it's a bit too big for our scene, so scale it down
-        church_shader.setMat4("model", model);
-
-        church_model.Draw(church_shader);
-
-        if(sun_prop.active) {
-            sun_shader.use();
-
-            sun_shader.setMat4("projection", projection);
-            sun_shader.setMat4("view", view);
-            sun_shader.setVec3("sun_color", sun_prop.color);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, sun_prop.position);
-            model = glm::scale(model, glm::vec3(programState->SunScale));    // it's a bit too big for our scene, so scale it down
-            sun_shader.setMat4("model", model);
-            sun_model.Draw(sun_shader);
+        if(programState->HdrEnabled) {
+            // brighten the image a bit as the sun goes down
+            float exposure = glm::mix(1.6f, 1.0f, frame.sun.light_power);
+            post_process->endScene(viewport_manager->width(), viewport_manager->height(), exposure);
         }
 
-        if(moon_prop.active) {
-            moon_shader.use();
+        texture_streamer.update();
 
-            moon_shader.setMat4("projection", projection);
-            moon_shader.setMat4("view", view);
-            moon_shader.setVec3("moon_color", moon_prop.color);
+        float& submit_ms = use_indirect ? programState->IndirectSubmitMs : programState->LoopSubmitMs;
+        submit_ms = submit_ms * 0.95f + (float)(submit_time * 1000.0) * 0.05f;
 
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, moon_prop.position);
-            model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, moon_rotate/20.0f, glm::vec3(-1.0f, -1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(programState->SunScale*1.2));    // it's a bit too big for our scene, so scale it down
-            moon_shader.setMat4("model", model);
-            moon_model.Draw(moon_shader);
+        if(programState->ImGuiEnabled)
+            DrawImGui(programState);
 
+        // the pages this frame needed are rendered last, they are read back at the start of the next one
+        if(church_virtual_texture && church_virtual_texture->settings.enabled && frame.churchVisible) {
+            Shader& feedback_shader = church_virtual_texture->getFeedbackShader();
+            church_virtual_texture->beginFeedback(viewport_manager->width(), viewport_manager->height(), projection, view);
+            feedback_shader.setMat4("model", frame.churchModel);
+            church_model.Draw(feedback_shader);
+            church_virtual_texture->endFeedback();
+            glViewport(0, 0, viewport_manager->width(), viewport_manager->height());
         }
 
-        grass_shader.use();
-        // floor
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 1.1f, 0.0f));
-        model = glm::scale(model, glm::vec3(2.6f));
-        grass_shader.setMat4("model", model);
-        grass_shader.setMat4("projection", projection);
-        grass_shader.setMat4("view", view);
-        if(sun_prop.active)
-            grass_shader.setFloat("power", sun_prop.light_power * 0.65f);
-        else
-            grass_shader.setFloat("power", moon_prop.light_power * 0.1f);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        if(!sun_prop.active) {
-            glDepthMask(GL_FALSE);
-            glDepthFunc(GL_LEQUAL);
-            skybox_shader.use();
-
-            model = glm::mat4(1.0f);
-            model = glm::rotate(model, moon_rotate*0.007f, glm::vec3(-0.4f, 1.0f, -0.4f));
-            skybox_shader.setMat4("model", model);
-            skybox_shader.setMat4("view", glm::mat4(glm::mat3(view)));
-            skybox_shader.setMat4("projection", projection);
-            skybox_shader.setFloat("power", moon_prop.light_power);
-
-            glBindVertexArray(skyboxVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_texture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glDepthMask(GL_TRUE);
-            glDepthFunc(GL_LESS);
-        }
+        // fences everything the frame wrote into the stream buffer
+        stream_buffer->endFrame();
 
-        if(programState->ImGuiEnabled)
-            DrawImGui(programState);
+        double cpu_end = glfwGetTime();
+        programState->SimulateMs = programState->SimulateMs * 0.95f + (float)frame_pipeline->simulateMs() * 0.05f;
+        programState->RenderMs = programState->RenderMs * 0.95f + (float)((cpu_end - render_start) * 1000.0) * 0.05f;
+        programState->CpuFrameMs = programState->CpuFrameMs * 0.95f + (float)((cpu_end - cpu_start) * 1000.0) * 0.05f;
 
         glfwSwapBuffers(window);
+        if(programState->TimeToFirstFrame == 0.0) {
+            programState->TimeToFirstFrame = glfwGetTime();
+            std::cout << "Time to first frame: " << programState->TimeToFirstFrame * 1000.0 << " ms" << std::endl;
+        }
         glfwPollEvents();
     }
 
+    // the simulation thread owns the camera until it is stopped
+    delete frame_pipeline;
+    frame_pipeline = nullptr;
     programState->SaveToDisk("resources/programState.txt");
 
     //ImGui cleanup
+    imgui_cache.invalidate();
     ImGui_ImplGlfw_Shutdown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui::DestroyContext();
 
     delete programState;
+    church_async.reset();
+    sun_async.reset();
+    moon_async.reset();
+    delete church_virtual_texture;
+    delete post_process;
+    delete viewport_manager;
+    delete static_renderer;
+    delete stream_buffer;
+    delete occlusion_culler;
+    delete depth_prepass;
+    delete time_of_day;
+    delete atmosphere;
+    delete environment_lighting;
+    rg::materials().release();
+    delete static_geometry;
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
@@ -492,14 +846,148 @@ void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, deltaTime);
+    // the camera moves on the simulation thread, see simulate_frame
+    pending_input.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    pending_input.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    pending_input.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    pending_input.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+}
+
+// copies the input and settings for the frame about to be simulated, the mouse and scroll movement
+// start accumulating again from zero
+InputSnapshot gather_input(float time)
+{
+    InputSnapshot input = pending_input;
+    pending_input.mouseX = 0.0f;
+    pending_input.mouseY = 0.0f;
+    pending_input.scroll = 0.0f;
+
+    input.time = time;
+    input.deltaTime = deltaTime;
+    input.aspect = viewport_manager->aspect();
+    input.sunSpeed = programState->SunSpeed;
+    input.sunScale = programState->SunScale;
+    input.sunIntensity = programState->SunIntensity;
+    input.hdrEnabled = programState->HdrEnabled;
+    input.atmosphere = atmosphere->active();
+    // the sun moves once more at the old speed before it is stopped
+    if(programState->SunSpeedCheck)
+        programState->SunSpeed = 0.0f;
+
+    AsyncModel* models[] = {church_async.get(), sun_async.get(), moon_async.get()};
+    SceneModelInfo* infos[] = {&input.church, &input.sun, &input.moon};
+    for(int i = 0; i < 3; i++) {
+        infos[i]->ready = models[i]->IsReady();
+        if(infos[i]->ready)
+            infos[i]->ready = models[i]->get().GetBounds(infos[i]->boundsMin, infos[i]->boundsMax);
+    }
+    return input;
+}
+
+// the simulation stage: camera, sun and moon, lights and the culled draw list for one frame. Runs on the
+// simulation thread and must not touch GL, ImGui or anything the main thread changes; all it gets from
+// there comes through input
+void simulate_frame(const InputSnapshot& input, FrameState& frame)
+{
+    Camera& camera = programState->camera;
+    if(input.forward)
+        camera.ProcessKeyboard(FORWARD, input.deltaTime);
+    if(input.backward)
+        camera.ProcessKeyboard(BACKWARD, input.deltaTime);
+    if(input.left)
+        camera.ProcessKeyboard(LEFT, input.deltaTime);
+    if(input.right)
+        camera.ProcessKeyboard(RIGHT, input.deltaTime);
+    if(input.mouseX != 0.0f || input.mouseY != 0.0f)
+        camera.ProcessMouseMovement(input.mouseX, input.mouseY);
+    if(input.scroll != 0.0f)
+        camera.ProcessMouseScroll(input.scroll);
+
+    sun_degrees += 0.5f * input.sunSpeed;
+    moon_rotate = abs(sun_degrees - 0.5f * input.sunSpeed);
+    TimeOfDaySample day_sample = time_of_day->apply(sun_degrees, sun_prop, moon_prop);
+
+    frame.time = input.time;
+    frame.cameraPosition = camera.Position;
+    frame.projection = glm::perspective(glm::radians(camera.Zoom), input.aspect, 0.1f, 100.0f);
+    frame.view = camera.GetViewMatrix();
+    frame.sun = sun_prop;
+    frame.moon = moon_prop;
+    frame.timeOfDay = TimeOfDay::normalize(sun_degrees);
+    frame.moonRotate = moon_rotate;
+    frame.sunIntensity = input.hdrEnabled ? input.sunIntensity : 1.0f;
+
+    // the moon's light wins while both are up
+    frame.lightActive = sun_prop.active || moon_prop.active;
+    if(moon_prop.active) {
+        frame.light = moon_light;
+        frame.light.direction = moon_prop.position;
+        frame.light.specular = moon_prop.specular;
+        frame.shininess = 0.1f;
+        frame.lightPower = moon_prop.light_power;
+    }
+    else if(sun_prop.active) {
+        frame.light = sun_light;
+        frame.light.direction = sun_prop.position;
+        frame.light.specular = sun_prop.specular;
+        frame.shininess = 0.5f;
+        frame.lightPower = sun_prop.light_power;
+    }
+    frame.light.ambient = day_sample.ambient;
+    frame.pointLight = pointLight;
+    frame.pointLight.power = moon_prop.light_power;
+    frame.pointLight.quadratic = pointLight.quadratic * (sin(moon_rotate*0.5)/4+0.5);
+
+    // models are culled as a whole once their bounds are known, the meshes again when they are drawn
+    glm::mat4 view_projection = frame.projection * frame.view;
+    auto visible = [&](const SceneModelInfo& info, const glm::mat4& model) {
+        return !info.ready || Frustum(view_projection * model).intersects(info.boundsMin, info.boundsMax);
+    };
+    frame.draws.clear();
+
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f)); // translate it down so it's at the center of the scene
+    model = glm::rotate(model,glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.2f));	// it's a bit too big for our scene, so scale it down
+    frame.churchModel = model;
+    frame.churchVisible = visible(input.church, model);
+    if(frame.churchVisible)
+        frame.draws.push_back({DrawKind::Church, model});
+
+    // stands in for the church until it has finished loading
+    if(!input.church.ready)
+        frame.draws.push_back({DrawKind::Placeholder, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f))});
+
+    // floor, before the sun and moon: the occluders have to be in the depth buffer when they are tested
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 1.1f, 0.0f));
+    model = glm::scale(model, glm::vec3(2.6f));
+    if(Frustum(view_projection * model).intersects(glm::vec3(-5.0f, -0.5f, -5.0f), glm::vec3(5.0f, -0.5f, 5.0f)))
+        frame.draws.push_back({DrawKind::Floor, model});
+
+    if(sun_prop.active) {
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, sun_prop.position);
+        model = glm::scale(model, glm::vec3(input.sunScale));    // it's a bit too big for our scene, so scale it down
+        if(visible(input.sun, model))
+            frame.draws.push_back({DrawKind::Sun, model});
+    }
+
+    if(moon_prop.active) {
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, moon_prop.position);
+        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        model = glm::rotate(model, moon_rotate/20.0f, glm::vec3(-1.0f, -1.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(input.sunScale*1.2));    // it's a bit too big for our scene, so scale it down
+        if(visible(input.moon, model))
+            frame.draws.push_back({DrawKind::Moon, model});
+    }
+
+    glm::mat4 sky_model = glm::rotate(glm::mat4(1.0f), moon_rotate*0.007f, glm::vec3(-0.4f, 1.0f, -0.4f));
+    frame.skyRotation = glm::mat3(sky_model);
+    if(!sun_prop.active || input.atmosphere)
+        frame.draws.push_back({DrawKind::Skybox, sky_model});
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -509,6 +997,18 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    // render targets follow once the size settles, see ViewportManager::update
+    if(viewport_manager)
+        viewport_manager->onFramebufferResize(width, height, glfwGetTime());
+}
+
+// glfw: the window moved to a monitor with a different DPI scale
+// ---------------------------------------------------------------
+void content_scale_callback(GLFWwindow* window, float xscale, float yscale)
+{
+    if(viewport_manager)
+        viewport_manager->onContentScale(xscale, yscale);
+    ImGui::GetIO().FontGlobalScale = xscale > yscale ? xscale : yscale;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -528,48 +1028,35 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     lastX = xpos;
     lastY = ypos;
 
-    if(programState->ImGuiEnabled==false)
-        programState->camera.ProcessMouseMovement(xoffset, yoffset);
+    if(programState->ImGuiEnabled==false) {
+        pending_input.mouseX += xoffset;
+        pending_input.mouseY += yoffset;
+    }
 
 }
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    programState->camera.ProcessMouseScroll(yoffset);
-}
-
-void calculate_day(float angle){
-    sun_prop.calc_day_properties(angle);
-}
-
-void calculate_night(float angle){
-    moon_prop.calc_night_properties(angle);
+    pending_input.scroll += yoffset;
 }
 
+// six faces (+X, -X, +Y, -Y, +Z, -Z) or a single cross or equirectangular image
 unsigned int load_cubemap(vector<std::string> faces)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++){
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data){
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        }
-        else{
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-        }
-        stbi_image_free(data);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); //GL_CLAMP_TO_EDGE obaveno
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
+    rg::CubemapImage image;
+    if (!rg::loadCubemapImage(faces, SKYBOX_FACE_SIZE, image, &skybox_load))
+        return 0;
+    unsigned int textureID = rg::uploadCubemap(image, &skybox_load);
+    environment_lighting->build(faces, image, SKYBOX_FACE_SIZE);
+    std::cout << "Skybox " << image.faceSize << "x" << image.faceSize << ": "
+              << (skybox_load.cacheHit ? "cache read " : "decode and convert ")
+              << (skybox_load.cacheHit ? skybox_load.cacheReadMs : skybox_load.decodeMs + skybox_load.convertMs)
+              << " ms, upload " << skybox_load.uploadMs << " ms" << std::endl;
+    const EnvironmentStats& ibl = environment_lighting->stats();
+    std::cout << "Environment lighting: "
+              << (ibl.cacheHit ? "cache read " : "SH and prefilter ")
+              << (ibl.cacheHit ? ibl.cacheReadMs : ibl.shMs + ibl.prefilterMs) << " ms" << std::endl;
     return textureID;
 }
 
@@ -577,7 +1064,38 @@ void DrawImGui(ProgramState* programState){
     //ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+
+    // an idle UI is drawn from the last build, rebuilt at the refresh cap or on input
+    double now = glfwGetTime();
+    imgui_cache.enabled = programState->ImGuiCache;
+    imgui_cache.maxRefreshHz = programState->ImGuiRefreshHz;
+    ImDrawData* draw_data;
+    float build_ms = 0.0f;
+    if(imgui_cache.needsRebuild(now)) {
+        ImGui::GetIO().DeltaTime = std::max(imgui_cache.deltaTime(now), 1e-5f);
+        ImGui::NewFrame();
+        BuildImGui(programState);
+        ImGui::Render();
+        imgui_cache.store(now);
+        draw_data = ImGui::GetDrawData();
+        build_ms = (float)((glfwGetTime() - now) * 1000.0);
+    }
+    else {
+        draw_data = imgui_cache.cached();
+    }
+    programState->ImGuiBuildMs = programState->ImGuiBuildMs * 0.95f + build_ms * 0.05f;
+
+    //ImGui render
+    // the render loop leaves the state the backend's default-state mode expects
+    ImGui_ImplOpenGL3_SetRenderFlags(programState->ImGuiStreamBuffer
+            ? ImGui_ImplOpenGL3_RenderFlags_StreamBuffer | ImGui_ImplOpenGL3_RenderFlags_AssumeDefaultState
+            : ImGui_ImplOpenGL3_RenderFlags_None);
+    double render_start = glfwGetTime();
+    ImGui_ImplOpenGL3_RenderDrawData(draw_data);
+    programState->ImGuiRenderMs = programState->ImGuiRenderMs * 0.95f + (float)((glfwGetTime() - render_start) * 1000.0) * 0.05f;
+}
+
+void BuildImGui(ProgramState* programState){
 
     {
         ImGui::Begin("Sun properties");
@@ -589,18 +1107,249 @@ void DrawImGui(ProgramState* programState){
 
     {
         ImGui::Begin("Camera info");
-        ImGui::Text("Camera position: (%f, %f, %f)",programState->camera.Position.x,programState->camera.Position.y,programState->camera.Position.z);
+        const glm::vec3& camera_position = frame_pipeline->current().cameraPosition;
+        ImGui::Text("Camera position: (%f, %f, %f)",camera_position.x,camera_position.y,camera_position.z);
         ImGui::End();
     }
 
-    //ImGui render
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        ImGui::Begin("Rendering");
+        if(static_renderer) {
+            ImGui::Checkbox("Multi-draw indirect", &programState->IndirectDraw);
+            const IndirectRendererStats& stats = static_renderer->stats();
+            ImGui::Text("Meshes: %u submitted, %u culled", stats.submittedMeshes, stats.culledMeshes);
+            ImGui::Text("Draw commands: %u in %u multi draws", stats.drawCommands, stats.multiDrawCalls);
+        }
+        else {
+            ImGui::Text("Multi-draw indirect needs GL 4.3 (context is %d.%d)", rg::glCaps.major, rg::glCaps.minor);
+        }
+        ImGui::Text("Materials: %zu of %u", rg::materials().size(), MaterialTable::MAX_MATERIALS);
+        const StreamBufferStats& stream_stats = stream_buffer->stats();
+        ImGui::Text("Stream buffer: %s, %.1f KB last frame of %.1f MB, %u frames in flight",
+                    stream_stats.persistent ? "persistent" : "mapped per range", stream_stats.bytesLastFrame / 1024.0,
+                    stream_stats.capacity / (1024.0 * 1024.0), stream_stats.framesInFlight);
+        ImGui::Text("Stream buffer waits: %zu (%.2f ms), grows: %zu", stream_stats.fenceWaits, stream_stats.fenceWaitMs,
+                    stream_stats.grows);
+        ImGui::Checkbox("Occlusion culling (sun, moon)", &programState->OcclusionCulling);
+        const OcclusionStats& occlusion_stats = occlusion_culler->stats();
+        ImGui::Text("Occlusion: %u tested, %u too close to test, %u of %u results hidden", occlusion_stats.tested,
+                    occlusion_stats.skipped, occlusion_stats.occluded, occlusion_stats.resolved);
+        ImGui::Checkbox("Church depth pre-pass", &programState->DepthPrepass);
+        const DepthPrepassStats& prepass_stats = depth_prepass->stats();
+        ImGui::Text("Church GPU: %.3f ms with pre-pass, %.3f ms without", depth_prepass->prepassTimer.averageMs(),
+                    depth_prepass->directTimer.averageMs());
+        ImGui::Text("Pre-pass: %u meshes drawn, %u culled", prepass_stats.drawnMeshes, prepass_stats.culledMeshes);
+        ImGui::Checkbox("UI from a ring buffer, no state backup", &programState->ImGuiStreamBuffer);
+        ImGui::Checkbox("Reuse idle UI frames", &programState->ImGuiCache);
+        ImGui::SliderFloat("Idle UI refresh (Hz)", &programState->ImGuiRefreshHz, 1.0f, 60.0f, "%.0f");
+        ImGui::Text("UI build: %.3f ms, render: %.3f ms, %lu built / %lu reused frames", programState->ImGuiBuildMs,
+                    programState->ImGuiRenderMs, imgui_cache.builtFrames, imgui_cache.cachedFrames);
+        ImGui::Checkbox("Simulate on its own thread", &programState->SimulationThread);
+        ImGui::Text("CPU frame: %.3f ms (simulate %.3f ms, render %.3f ms)", programState->CpuFrameMs,
+                    programState->SimulateMs, programState->RenderMs);
+        ImGui::Text("CPU submission, per-mesh loop: %.3f ms", programState->LoopSubmitMs);
+        ImGui::Text("CPU submission, indirect: %.3f ms", programState->IndirectSubmitMs);
+        ImGui::Text("Framebuffer: %d x %d (content scale %.2f)", viewport_manager->width(), viewport_manager->height(),
+                    viewport_manager->contentScale());
+        ImGui::Text("Render targets: %d x %d, %u reallocations for %u resize events",
+                    viewport_manager->settledWidthPx(), viewport_manager->settledHeightPx(),
+                    viewport_manager->reallocationCount(), viewport_manager->resizeEventCount());
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Time of day");
+        ImGui::Text("Time of day: %.3f", programState->TimeOfDay);
+        ImGui::Text("Curves: %zu keys from %s, baked into %d entries", time_of_day->keys(),
+                    time_of_day->fromFile() ? "resources/time_of_day.txt" : "the built-in defaults", TimeOfDay::LUT_SIZE);
+        if(ImGui::Button("Reload curves"))
+            time_of_day->load(FileSystem::getPath("resources/time_of_day.txt"));
+        auto sun_power = [](void* data, int i) { return ((TimeOfDay*)data)->sunPowerAt(i); };
+        auto moon_power = [](void* data, int i) { return ((TimeOfDay*)data)->moonPowerAt(i); };
+        ImGui::PlotLines("Sun power", sun_power, time_of_day, TimeOfDay::LUT_SIZE, 0, nullptr, 0.0f, 1.0f, ImVec2(0, 50));
+        ImGui::PlotLines("Moon power", moon_power, time_of_day, TimeOfDay::LUT_SIZE, 0, nullptr, 0.0f, 1.0f, ImVec2(0, 50));
+        AtmosphereSettings& sky_settings = atmosphere->settings;
+        const AtmosphereStats& sky_stats = atmosphere->stats();
+        ImGui::Checkbox("Atmospheric scattering", &sky_settings.enabled);
+        ImGui::DragFloat("Sky intensity", &sky_settings.intensity, 0.1f, 0.0f, 100.0f);
+        ImGui::DragFloat("Update after (degrees)", &sky_settings.updateDegrees, 0.05f, 0.0f, 10.0f);
+        ImGui::SliderInt("Update over (frames)", &sky_settings.updateFrames, 1, 16);
+        ImGui::Text("Sky view: %u updates, %d rows this frame%s, %.3f ms", sky_stats.updates, sky_stats.rowsThisFrame,
+                    sky_stats.updating ? " (updating)" : "", atmosphere->updateTimer.averageMs());
+        static const char* layouts[] = {"six faces", "vertical cross", "horizontal cross", "equirectangular"};
+        if(skybox_load.cacheHit)
+            ImGui::Text("Skybox (%s): cache read %.2f ms, upload %.2f ms", layouts[(int)skybox_load.layout],
+                        skybox_load.cacheReadMs, skybox_load.uploadMs);
+        else
+            ImGui::Text("Skybox (%s): decode %.2f ms, convert %.2f ms, upload %.2f ms", layouts[(int)skybox_load.layout],
+                        skybox_load.decodeMs, skybox_load.convertMs, skybox_load.uploadMs);
+        EnvironmentSettings& ibl_settings = environment_lighting->settings;
+        const EnvironmentStats& ibl_stats = environment_lighting->stats();
+        ImGui::Checkbox("Environment lighting", &ibl_settings.enabled);
+        ImGui::DragFloat("Environment intensity", &ibl_settings.intensity, 0.05f, 0.0f, 20.0f);
+        if(ibl_stats.cacheHit)
+            ImGui::Text("Environment: cache read %.2f ms, upload %.2f ms", ibl_stats.cacheReadMs, ibl_stats.uploadMs);
+        else
+            ImGui::Text("Environment: SH %.2f ms, prefilter %.2f ms, upload %.2f ms", ibl_stats.shMs,
+                        ibl_stats.prefilterMs, ibl_stats.uploadMs);
+        ImGui::End();
+    }
+
+    {
+        PostProcessSettings& settings = post_process->settings;
+        ImGui::Begin("Post processing");
+        ImGui::Checkbox("HDR, bloom and tonemapping", &programState->HdrEnabled);
+        ImGui::DragFloat("Exposure", &settings.exposure, 0.05f, 0.1f, 5.0f);
+        ImGui::DragFloat("Sun intensity", &programState->SunIntensity, 0.1f, 1.0f, 20.0f);
+        ImGui::SliderInt("Bloom levels", &settings.bloomLevels, 0, 8);
+        ImGui::RadioButton("Bloom from 1/2", &settings.bloomFirstDivisor, 2);
+        ImGui::SameLine();
+        ImGui::RadioButton("Bloom from 1/4", &settings.bloomFirstDivisor, 4);
+        ImGui::DragFloat("Bloom threshold", &settings.bloomThreshold, 0.05f, 0.0f, 10.0f);
+        ImGui::DragFloat("Bloom intensity", &settings.bloomIntensity, 0.02f, 0.0f, 3.0f);
+        ImGui::Text("Scene: %.3f ms", post_process->sceneTimer.averageMs());
+        ImGui::Text("Bloom downsample: %.3f ms", post_process->bloomDownTimer.averageMs());
+        ImGui::Text("Bloom upsample: %.3f ms", post_process->bloomUpTimer.averageMs());
+        ImGui::Text("Tonemap: %.3f ms", post_process->tonemapTimer.averageMs());
+        ImGui::End();
+    }
+
+    {
+        DynamicResolutionSettings& settings = dynamic_resolution.settings;
+        ImGui::Begin("Dynamic resolution");
+        ImGui::Checkbox("Enabled (needs HDR)", &settings.enabled);
+        ImGui::DragFloat("Target GPU ms", &settings.targetMs, 0.1f, 4.0f, 50.0f);
+        ImGui::DragFloatRange2("Scale range", &settings.minScale, &settings.maxScale, 0.01f, 0.5f, 1.0f);
+        ImGui::DragFloat("Upscale sharpness", &post_process->settings.upscaleSharpness, 0.01f, 0.0f, 1.0f);
+        ImGui::Text("Scale: %.0f%% (%d x %d)", dynamic_resolution.getScale() * 100.0f,
+                    post_process->getRenderWidth(), post_process->getRenderHeight());
+        ImGui::Text("GPU frame: %.2f ms", post_process->frameTimer.averageMs());
+        ImGui::PlotLines("Scale", dynamic_resolution.getScaleHistory(), DynamicResolution::HISTORY_SIZE,
+                         dynamic_resolution.getHistoryOffset(), nullptr, 0.5f, 1.0f, ImVec2(0, 50));
+        ImGui::PlotLines("GPU ms", dynamic_resolution.getGpuMsHistory(), DynamicResolution::HISTORY_SIZE,
+                         dynamic_resolution.getHistoryOffset(), nullptr, 0.0f, settings.targetMs * 2.0f, ImVec2(0, 50));
+        ImGui::End();
+    }
+
+    {
+        const GeometryPoolStats& stats = static_geometry->stats();
+        ImGui::Begin("Geometry pool");
+        ImGui::Text("Vertices: %zu / %zu", stats.vertexUsed, stats.vertexCapacity);
+        ImGui::Text("Indices: %zu / %zu", stats.indexUsed, stats.indexCapacity);
+        ImGui::Text("Uploads: %zu (%.2f MB, %.2f ms)", stats.uploadCount, stats.uploadBytes / (1024.0 * 1024.0), stats.uploadMs);
+        ImGui::Text("Buffer grows: %zu", stats.growCount);
+        ImGui::Text("Free blocks: %zu vertex, %zu index", stats.vertexFreeBlocks, stats.indexFreeBlocks);
+        ImGui::Text("Largest free block: %zu vertices, %zu indices", stats.largestVertexBlock, stats.largestIndexBlock);
+        ImGui::Text("Fragmentation: %.2f vertex, %.2f index", stats.vertexFragmentation, stats.indexFragmentation);
+        ImGui::End();
+    }
+
+    {
+        TextureStreamerSettings& settings = texture_streamer.settings;
+        const TextureStreamerStats& stats = texture_streamer.stats();
+        ImGui::Begin("Texture streaming");
+        ImGui::Checkbox("Enabled", &settings.enabled);
+        ImGui::DragFloat("Budget (MB)", &settings.budgetMB, 1.0f, 4.0f, 1024.0f);
+        ImGui::DragFloat("Upload per frame (MB)", &settings.uploadMBPerFrame, 0.1f, 0.1f, 64.0f);
+        ImGui::DragFloat("Level bias", &settings.levelBias, 0.05f, -2.0f, 4.0f);
+        ImGui::Text("Resident: %.2f MB of %.2f MB (%u textures)", stats.residentBytes / (1024.0 * 1024.0),
+                    stats.fullBytes / (1024.0 * 1024.0), stats.textures);
+        ImGui::Text("Last frame: %u uploads, %u evictions, %u starved", stats.uploadsLastFrame, stats.evictionsLastFrame, stats.starved);
+        ImGui::Text("Total: %zu uploads, %zu evictions", stats.uploads, stats.evictions);
+        for(const TextureStreamer::Entry& entry : texture_streamer.getEntries())
+            ImGui::Text("#%u %dx%d: level %d (wants %.1f, floor %d)", entry.id, entry.image.width, entry.image.height,
+                        entry.residentLevel, entry.wantedLevel, entry.floorLevel);
+        ImGui::End();
+    }
+
+    {
+        rg::TextureCompressionStats stats = rg::textureCompressionStats();
+        ImGui::Begin("Textures");
+        ImGui::Text("Block compression: %s", rg::glCaps.textureCompressionS3TC ? "BC1/BC3/BC4/BC5" : "BC4/BC5 only (no S3TC)");
+        ImGui::Text("Compressed: %u textures, %u from cache", stats.textures, stats.cacheHits);
+        ImGui::Text("VRAM: %.2f MB (%.2f MB uncompressed, %.1fx smaller)", stats.compressedBytes / (1024.0 * 1024.0),
+                    stats.uncompressedBytes / (1024.0 * 1024.0),
+                    stats.compressedBytes ? (double)stats.uncompressedBytes / stats.compressedBytes : 0.0);
+        ImGui::Text("Encode: %.1f ms, cache read: %.1f ms, upload: %.1f ms", stats.encodeMs, stats.cacheReadMs, stats.uploadMs);
+        ImGui::End();
+    }
+
+    if(church_virtual_texture) {
+        VirtualTextureSettings& settings = church_virtual_texture->settings;
+        const VirtualTextureStats& stats = church_virtual_texture->getStats();
+        ImGui::Begin("Virtual texture");
+        ImGui::Checkbox("Enabled", &settings.enabled);
+        ImGui::SliderInt("Feedback divisor", &settings.feedbackDivisor, 2, 16);
+        ImGui::SliderInt("Uploads per frame", &settings.uploadsPerFrame, 1, 64);
+        ImGui::DragFloat("Mip bias", &settings.mipBias, 0.05f, -2.0f, 4.0f);
+        if(church_virtual_texture->failed())
+            ImGui::Text("Page file could not be opened or built");
+        else if(!church_virtual_texture->ready())
+            ImGui::Text("Building page file...");
+        else {
+            ImGui::Text("Virtual size: %d x %d, %d levels", church_virtual_texture->getWidth(),
+                        church_virtual_texture->getHeight(), church_virtual_texture->getLevels());
+            ImGui::Text("Page file built in %.0f ms (0 if it was up to date)", stats.pageFileBuildMs);
+            ImGui::Text("Resident: %u / %u pages", stats.residentPages, stats.cachePages);
+            ImGui::Text("Requested: %u pages, %u faults", stats.requestedPages, stats.pageFaults);
+            ImGui::Text("Queued: %u, uploaded last frame: %u", stats.queuedPages, stats.uploadsLastFrame);
+            ImGui::Text("Streamed: %zu pages (%.2f MB), %zu evictions", stats.streamedPages,
+                        stats.streamedBytes / (1024.0 * 1024.0), stats.evictions);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Loading");
+        ImGui::Text("Time to first frame: %.1f ms", programState->TimeToFirstFrame * 1000.0);
+        ImGui::DragFloat("Upload budget (MB/frame)", &programState->UploadBudgetMB, 0.25f, 0.25f, 64.0f);
+        JobSystemStats job_stats = rg::jobs().stats();
+        ImGui::Text("Jobs: %u workers, %zu run, %zu stolen", rg::jobs().workerCount(), job_stats.jobsRun, job_stats.steals);
+        const char* names[] = {"Church", "Sun", "Moon"};
+        AsyncModel* models[] = {church_async.get(), sun_async.get(), moon_async.get()};
+        for(int i = 0; i < 3; i++) {
+            if(models[i]->IsReady())
+                ImGui::Text("%s: ready in %.2f s (read %.0f ms, convert %.0f ms)", names[i], models[i]->LoadSeconds(),
+                            models[i]->ReadSeconds() * 1000.0, models[i]->ConvertSeconds() * 1000.0);
+            else if(models[i]->GetState() == AsyncModel::Failed)
+                ImGui::Text("%s: failed", names[i]);
+            else
+                ImGui::ProgressBar(models[i]->Progress(), ImVec2(-1, 0), names[i]);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Asset I/O");
+        if(FileSystem::getArchive())
+            ImGui::Text("Archive: resources.pack, %zu files", FileSystem::getArchive()->size());
+        else
+            ImGui::Text("Archive: none, loose files");
+        ImGui::Text("Prefetch: %.2f ms to issue", programState->PrefetchMs);
+        std::vector<rg::AssetIORecord> records = rg::assetIORecords();
+        size_t mapped = 0, copied = 0;
+        double ms = 0.0;
+        for(const rg::AssetIORecord& record : records) {
+            mapped += record.bytesMapped;
+            copied += record.bytesCopied;
+            ms += record.ioMs;
+        }
+        ImGui::Text("Total: %.2f MB mapped, %.2f MB copied, %.1f ms", mapped / (1024.0 * 1024.0), copied / (1024.0 * 1024.0), ms);
+        if(ImGui::CollapsingHeader("Per asset")) {
+            for(const rg::AssetIORecord& record : records) {
+                std::string name = record.path.substr(record.path.find_last_of('/') + 1);
+                ImGui::Text("%s: %u reads, %.1f KB mapped, %.1f KB copied, %.2f ms", name.c_str(), record.reads,
+                            record.bytesMapped / 1024.0, record.bytesCopied / 1024.0, record.ioMs);
+            }
+        }
+        ImGui::End();
+    }
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods){
     if(key==GLFW_KEY_Q && action==GLFW_PRESS){
         programState->ImGuiEnabled=!programState->ImGuiEnabled;
+        imgui_cache.invalidate();
         if(programState->ImGuiEnabled){
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
         }
@@ -635,8 +1384,24 @@ unsigned int loadTexture(char const * path)
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
+    rg::CompressedImage compressed;
+    if (rg::loadCompressedImage(path, compressed))
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        if (rg::textureStreamer())
+            rg::textureStreamer()->add(textureID, std::move(compressed));
+        else
+            rg::uploadCompressedImage(compressed);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char *data = rg::loadImage(path, &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
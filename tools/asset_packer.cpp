@@ -0,0 +1,179 @@
+//
+// Created by miodrag on 19.10.26..
+//
+
+// Bundles resource directories into one archive that the application mounts through
+// FileSystem::mountArchive, see rg/AssetPack.h for the layout.
+//
+//   asset_packer <project root> <archive> [directory...]
+//
+// Directories are relative to the project root and default to "resources".
+
+#include <rg/AssetPack.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SourceFile {
+    std::string path;
+    std::string relative;
+    long long mtime;
+};
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void collect(const std::string& root, const std::string& relative, const std::string& archive, std::vector<SourceFile>& out) {
+    std::string directory = root + "/" + relative;
+    DIR* handle = opendir(directory.c_str());
+    if (!handle) {
+        std::cout << "asset_packer: can't read " << directory << std::endl;
+        return;
+    }
+    while (dirent* item = readdir(handle)) {
+        std::string name = item->d_name;
+        // hidden files, and the temporaries the texture caches are written through
+        if (name.empty() || name[0] == '.' || endsWith(name, ".tmp"))
+            continue;
+        std::string childRelative = relative + "/" + name;
+        std::string child = root + "/" + childRelative;
+        struct stat info;
+        if (stat(child.c_str(), &info) != 0 || rg::assetio::normalizePath(child) == archive)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            collect(root, childRelative, archive, out);
+        else if (S_ISREG(info.st_mode))
+            out.push_back({child, childRelative, (long long)info.st_mtime});
+    }
+    closedir(handle);
+}
+
+// already GPU ready, kept uncompressed so the runtime can use them straight from the mapping
+bool storeUncompressed(const std::string& path) {
+    return endsWith(path, ".ktx2") || endsWith(path, ".vtpages");
+}
+
+bool writeAll(FILE* file, const void* data, size_t size) {
+    return size == 0 || std::fwrite(data, 1, size, file) == size;
+}
+
+bool padTo(FILE* file, uint64_t offset) {
+    long position = std::ftell(file);
+    if (position < 0 || (uint64_t)position > offset)
+        return false;
+    std::vector<char> zeros((size_t)(offset - position), 0);
+    return writeAll(file, zeros.data(), zeros.size());
+}
+
+}
+
+int main(int argc, char** argv) {
+    using namespace rg::pack;
+    if (argc < 3) {
+        std::cout << "usage: asset_packer <project root> <archive> [directory...]" << std::endl;
+        return 1;
+    }
+    std::string root = argv[1];
+    std::string archivePath = argv[2];
+    std::vector<std::string> directories;
+    for (int i = 3; i < argc; ++i)
+        directories.push_back(argv[i]);
+    if (directories.empty())
+        directories.push_back("resources");
+
+    std::vector<SourceFile> sources;
+    for (const std::string& directory : directories)
+        collect(root, directory, rg::assetio::normalizePath(archivePath), sources);
+    // readdir order depends on the filesystem, sorted paths make packing the same tree give the same archive
+    std::sort(sources.begin(), sources.end(), [](const SourceFile& a, const SourceFile& b) { return a.relative < b.relative; });
+
+    std::vector<AssetPackEntry> entries(sources.size());
+    std::string strings;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        entries[i] = AssetPackEntry{};
+        entries[i].hash = hashPath(sources[i].relative);
+        entries[i].mtime = sources[i].mtime;
+        entries[i].pathOffset = (uint32_t)strings.size();
+        entries[i].pathLength = (uint32_t)sources[i].relative.size();
+        strings += sources[i].relative;
+    }
+    // the index is searched by hash, the data stays in path order
+    std::vector<size_t> order(sources.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].hash < entries[b].hash; });
+
+    AssetPackHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = (uint32_t)entries.size();
+    header.alignment = ALIGNMENT;
+    header.stringsOffset = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry);
+    header.stringsSize = strings.size();
+
+    std::string temporary = archivePath + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cout << "asset_packer: can't write " << temporary << std::endl;
+        return 1;
+    }
+    // the index is written last, once the offsets are known
+    uint64_t offset = alignOffset(header.stringsOffset + header.stringsSize);
+    bool ok = padTo(file, offset);
+    uint64_t totalSize = 0, totalStored = 0;
+    for (size_t i = 0; i < sources.size() && ok; ++i) {
+        rg::MappedFile source(sources[i].path);
+        if (!source.valid()) {
+            std::cout << "asset_packer: can't read " << sources[i].path << std::endl;
+            ok = false;
+            break;
+        }
+        AssetPackEntry& entry = entries[i];
+        entry.offset = offset;
+        entry.size = source.size();
+        std::vector<unsigned char> compressed;
+        if (!storeUncompressed(sources[i].path) && source.size() > 0)
+            compressed = lz4::compress(source.data(), source.size());
+        // compression has to pay for decoding on every load, images that are already compressed don't
+        if (!compressed.empty() && compressed.size() < source.size() - source.size() / 8) {
+            entry.compression = LZ4;
+            entry.storedSize = compressed.size();
+            ok = writeAll(file, compressed.data(), compressed.size());
+        } else {
+            entry.compression = None;
+            entry.storedSize = source.size();
+            ok = writeAll(file, source.data(), source.size());
+        }
+        offset = alignOffset(offset + entry.storedSize);
+        ok = ok && padTo(file, offset);
+        totalSize += entry.size;
+        totalStored += entry.storedSize;
+        std::cout << sources[i].relative << ": " << entry.size << " -> " << entry.storedSize
+                  << (entry.compression == LZ4 ? " (lz4)" : "") << std::endl;
+    }
+
+    std::vector<AssetPackEntry> index;
+    for (size_t i : order)
+        index.push_back(entries[i]);
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && writeAll(file, &header, sizeof(header)) &&
+         writeAll(file, index.data(), index.size() * sizeof(AssetPackEntry)) && writeAll(file, strings.data(), strings.size());
+    ok = std::fclose(file) == 0 && ok && std::rename(temporary.c_str(), archivePath.c_str()) == 0;
+    if (!ok) {
+        std::remove(temporary.c_str());
+        std::cout << "asset_packer: failed to write " << archivePath << std::endl;
+        return 1;
+    }
+    std::cout << "Packed " << entries.size() << " files, " << totalSize / 1024 << " KB into " << totalStored / 1024
+              << " KB (" << offset / 1024 << " KB with alignment) in " << archivePath << std::endl;
+    return 0;
+}